@@ -156,6 +156,11 @@ void Daemon::mainTask()
             using namespace std::chrono_literals;
 
             cout << "PM Just chillin here..." << endl;
+#ifdef __linux__
+            if (deps.TakeEarlyCheckin()) {
+                (void) agent.requestCheckin();
+            }
+#endif
             //auto start = chrono::high_resolution_clock::now();
             (void) chrono::high_resolution_clock::now();
             this_thread::sleep_for(1000ms);
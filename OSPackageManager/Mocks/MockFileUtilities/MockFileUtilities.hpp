@@ -19,5 +19,6 @@ class MockFileUtilities : public PackageManager::IFileUtilities
     MOCK_METHOD(int32_t, FileSearchWithWildCard, (const std::filesystem::path&, std::vector<std::filesystem::path>&), (override));
     MOCK_METHOD(std::string, ResolvePath, (const std::string&), (override));
     MOCK_METHOD(std::string, ResolveKnownFolderIdForDefaultUser, (const std::string&), (override));
+    MOCK_METHOD(std::vector<std::string>, ResolvePathForAllUsers, (const std::string&), (override));
 };
 
@@ -0,0 +1,27 @@
+/**
+ * @file
+ * @copyright (c) 2025 Cisco Systems, Inc. All rights reserved.
+ */
+#pragma once
+
+#include "OSPackageManager/linux/IPackageUtil.hpp"
+#include "gmock/gmock.h"
+
+class MockPackageUtil : public IPackageUtil
+{
+    public:
+        MOCK_METHOD(bool, isValidInstallerType, (const std::string &installerType), (const, override));
+        MOCK_METHOD(std::vector<std::string>, listPackages, (), (const, override));
+        MOCK_METHOD(PackageInfo, getPackageInfo, (const PKG_ID_TYPE& identifierType, const std::string& packageIdentifier), (const, override));
+        MOCK_METHOD(bool, listInstalledPackages, (std::vector<PackageInfo>& packages), (const, override));
+        MOCK_METHOD(std::vector<std::string>, listPackageFiles, (const PKG_ID_TYPE& identifierType, const std::string& packageIdentifier), (const, override));
+        MOCK_METHOD(bool, installPackageWithContext, (const std::string& packagePath, const std::string& catalogProductAndVersion, (const std::map<std::string, int>& installOptions)), (const, override));
+        MOCK_METHOD(std::vector<bool>, installPackagesWithContext, (const std::vector<PackageInstallRequest>& packages, (const std::map<std::string, int>& installOptions)), (const, override));
+        MOCK_METHOD(bool, processPendingTriggers, (), (const, override));
+        MOCK_METHOD(PackageInstallMetrics, getInstallMetrics, (), (const, override));
+        MOCK_METHOD(uint64_t, getPackageDbGeneration, (), (const, override));
+        MOCK_METHOD(bool, getChangedPackagesSince, (uint64_t generation, std::set<std::string>& packageNames), (const, override));
+        MOCK_METHOD(bool, uninstallPackage, (const std::string& packageIdentifier), (const, override));
+        MOCK_METHOD(bool, uninstallPackages, (const std::vector<std::string>& packageIdentifiers), (const, override));
+        MOCK_METHOD(bool, verifyPackage, (const std::string& packagePath, const std::string& signerKeyID), (const, override));
+};
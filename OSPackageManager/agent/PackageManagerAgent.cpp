@@ -45,14 +45,25 @@ int32_t PackageManagerAgent::start()
     PM_LOG_INFO( "PM Agent - Using bootstrap path: %s, exists: %s, code: %d, msg: %s", bootstrapFile_.c_str(),
                  std::filesystem::exists(bootstrapFile_, ecode) ? "Yes" : "No", ecode.value(), ecode.message().c_str() );
 
+    std::lock_guard<std::mutex> lock(startStopMutex_);
     return packageManager_->Start(configFile_.c_str(), bootstrapFile_.c_str());
 }
 
 int32_t PackageManagerAgent::stop()
 {
+    std::lock_guard<std::mutex> lock(startStopMutex_);
     return packageManager_->Stop();
 }
 
+int32_t PackageManagerAgent::requestCheckin()
+{
+    std::lock_guard<std::mutex> lock(startStopMutex_);
+    PM_LOG_INFO( "PM Agent - Restarting the package manager for an early check-in" );
+    // The package manager checks in when it starts.
+    (void) packageManager_->Stop();
+    return packageManager_->Start(configFile_.c_str(), bootstrapFile_.c_str());
+}
+
 bool PackageManagerAgent::configIsValid()
 {
     return packageManager_->VerifyPmConfig(configFile_.c_str()) == 0 ? true : false;
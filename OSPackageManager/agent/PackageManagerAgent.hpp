@@ -10,6 +10,7 @@ class IPackageManager;
 class IPmPlatformDependencies;
 class IPMLogger;
 
+#include <mutex>
 #include <string>
 
 namespace Agent
@@ -26,6 +27,12 @@ public:
     int32_t start();
     int32_t stop();
 
+    /**
+     * @brief Makes the package manager check in now instead of at its next interval, by restarting it, since
+     *        it has no other way to be asked. Call between check-ins: one in progress would be cut off.
+     */
+    int32_t requestCheckin();
+
     bool configIsValid();
 
 private:
@@ -35,6 +42,7 @@ private:
     IPMLogger &logger_;
     IPmPlatformDependencies &platformDependencies_;
     IPackageManager *packageManager_;
+    std::mutex startStopMutex_;
 };
 
 
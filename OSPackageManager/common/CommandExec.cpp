@@ -8,6 +8,30 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <memory>
+#include <poll.h>
+
+namespace { //anonymous namespace
+    // How often the child is checked for having exited while its output pipe stays open.
+    const int childPollIntervalMs = 50;
+
+    /**
+     * @brief Appends what can be read from a non-blocking pipe without waiting.
+     * @return False once every write end is closed, or on a read error.
+     */
+    bool DrainPipe(int fd, std::string &output) {
+        char buffer[4096];
+        for (;;) {
+            const ssize_t bytesRead = read(fd, buffer, sizeof(buffer));
+            if (bytesRead > 0) {
+                output.append(buffer, static_cast<size_t>(bytesRead));
+            } else if (bytesRead < 0 && errno == EINTR) {
+                continue;
+            } else {
+                return bytesRead < 0 && errno == EAGAIN;
+            }
+        }
+    }
+}
 
 int CommandExec::ExecuteCommand(const std::string &cmd, const std::vector<std::string> &argv, int &exitCode) {
     int ret = -1;
@@ -62,6 +86,14 @@ int CommandExec::ExecuteCommand(const std::string &cmd, const std::vector<std::s
 }
 
 int CommandExec::ExecuteCommandCaptureOutput(const std::string &cmd, const std::vector<std::string> &argv, int &exitCode, std::string &output) {
+    return ExecuteCommandCapture(cmd, argv, false, exitCode, output);
+}
+
+int CommandExec::ExecuteCommandCaptureCombinedOutput(const std::string &cmd, const std::vector<std::string> &argv, int &exitCode, std::string &output) {
+    return ExecuteCommandCapture(cmd, argv, true, exitCode, output);
+}
+
+int CommandExec::ExecuteCommandCapture(const std::string &cmd, const std::vector<std::string> &argv, bool mergeStderr, int &exitCode, std::string &output) {
     int ret = -1;
     int status = 1;
     pid_t pid = -1;
@@ -69,8 +101,6 @@ int CommandExec::ExecuteCommandCaptureOutput(const std::string &cmd, const std::
     extern char **environ;
     posix_spawn_file_actions_t childFdActions = {0};
     int out [2] = {-1, -1};
-    ssize_t bytesRead = 0;
-    const int waitPidOptions = 0;   
 
     if (cmd.empty() || argv.empty() || '/' != cmd[0]) {
         return ret;
@@ -79,7 +109,7 @@ int CommandExec::ExecuteCommandCaptureOutput(const std::string &cmd, const std::
     // Lambda Function to delete file actions (Used as custom deleter)
     auto fileActionsDeleter = [](posix_spawn_file_actions_t *actions) {
         posix_spawn_file_actions_destroy(actions);
-    };                                                                      
+    };
 
     if (posix_spawn_file_actions_init(&childFdActions) != 0) {
         PM_LOG_ERROR("posix_spawn_file_actions_init failed");
@@ -100,27 +130,19 @@ int CommandExec::ExecuteCommandCaptureOutput(const std::string &cmd, const std::
 
     auto outPtr = std::unique_ptr<int, decltype(close_pipe)>(out, close_pipe); // Just for cleaning purpose on return.
 
-    if (pipe(out) == -1) {
+    // Only our read end is non-blocking; the child writes to a blocking pipe.
+    if (pipe2(out, O_CLOEXEC) == -1 || fcntl(out[0], F_SETFL, O_NONBLOCK) == -1) {
         PM_LOG_ERROR("pipe failed");
         return ret;
     }
 
-    int flags = fcntl(out[0], F_GETFL, 0); 
-    if (flags == -1) {
-        PM_LOG_ERROR("fcntl failed");
-        return ret;
-    }
-
-    if (posix_spawn_file_actions_adddup2(&childFdActions, out[1], 1) != 0) {
+    // Merged, stdout and stderr share the write end, so the child's messages keep their relative order.
+    if (posix_spawn_file_actions_adddup2(&childFdActions, out[1], 1) != 0 ||
+        (mergeStderr && posix_spawn_file_actions_adddup2(&childFdActions, out[1], 2) != 0)) {
         PM_LOG_ERROR("posix_spawn_file_actions_adddup2");
         return ret;
     }
 
-    if (posix_spawn_file_actions_addclose(&childFdActions, out[0]) != 0) {
-        PM_LOG_ERROR("posix_spawn_file_actions_addclose");
-        return ret;
-    }
-
     std::vector<char*> argv_cstr;
     for (const auto& arg : argv) {
         argv_cstr.push_back(const_cast<char*>(arg.c_str()));
@@ -134,36 +156,50 @@ int CommandExec::ExecuteCommandCaptureOutput(const std::string &cmd, const std::
 
     PM_LOG_DEBUG("Spawned process for cmd %s: %d", cmd.c_str(), pid);
 
-    fcntl(out[0], F_SETFL, flags | O_NONBLOCK);
-
-    do {
-        waitPid = waitpid(pid, &status, waitPidOptions);
-    } while (waitPid < 0 && errno == EINTR);
-    
+    // Close our copy of the write end so that the pipe reports EOF once the child (and its children) exit.
+    (void)close(out[1]);
+    out[1] = -1;
+
+    // Read and reap together: a daemon started by the child (a maintainer script starting a service, say) can
+    // inherit the pipe and keep it open long after the child exited, so EOF is not waited for.
+    output.clear();
+    bool pipeOpen = true;
+    for (;;) {
+        if (pipeOpen) {
+            struct pollfd pipeFd = {out[0], POLLIN, 0};
+            const int polled = poll(&pipeFd, 1, childPollIntervalMs);
+            if (polled > 0) {
+                pipeOpen = DrainPipe(out[0], output);
+            } else if (polled < 0 && errno != EINTR) {
+                PM_LOG_ERROR("poll failed with error: %d", errno);
+                pipeOpen = false;
+            }
+        }
+        waitPid = waitpid(pid, &status, pipeOpen ? WNOHANG : 0);
+        if (waitPid == pid || (waitPid < 0 && errno != EINTR)) {
+            break;
+        }
+    }
     if (waitPid < 0) {
         PM_LOG_ERROR("waitpid failed with error: %d", errno);
         return ret;
-    } else if (waitPid > 0) {
-        if (WIFEXITED(status)) {
-            PM_LOG_DEBUG("Process '%s' terminated normally: %d (exit code: %d)", cmd.c_str(), pid, WEXITSTATUS(status));
-            
-            output.clear();
-
-            char buffer[1024];
-            while ((bytesRead = read(out[0], buffer, sizeof(buffer) - 1)) > 0) {
-                buffer[bytesRead] = '\0';
-                output.append(buffer);
-            }                       
-
-            exitCode = WEXITSTATUS(status);
-            ret = 0;
-        } else if (WIFSIGNALED(status)) {
-            PM_LOG_ERROR( "Process '%s' terminated due to uncaught exception: %d", cmd.c_str(), pid);
-        } else if (WIFSTOPPED(status)) {
-            PM_LOG_ERROR( "Process '%s' stopped abnormally: %d", cmd.c_str(), pid);
-        } else {
-            PM_LOG_ERROR( "Process '%s' did not return: %d", cmd.c_str(), pid);
-        }
+    }
+
+    // What the child wrote before it exited; whatever its children write later is not waited for.
+    if (pipeOpen) {
+        (void)DrainPipe(out[0], output);
+    }
+
+    if (WIFEXITED(status)) {
+        PM_LOG_DEBUG("Process '%s' terminated normally: %d (exit code: %d)", cmd.c_str(), pid, WEXITSTATUS(status));
+        exitCode = WEXITSTATUS(status);
+        ret = 0;
+    } else if (WIFSIGNALED(status)) {
+        PM_LOG_ERROR( "Process '%s' terminated due to uncaught exception: %d", cmd.c_str(), pid);
+    } else if (WIFSTOPPED(status)) {
+        PM_LOG_ERROR( "Process '%s' stopped abnormally: %d", cmd.c_str(), pid);
+    } else {
+        PM_LOG_ERROR( "Process '%s' did not return: %d", cmd.c_str(), pid);
     }
 
     return ret;
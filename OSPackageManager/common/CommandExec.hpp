@@ -26,6 +26,17 @@ public:
      */
     int ExecuteCommandCaptureOutput(const std::string &cmd, const std::vector<std::string> &argv, int &exitCode, std::string &output) override;
 
+    /**
+     * @brief Executes a command and captures both stdout and stderr into a single buffer.
+     * @param cmd The command to execute.
+     * @param argv The arguments to the command.
+     * @param exitCode The exit code of the command.
+     * @param output The combined stdout/stderr output of the command, in the order it was written.
+     * @return 0 if the command was executed successfully.
+     * @note The output is drained while the child runs, so large outputs cannot stall the child on a full pipe.
+     */
+    int ExecuteCommandCaptureCombinedOutput(const std::string &cmd, const std::vector<std::string> &argv, int &exitCode, std::string &output) override;
+
     /**
      * @brief Parses the output of a command.
      * @param output The output of the command.
@@ -33,4 +44,12 @@ public:
      * @return void
      */
     void ParseOutput(const std::string &output, std::vector<std::string> &outputLines) override;
+
+private:
+    /**
+     * @brief Executes a command and captures its stdout, and its stderr too if mergeStderr is set.
+     * @note The output is drained while the child runs, so large outputs cannot stall the child on a full pipe.
+     *       Returns once the child exited, even if a process it started still holds the pipe open.
+     */
+    int ExecuteCommandCapture(const std::string &cmd, const std::vector<std::string> &argv, bool mergeStderr, int &exitCode, std::string &output);
 };
\ No newline at end of file
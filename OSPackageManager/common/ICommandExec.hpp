@@ -27,6 +27,16 @@ public:
      */
     virtual int ExecuteCommandCaptureOutput(const std::string &cmd, const std::vector<std::string> &argv, int &exitCode, std::string &output) = 0;
 
+    /**
+     * @brief Executes a command and captures both stdout and stderr into a single buffer.
+     * @param cmd The command to execute.
+     * @param argv The arguments to the command.
+     * @param exitCode The exit code of the command.
+     * @param output The combined stdout/stderr output of the command, in the order it was written.
+     * @return 0 if the command was executed successfully.
+     */
+    virtual int ExecuteCommandCaptureCombinedOutput(const std::string &cmd, const std::vector<std::string> &argv, int &exitCode, std::string &output) = 0;
+
     /**
      * @brief Parses the output of a command.
      * @param output The output of the command.
@@ -7,13 +7,43 @@
 #pragma once
 
 #include <filesystem>
+#include <memory>
+#include <string>
 #include <vector>
 
 namespace PackageManager
 {
 
+/**
+ * @brief Wildcard searches answered from directory contents cached for the lifetime of the object.
+ *        Meant for a burst of searches, such as one discovery pass, that may read the same directories.
+ */
+class IDirectorySnapshot{
+public:
+    virtual ~IDirectorySnapshot() = default;
+
+    virtual int32_t FileSearchWithWildCard(const std::filesystem::path& searchPath, std::vector<std::filesystem::path>& results) = 0;
+
+    /**
+     * @brief Appends existing matches of a pattern as they are found and stops walking once maxResults were
+     *        appended. "**" as a whole path component matches any number of directories.
+     * @param maxResults Most matches to append, 0 for no limit.
+     */
+    virtual int32_t FindWildCardMatches(const std::filesystem::path& searchPath, size_t maxResults, std::vector<std::filesystem::path>& results) = 0;
+};
+
+/**
+ * @brief Permission changes applied by IFileUtilities::ApplyRestrictions().
+ */
+enum class PathRestriction {
+    Admins, /**< Owner read and write, no write or execute for group and others, see ApplyAdminRestrictions(). */
+    Users   /**< Read for others, see ApplyUserRestrictions(). */
+};
+
 class IFileUtilities{
 public:
+    static constexpr int32_t kRestrictionsNotSupported = 1;
+
     IFileUtilities() = default;
     virtual ~IFileUtilities() = default;
 
@@ -25,6 +55,50 @@ public:
     virtual int32_t FileSearchWithWildCard(const std::filesystem::path& searchPath, std::vector<std::filesystem::path>& results) = 0;
     virtual std::string ResolvePath(const std::string& basePath) = 0;
     virtual std::string ResolveKnownFolderIdForDefaultUser(const std::string& knownFolderId) = 0;
+
+    /**
+     * @brief Creates an empty directory snapshot.
+     * @return nullptr if not supported, callers then use FileSearchWithWildCard().
+     */
+    virtual std::unique_ptr<IDirectorySnapshot> CreateDirectorySnapshot() { return nullptr; }
+
+    /**
+     * @brief Same as FileSearchWithWildCard(), leaving out matches that do not pass PathIsValid() and stopping
+     *        once maxResults matches were appended (0 for no limit).
+     * @note  Implementations that walk the file system themselves stop early and support "**" as in
+     *        IDirectorySnapshot::FindWildCardMatches(); this fallback searches everything first.
+     */
+    virtual int32_t FindWildCardMatches(const std::filesystem::path& searchPath, size_t maxResults, std::vector<std::filesystem::path>& results) {
+        std::vector<std::filesystem::path> matches;
+        const int32_t result = FileSearchWithWildCard(searchPath, matches);
+        size_t appended = 0;
+        for (auto& match : matches) {
+            if (maxResults != 0 && appended == maxResults)
+                break;
+            if (PathIsValid(match)) {
+                results.push_back(std::move(match));
+                ++appended;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Resolves a path containing per-user known folders once for every logged-in user.
+     * @return One path per user, empty if the path does not depend on the user, cannot be resolved or if
+     *         not supported. Callers then use ResolvePath().
+     */
+    virtual std::vector<std::string> ResolvePathForAllUsers(const std::string& /*basePath*/) { return {}; }
+
+    /**
+     * @brief Checks and applies a restriction deciding on each path with a single open and stat, optionally
+     *        for everything below a directory as well.
+     * @return 0 on success, -1 on failure, kRestrictionsNotSupported if not supported. Callers then use the
+     *         Has*RestrictionsApplied() and Apply*Restrictions() functions.
+     */
+    virtual int32_t ApplyRestrictions(const std::filesystem::path& /*filePath*/, PathRestriction /*restriction*/, bool /*recursive*/) {
+        return kRestrictionsNotSupported;
+    }
 };
 
 }
@@ -1,9 +1,30 @@
 #include "PackageManager/PmTypes.h"
+#include <cstdint>
+#include <memory>
+
+/**
+ * @brief Products that changed between the last two discoveries.
+ */
+struct PackageInventoryDelta {
+    uint64_t inventoryGeneration = 0;   /**< Increments whenever a discovery produced a different inventory. */
+    bool complete = false;              /**< False if changes are not tracked: every product must be treated as changed. */
+    std::vector<std::string> addedProducts;
+    std::vector<std::string> removedProducts;
+    std::vector<std::string> changedProducts;   /**< Products whose version, configurables or configurable contents differ. */
+    size_t reusedRuleResults = 0;       /**< Catalog rules answered from the previous discovery. */
+
+    bool IsEmpty() const { return complete && addedProducts.empty() && removedProducts.empty() && changedProducts.empty(); }
+};
 
 class IPmPlatformDiscovery {
 public:
     virtual ~IPmPlatformDiscovery() = default;
     virtual PackageInventory DiscoverInstalledPackages( const std::vector<PmProductDiscoveryRules> &catalogRules ) = 0;
-    virtual PackageInventory CachedInventory() const = 0;
+    /**
+     * @brief Returns the inventory published by the last discovery. Never null; the inventory is immutable
+     *        and stays valid for as long as the caller holds it, even while a new discovery is published.
+     */
+    virtual std::shared_ptr<const PackageInventory> CachedInventory() const = 0;
+    virtual PackageInventoryDelta LastInventoryDelta() const { return {}; }
 };
 
@@ -0,0 +1,118 @@
+#include "AtomicFileWriter.hpp"
+#include "PmLogger.hpp"
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef RENAME_NOREPLACE
+#define RENAME_NOREPLACE (1 << 0)
+#endif
+
+namespace { //anonymous namespace
+    const int maxTemporaryNameAttempts = 16;
+    std::atomic<unsigned> temporaryCounter {0};
+
+    struct FdCloser {
+        int fd;
+        ~FdCloser() {
+            if (fd >= 0) {
+                (void)close(fd);
+            }
+        }
+    };
+
+    // glibc only wraps renameat2() from 2.28 on.
+    int RenameAt2(int dirFd, const char* oldName, const char* newName, unsigned int flags) {
+        if (syscall(SYS_renameat2, dirFd, oldName, dirFd, newName, flags) == 0) {
+            return 0;
+        }
+        // Kernels or file systems without renameat2() flags.
+        if (errno == ENOSYS || errno == EINVAL) {
+            return renameat(dirFd, oldName, dirFd, newName);
+        }
+        return -1;
+    }
+}
+
+namespace PackageManager
+{
+
+bool AtomicFileWriter::Write(const std::filesystem::path& target, const std::string& contents, const Options& options) {
+    const std::filesystem::path directory = target.has_parent_path() ? target.parent_path() : std::filesystem::path(".");
+    const FdCloser dirFd {open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+    if (dirFd.fd < 0) {
+        PM_LOG_ERROR("Unable to open %s: %d", directory.c_str(), errno);
+        return false;
+    }
+    return WriteAt(dirFd.fd, target, contents, options);
+}
+
+bool AtomicFileWriter::WriteAt(int dirFd, const std::filesystem::path& target, const std::string& contents, const Options& options) {
+    const std::string name = target.filename().string();
+    std::string temporaryName;
+    const FdCloser temporaryFd {WriteTemporary(dirFd, name, contents, temporaryName)};
+    if (temporaryFd.fd < 0) {
+        return false;
+    }
+
+    bool prepared = fchmod(temporaryFd.fd, options.mode) == 0;
+    if (prepared && (options.uid != static_cast<uid_t>(-1) || options.gid != static_cast<gid_t>(-1))) {
+        prepared = fchown(temporaryFd.fd, options.uid, options.gid) == 0;
+    }
+    if (!prepared) {
+        PM_LOG_ERROR("Unable to set the permissions of %s: %d", target.c_str(), errno);
+        (void)unlinkat(dirFd, temporaryName.c_str(), 0);
+        return false;
+    }
+
+    if (RenameAt2(dirFd, temporaryName.c_str(), name.c_str(), options.replace ? 0 : RENAME_NOREPLACE) != 0) {
+        PM_LOG_ERROR("Unable to move the new %s into place: %d", target.c_str(), errno);
+        (void)unlinkat(dirFd, temporaryName.c_str(), 0);
+        return false;
+    }
+    // Without it the rename may not survive a crash, even though the contents would.
+    if (fsync(dirFd) != 0) {
+        PM_LOG_WARNING("Unable to sync the directory of %s: %d", target.c_str(), errno);
+    }
+    return true;
+}
+
+int AtomicFileWriter::WriteTemporary(int dirFd, const std::string& name, const std::string& contents, std::string& temporaryName) {
+    int fd = -1;
+    for (int attempt = 0; fd < 0 && attempt < maxTemporaryNameAttempts; ++attempt) {
+        temporaryName = "." + name + ".tmp." + std::to_string(getpid()) + "." + std::to_string(temporaryCounter++);
+        fd = openat(dirFd, temporaryName.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, S_IRUSR | S_IWUSR);
+        if (fd < 0 && errno != EEXIST) {
+            break;
+        }
+    }
+    if (fd < 0) {
+        PM_LOG_ERROR("Unable to create a temporary file for %s: %d", name.c_str(), errno);
+        return -1;
+    }
+
+    size_t written = 0;
+    while (written < contents.size()) {
+        const ssize_t bytesWritten = write(fd, contents.data() + written, contents.size() - written);
+        if (bytesWritten < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytesWritten < 0) {
+            break;
+        }
+        written += static_cast<size_t>(bytesWritten);
+    }
+    // The rename only replaces the previous file once the new contents are on disk.
+    if (written < contents.size() || fsync(fd) != 0) {
+        PM_LOG_ERROR("Unable to write a temporary file for %s: %d", name.c_str(), errno);
+        (void)close(fd);
+        (void)unlinkat(dirFd, temporaryName.c_str(), 0);
+        return -1;
+    }
+    return fd;
+}
+
+}
@@ -0,0 +1,51 @@
+/**
+ * @file
+ *
+ * @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+ */
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <sys/types.h>
+
+namespace PackageManager
+{
+
+/**
+ * @brief Replaces files so that after a crash they hold either their old or their new contents, never a partial
+ *        or empty file.
+ *
+ * The contents are written to a temporary file in the target directory and synced, the file gets its mode and
+ * owner and is renamed over the target with renameat2(), and the directory is synced so the rename is durable.
+ * The temporary file is removed on failure.
+ */
+class AtomicFileWriter {
+public:
+    struct Options {
+        mode_t mode = 0600;
+        uid_t uid = static_cast<uid_t>(-1); /**< Owner of the file, -1 for the writer's. */
+        gid_t gid = static_cast<gid_t>(-1); /**< Group of the file, -1 for the writer's. */
+        bool replace = true;                /**< False to fail rather than replace a file created meanwhile. */
+    };
+
+    /**
+     * @param target Path of the file; its directory must exist.
+     */
+    static bool Write(const std::filesystem::path& target, const std::string& contents, const Options& options);
+
+    /**
+     * @brief Same as Write(), in a directory the caller opened already.
+     * @param dirFd Descriptor of the directory of target.
+     */
+    static bool WriteAt(int dirFd, const std::filesystem::path& target, const std::string& contents, const Options& options);
+
+private:
+    /**
+     * @brief Creates a temporary file next to the target and writes the contents to it.
+     * @return The descriptor of the synced temporary file, -1 on failure.
+     */
+    static int WriteTemporary(int dirFd, const std::string& name, const std::string& contents, std::string& temporaryName);
+};
+
+}
@@ -0,0 +1,202 @@
+#include "ConfigurableWatcher.hpp"
+#include "PmLogger.hpp"
+#include <errno.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace { //anonymous namespace
+    // Entries of a watched directory appearing, disappearing or being written, and the directory itself going away.
+    const uint32_t watchedEvents = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | IN_CLOSE_WRITE |
+        IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+}
+
+constexpr std::chrono::milliseconds ConfigurableWatcher::kDefaultDebounce;
+
+ConfigurableWatcher::ConfigurableWatcher(std::chrono::milliseconds debounce, std::function<void()> onChange)
+    : debounce_(debounce), onChange_(std::move(onChange)) {
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    stopFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (inotifyFd_ < 0 || stopFd_ < 0) {
+        PM_LOG_WARNING("Unable to watch configurables (%d), every discovery re-checks them", errno);
+        if (inotifyFd_ >= 0) {
+            (void)close(inotifyFd_);
+            inotifyFd_ = -1;
+        }
+        return;
+    }
+    thread_ = std::thread(&ConfigurableWatcher::Run, this);
+}
+
+ConfigurableWatcher::~ConfigurableWatcher() {
+    if (thread_.joinable()) {
+        const uint64_t stop = 1;
+        (void)write(stopFd_, &stop, sizeof(stop));
+        thread_.join();
+    }
+    if (inotifyFd_ >= 0) {
+        (void)close(inotifyFd_);
+    }
+    if (stopFd_ >= 0) {
+        (void)close(stopFd_);
+    }
+}
+
+bool ConfigurableWatcher::IsWatching() const {
+    return inotifyFd_ >= 0;
+}
+
+void ConfigurableWatcher::Watch(const std::set<std::string>& directories) {
+    if (inotifyFd_ < 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = watchesByDirectory_.begin(); it != watchesByDirectory_.end(); ) {
+        if (directories.count(it->first) == 0) {
+            (void)inotify_rm_watch(inotifyFd_, it->second);
+            directoriesByWatch_.erase(it->second);
+            it = watchesByDirectory_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (const auto& directory : directories) {
+        if (watchesByDirectory_.count(directory) != 0) {
+            continue;
+        }
+        const int watch = inotify_add_watch(inotifyFd_, directory.c_str(), watchedEvents);
+        if (watch < 0) {
+            if (errno == ENOSPC) {
+                PM_LOG_WARNING("inotify watch limit reached, %s is not watched", directory.c_str());
+            }
+            continue;
+        }
+        // Two paths of the same directory share a watch; the first one is reported.
+        if (directoriesByWatch_.emplace(watch, directory).second) {
+            watchesByDirectory_.emplace(directory, watch);
+        }
+    }
+}
+
+ConfigurableWatcher::Changes ConfigurableWatcher::TakeChanges() {
+    Changes changes;
+    if (inotifyFd_ < 0) {
+        return changes;
+    }
+
+    // Events queued before this call must not be attributed to the next one.
+    DrainEvents();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    changes.complete = !overflow_;
+    changes.dirtyDirectories.swap(dirtyDirectories_);
+    for (const auto& watched : watchesByDirectory_) {
+        changes.watchedDirectories.insert(watched.first);
+    }
+    overflow_ = false;
+    return changes;
+}
+
+void ConfigurableWatcher::Mute(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++mutedDirectories_[directory];
+}
+
+void ConfigurableWatcher::Unmute(const std::string& directory) {
+    // inotify queues events when the change is made, so whatever the muted caller changed is queued by now.
+    if (inotifyFd_ >= 0) {
+        DrainEvents();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto muted = mutedDirectories_.find(directory);
+    if (muted != mutedDirectories_.end() && --muted->second == 0) {
+        mutedDirectories_.erase(muted);
+    }
+}
+
+void ConfigurableWatcher::DrainEvents() {
+    std::lock_guard<std::mutex> drainLock(drainMutex_);
+    alignas(struct inotify_event) char buffer[4096];
+    bool unmutedChange = false;
+
+    while (true) {
+        const ssize_t length = read(inotifyFd_, buffer, sizeof(buffer));
+        if (length < 0 && errno == EINTR) {
+            continue;
+        }
+        if (length <= 0) {
+            break;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (ssize_t offset = 0; offset < length; ) {
+            const auto* event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+            offset += static_cast<ssize_t>(sizeof(struct inotify_event) + event->len);
+
+            const bool allMuted = mutedDirectories_.count({}) != 0;
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflow_ = true;
+                unmutedChange = unmutedChange || !allMuted;
+                continue;
+            }
+            const auto directory = directoriesByWatch_.find(event->wd);
+            if (directory == directoriesByWatch_.end()) {
+                continue;
+            }
+            dirtyDirectories_.insert(directory->second);
+            unmutedChange = unmutedChange || (!allMuted && mutedDirectories_.count(directory->second) == 0);
+            // The kernel dropped the watch (directory deleted or unmounted).
+            if (event->mask & IN_IGNORED) {
+                watchesByDirectory_.erase(directory->second);
+                directoriesByWatch_.erase(directory);
+            }
+        }
+    }
+
+    if (unmutedChange) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pendingNotification_ = true;
+        lastEvent_ = std::chrono::steady_clock::now();
+    }
+}
+
+void ConfigurableWatcher::Run() {
+    struct pollfd fds[2] = {{inotifyFd_, POLLIN, 0}, {stopFd_, POLLIN, 0}};
+
+    while (true) {
+        int timeoutMs = -1;
+        bool notify = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (pendingNotification_) {
+                const auto quiet = std::chrono::steady_clock::now() - lastEvent_;
+                if (quiet >= debounce_) {
+                    pendingNotification_ = false;
+                    notify = true;
+                } else {
+                    timeoutMs = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(debounce_ - quiet).count()) + 1;
+                }
+            }
+        }
+        if (notify && onChange_) {
+            PM_LOG_DEBUG("Watched configurables changed");
+            onChange_();
+        }
+
+        const int ready = poll(fds, 2, timeoutMs);
+        if (ready < 0 && errno != EINTR) {
+            PM_LOG_ERROR("Configurable watch failed: %d", errno);
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            break;
+        }
+        if (fds[0].revents & POLLIN) {
+            DrainEvents();
+        }
+    }
+}
@@ -0,0 +1,94 @@
+/**
+ * @file
+ *
+ * @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+ */
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+/**
+ * @brief Watches the directories that discovered configurables depend on, so that discovery only has to
+ *        re-check the rules whose directories saw changes.
+ *
+ * A background thread drains inotify events and marks the watched directory they occurred in as dirty.
+ * Events are coalesced: the change handler runs once the watched directories have been quiet for the
+ * debounce window. When the kernel queue overflows every directory counts as dirty.
+ */
+class ConfigurableWatcher {
+public:
+    /**
+     * @brief Directories that changed since the previous TakeChanges().
+     */
+    struct Changes {
+        bool complete = false;  /**< False if changes were lost: every directory must be treated as dirty. */
+        std::unordered_set<std::string> dirtyDirectories;
+        std::unordered_set<std::string> watchedDirectories; /**< Watched now; later changes in them will be recorded. */
+    };
+
+    static constexpr std::chrono::milliseconds kDefaultDebounce{5000};
+
+    /**
+     * @param debounce How long watched directories have to be quiet before the change handler runs.
+     * @param onChange Called on the watcher thread after a burst of changes, may be empty.
+     */
+    explicit ConfigurableWatcher(
+        std::chrono::milliseconds debounce = kDefaultDebounce,
+        std::function<void()> onChange = {});
+    ~ConfigurableWatcher();
+
+    ConfigurableWatcher(const ConfigurableWatcher&) = delete;
+    ConfigurableWatcher& operator=(const ConfigurableWatcher&) = delete;
+
+    /**
+     * @brief Returns true if inotify is available.
+     */
+    bool IsWatching() const;
+
+    /**
+     * @brief Replaces the set of watched directories. Directories that cannot be watched are skipped.
+     */
+    void Watch(const std::set<std::string>& directories);
+
+    /**
+     * @brief Returns and clears the changes recorded since the previous call.
+     */
+    Changes TakeChanges();
+
+    /**
+     * @brief Stops changes in a directory, or in every directory if it is empty, from running the change
+     *        handler until the matching Unmute(). The changes are still recorded. Mutes nest.
+     */
+    void Mute(const std::string& directory);
+
+    /**
+     * @brief Ends a Mute(). Changes made while muted are drained first, so they do not run the change handler.
+     */
+    void Unmute(const std::string& directory);
+
+private:
+    void Run();
+    void DrainEvents();
+
+    const std::chrono::milliseconds debounce_;
+    const std::function<void()> onChange_;
+    int inotifyFd_ = -1;
+    int stopFd_ = -1;
+    mutable std::mutex mutex_;
+    std::unordered_map<int, std::string> directoriesByWatch_;
+    std::unordered_map<std::string, int> watchesByDirectory_;
+    std::unordered_set<std::string> dirtyDirectories_;
+    std::unordered_map<std::string, size_t> mutedDirectories_; /**< Mute count of each directory, "" for all of them. */
+    std::mutex drainMutex_; /**< Serializes reading and recording events, so none is recorded after an Unmute() drained. */
+    bool overflow_ = false;
+    bool pendingNotification_ = false;
+    std::chrono::steady_clock::time_point lastEvent_;
+    std::thread thread_;
+};
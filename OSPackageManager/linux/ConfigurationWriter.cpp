@@ -0,0 +1,107 @@
+#include "ConfigurationWriter.hpp"
+#include "AtomicFileWriter.hpp"
+#include "FileFingerprintCache.hpp"
+#include "PathPermissions.hpp"
+#include "PmLogger.hpp"
+#include <algorithm>
+#include <cctype>
+#include <errno.h>
+#include <fcntl.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace { //anonymous namespace
+    const mode_t newConfigurationMode = 0644;
+
+    struct FdCloser {
+        int fd;
+        ~FdCloser() {
+            if (fd >= 0) {
+                (void)close(fd);
+            }
+        }
+    };
+}
+
+namespace PackageManager
+{
+
+ConfigurationWriter::Result ConfigurationWriter::Write(const std::filesystem::path& target, const std::string& contents, const std::string& expectedSha256) {
+    if (!target.is_absolute() || !target.has_filename()) {
+        PM_LOG_ERROR("Invalid configuration path %s", target.c_str());
+        return Result::Failed;
+    }
+
+    // With an expected digest, an unchanged file costs hashing the file alone; the contents are checked
+    // against it only before they are written.
+    std::string digest = expectedSha256;
+    std::transform(digest.begin(), digest.end(), digest.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+    if (digest.empty() && !FileFingerprintCache::Sha256(contents.data(), contents.size(), digest)) {
+        PM_LOG_ERROR("Unable to hash the contents of %s", target.c_str());
+        return Result::Failed;
+    }
+
+    const std::filesystem::path directory = target.parent_path();
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    const FdCloser dirFd {open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+    if (dirFd.fd < 0) {
+        PM_LOG_ERROR("Unable to open %s: %d", directory.c_str(), errno);
+        return Result::Failed;
+    }
+
+    const std::string name = target.filename().string();
+    struct stat existingStat {};
+    bool exists = false;
+    {
+        const FdCloser existingFd {openat(dirFd.fd, name.c_str(), O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_CLOEXEC)};
+        if (existingFd.fd >= 0) {
+            if (fstat(existingFd.fd, &existingStat) != 0 || !S_ISREG(existingStat.st_mode)) {
+                PM_LOG_ERROR("Refusing to replace %s, it is not a regular file", target.c_str());
+                return Result::Failed;
+            }
+            exists = true;
+            if (HasContents(existingFd.fd, existingStat, contents.size(), digest)) {
+                return Result::Unchanged;
+            }
+        } else if (errno == ELOOP) {
+            PM_LOG_ERROR("Refusing to replace symbolic link %s", target.c_str());
+            return Result::Failed;
+        } else if (errno != ENOENT) {
+            PM_LOG_ERROR("Unable to open %s: %d", target.c_str(), errno);
+            return Result::Failed;
+        }
+    }
+
+    if (!expectedSha256.empty()) {
+        std::string contentsDigest;
+        if (!FileFingerprintCache::Sha256(contents.data(), contents.size(), contentsDigest) || contentsDigest != digest) {
+            PM_LOG_ERROR("Contents of %s do not have the expected digest %s", target.c_str(), expectedSha256.c_str());
+            return Result::Failed;
+        }
+    }
+
+    // The replacement keeps the owner of the file it replaces, and its mode restricted to admins.
+    AtomicFileWriter::Options options;
+    options.mode = PathPermissions::RestrictedMode(exists ? (existingStat.st_mode & 07777) : newConfigurationMode, PathRestriction::Admins);
+    if (exists && (existingStat.st_uid != geteuid() || existingStat.st_gid != getegid())) {
+        options.uid = existingStat.st_uid;
+        options.gid = existingStat.st_gid;
+    }
+    // A file created meanwhile by someone else is not replaced.
+    options.replace = exists;
+    if (!AtomicFileWriter::WriteAt(dirFd.fd, target, contents, options)) {
+        return Result::Failed;
+    }
+    return Result::Written;
+}
+
+bool ConfigurationWriter::HasContents(int fd, const struct stat& fileStat, size_t size, const std::string& sha256) {
+    if (static_cast<uint64_t>(fileStat.st_size) != size) {
+        return false;
+    }
+    std::string digest;
+    return FileFingerprintCache::Sha256(fd, digest) && digest == sha256;
+}
+
+}
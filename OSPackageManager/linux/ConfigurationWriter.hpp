@@ -0,0 +1,44 @@
+/**
+ * @file
+ *
+ * @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+ */
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <sys/stat.h>
+
+namespace PackageManager
+{
+
+/**
+ * @brief Replaces configuration files atomically, and only when their contents change.
+ *
+ * The existing file is compared first, by size and then by SHA-256 digest; an identical file is left untouched,
+ * so its watchers see no event. Otherwise the file is replaced through AtomicFileWriter, keeping the mode
+ * (restricted to admins) and owner of the file it replaces. Readers see either the old or the new file, never a
+ * partial one. Symbolic links are never followed at the target.
+ */
+class ConfigurationWriter {
+public:
+    enum class Result {
+        Written,
+        Unchanged,
+        Failed
+    };
+
+    /**
+     * @param target Absolute path of the configuration file; missing parent directories are created.
+     * @param expectedSha256 Hex SHA-256 digest the contents must have, in either case; not checked if empty.
+     */
+    static Result Write(const std::filesystem::path& target, const std::string& contents, const std::string& expectedSha256);
+
+private:
+    /**
+     * @brief Returns true if the opened file holds exactly the contents with the given digest.
+     */
+    static bool HasContents(int fd, const struct stat& fileStat, size_t size, const std::string& sha256);
+};
+
+}
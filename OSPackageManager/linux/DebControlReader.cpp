@@ -0,0 +1,467 @@
+#include "DebControlReader.hpp"
+#include "PmLogger.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <lzma.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace { //anonymous namespace
+    const std::string arMagic {"!<arch>\n"};
+    const size_t arHeaderSize = 60;
+    const size_t arNameLength = 16;
+    const size_t arSizeOffset = 48;
+    const size_t arSizeLength = 10;
+    const std::string controlTarMember {"control.tar"};
+    const std::string dataTarMember {"data.tar"};
+    const std::string controlFileName {"control"};
+    const size_t tarBlockSize = 512;
+    const size_t tarSizeOffset = 124;
+    const size_t tarSizeLength = 12;
+    const size_t tarTypeOffset = 156;
+    const size_t tarPrefixOffset = 345;
+    const size_t tarPrefixLength = 155;
+    const size_t tarNameLength = 100;
+    const char tarTypeRegular = '0';
+    const char tarTypeRegularOld = '\0';
+    const char tarTypeGnuLongName = 'L';
+    const size_t readChunkSize = 64 * 1024;
+    const uint64_t maxControlTarSize = 64 * 1024 * 1024; // Upper bound on the decompressed control tarball.
+    const std::string zstdLibPath {"libzstd.so.1"};
+
+    // Subset of the libzstd streaming API, resolved at runtime (zstd.h is not needed to build).
+    struct ZstdInBuffer { const void* src; size_t size; size_t pos; };
+    struct ZstdOutBuffer { void* dst; size_t size; size_t pos; };
+    typedef void* (*fpZstdCreateDStream_t)(void);
+    typedef size_t (*fpZstdFreeDStream_t)(void*);
+    typedef size_t (*fpZstdInitDStream_t)(void*);
+    typedef size_t (*fpZstdDecompressStream_t)(void*, ZstdOutBuffer*, ZstdInBuffer*);
+    typedef unsigned (*fpZstdIsError_t)(size_t);
+
+    struct ZstdLibrary {
+        fpZstdCreateDStream_t createDStream = nullptr;
+        fpZstdFreeDStream_t freeDStream = nullptr;
+        fpZstdInitDStream_t initDStream = nullptr;
+        fpZstdDecompressStream_t decompressStream = nullptr;
+        fpZstdIsError_t isError = nullptr;
+
+        ZstdLibrary() {
+            // The handle is intentionally kept for the lifetime of the process.
+            void* handle = dlopen(zstdLibPath.c_str(), RTLD_NOW);
+            if (!handle) {
+                PM_LOG_WARNING("Failed to load libzstd, zstd compressed packages cannot be inspected: %s", dlerror());
+                return;
+            }
+            createDStream = reinterpret_cast<fpZstdCreateDStream_t>(dlsym(handle, "ZSTD_createDStream"));
+            freeDStream = reinterpret_cast<fpZstdFreeDStream_t>(dlsym(handle, "ZSTD_freeDStream"));
+            initDStream = reinterpret_cast<fpZstdInitDStream_t>(dlsym(handle, "ZSTD_initDStream"));
+            decompressStream = reinterpret_cast<fpZstdDecompressStream_t>(dlsym(handle, "ZSTD_decompressStream"));
+            isError = reinterpret_cast<fpZstdIsError_t>(dlsym(handle, "ZSTD_isError"));
+        }
+
+        bool isLoaded() const {
+            return createDStream && freeDStream && initDStream && decompressStream && isError;
+        }
+    };
+
+    const ZstdLibrary& zstdLibrary() {
+        static const ZstdLibrary library;
+        return library;
+    }
+
+    // Incremental tar parser fed with the decompressed control tarball. It only keeps the 'control' member.
+    class ControlTarExtractor {
+    public:
+        explicit ControlTarExtractor(std::string& control) : control_(control) {}
+
+        // Returns false once parsing is finished, either because 'control' was extracted or the tarball ended.
+        bool consume(const char* data, size_t length) {
+            totalBytes_ += length;
+            if (totalBytes_ > maxControlTarSize) {
+                PM_LOG_ERROR("Control tarball exceeds %llu bytes", static_cast<unsigned long long>(maxControlTarSize));
+                done_ = true;
+            }
+
+            while (length > 0 && !done_) {
+                size_t count = 0;
+                if (skip_ > 0) {
+                    count = static_cast<size_t>(std::min<uint64_t>(skip_, length));
+                    skip_ -= count;
+                } else if (remaining_ > 0) {
+                    count = static_cast<size_t>(std::min<uint64_t>(remaining_, length));
+                    target_->append(data, count);
+                    remaining_ -= count;
+                    if (remaining_ == 0) {
+                        finishEntry();
+                    }
+                } else {
+                    count = std::min(tarBlockSize - header_.size(), length);
+                    header_.append(data, count);
+                    if (header_.size() == tarBlockSize) {
+                        parseHeader();
+                        header_.clear();
+                    }
+                }
+                data += count;
+                length -= count;
+            }
+            return !done_;
+        }
+
+        bool found() const {
+            return found_;
+        }
+
+    private:
+        std::string& control_;
+        std::string header_;
+        std::string longName_;
+        std::string* target_ = nullptr;
+        uint64_t remaining_ = 0;
+        uint64_t skip_ = 0;
+        uint64_t padding_ = 0;
+        uint64_t totalBytes_ = 0;
+        bool done_ = false;
+        bool found_ = false;
+
+        static std::string field(const std::string& block, size_t offset, size_t length) {
+            std::string value = block.substr(offset, length);
+            return value.substr(0, value.find('\0'));
+        }
+
+        static uint64_t parseOctal(const std::string& value) {
+            uint64_t result = 0;
+            for (char c : value) {
+                if (c >= '0' && c <= '7') {
+                    result = (result << 3) + static_cast<uint64_t>(c - '0');
+                } else if (c != ' ') {
+                    break;
+                }
+            }
+            return result;
+        }
+
+        void finishEntry() {
+            if (target_ == &control_) {
+                found_ = true;
+                done_ = true;
+            }
+            target_ = nullptr;
+            skip_ = padding_;
+        }
+
+        void parseHeader() {
+            if (std::all_of(header_.begin(), header_.end(), [](char c) { return c == '\0'; })) {
+                done_ = true; // End of archive marker
+                return;
+            }
+
+            std::string name = longName_.empty() ? field(header_, 0, tarNameLength) : longName_.substr(0, longName_.find('\0'));
+            if (longName_.empty()) {
+                const std::string prefix = field(header_, tarPrefixOffset, tarPrefixLength);
+                if (!prefix.empty()) {
+                    name = prefix + "/" + name;
+                }
+            }
+            const uint64_t size = parseOctal(header_.substr(tarSizeOffset, tarSizeLength));
+            const char type = header_[tarTypeOffset];
+            padding_ = (tarBlockSize - size % tarBlockSize) % tarBlockSize;
+
+            if (type == tarTypeGnuLongName) {
+                longName_.clear();
+                target_ = &longName_;
+                remaining_ = size;
+                return;
+            }
+            longName_.clear();
+
+            if (name.compare(0, 2, "./") == 0) {
+                name.erase(0, 2);
+            }
+            if (name == controlFileName && (type == tarTypeRegular || type == tarTypeRegularOld)) {
+                control_.clear();
+                target_ = &control_;
+                remaining_ = size;
+                if (size == 0) {
+                    finishEntry();
+                }
+                return;
+            }
+            skip_ = size + padding_;
+        }
+    };
+
+    bool readFully(int fd, char* buffer, size_t length) {
+        while (length > 0) {
+            ssize_t bytesRead = read(fd, buffer, length);
+            if (bytesRead < 0 && errno == EINTR) {
+                continue;
+            }
+            if (bytesRead <= 0) {
+                return false;
+            }
+            buffer += bytesRead;
+            length -= static_cast<size_t>(bytesRead);
+        }
+        return true;
+    }
+
+    // Reads the next chunk of the current ar member, at most 'remaining' bytes.
+    ssize_t readMemberChunk(int fd, std::vector<char>& buffer, uint64_t& remaining) {
+        const size_t wanted = static_cast<size_t>(std::min<uint64_t>(remaining, buffer.size()));
+        ssize_t bytesRead = 0;
+        do {
+            bytesRead = read(fd, buffer.data(), wanted);
+        } while (bytesRead < 0 && errno == EINTR);
+        if (bytesRead > 0) {
+            remaining -= static_cast<uint64_t>(bytesRead);
+        }
+        return bytesRead;
+    }
+
+    bool extractFromPlain(int fd, uint64_t memberSize, ControlTarExtractor& extractor) {
+        std::vector<char> in(readChunkSize);
+        while (memberSize > 0) {
+            ssize_t bytesRead = readMemberChunk(fd, in, memberSize);
+            if (bytesRead <= 0) {
+                return false;
+            }
+            if (!extractor.consume(in.data(), static_cast<size_t>(bytesRead))) {
+                break;
+            }
+        }
+        return extractor.found();
+    }
+
+    bool extractFromGzip(int fd, uint64_t memberSize, ControlTarExtractor& extractor) {
+        z_stream stream = {};
+        if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+            PM_LOG_ERROR("inflateInit2 failed");
+            return false;
+        }
+        auto streamDeleter = [](z_stream* s) { inflateEnd(s); };
+        std::unique_ptr<z_stream, decltype(streamDeleter)> streamPtr(&stream, streamDeleter);
+
+        std::vector<char> in(readChunkSize);
+        std::vector<char> out(readChunkSize);
+        bool streamEnd = false;
+        while (memberSize > 0 && !streamEnd) {
+            ssize_t bytesRead = readMemberChunk(fd, in, memberSize);
+            if (bytesRead <= 0) {
+                return false;
+            }
+            stream.next_in = reinterpret_cast<Bytef*>(in.data());
+            stream.avail_in = static_cast<uInt>(bytesRead);
+            do {
+                stream.next_out = reinterpret_cast<Bytef*>(out.data());
+                stream.avail_out = static_cast<uInt>(out.size());
+                int ret = inflate(&stream, Z_NO_FLUSH);
+                if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+                    PM_LOG_ERROR("Failed to inflate control tarball: %d", ret);
+                    return false;
+                }
+                streamEnd = (ret == Z_STREAM_END);
+                if (!extractor.consume(out.data(), out.size() - stream.avail_out)) {
+                    return extractor.found();
+                }
+            } while (stream.avail_out == 0 && !streamEnd);
+        }
+        return extractor.found();
+    }
+
+    bool extractFromXz(int fd, uint64_t memberSize, ControlTarExtractor& extractor) {
+        lzma_stream stream = LZMA_STREAM_INIT;
+        if (lzma_stream_decoder(&stream, UINT64_MAX, 0) != LZMA_OK) {
+            PM_LOG_ERROR("lzma_stream_decoder failed");
+            return false;
+        }
+        auto streamDeleter = [](lzma_stream* s) { lzma_end(s); };
+        std::unique_ptr<lzma_stream, decltype(streamDeleter)> streamPtr(&stream, streamDeleter);
+
+        std::vector<char> in(readChunkSize);
+        std::vector<char> out(readChunkSize);
+        bool streamEnd = false;
+        while (memberSize > 0 && !streamEnd) {
+            ssize_t bytesRead = readMemberChunk(fd, in, memberSize);
+            if (bytesRead <= 0) {
+                return false;
+            }
+            stream.next_in = reinterpret_cast<const uint8_t*>(in.data());
+            stream.avail_in = static_cast<size_t>(bytesRead);
+            do {
+                stream.next_out = reinterpret_cast<uint8_t*>(out.data());
+                stream.avail_out = out.size();
+                lzma_ret ret = lzma_code(&stream, LZMA_RUN);
+                if (ret != LZMA_OK && ret != LZMA_STREAM_END && ret != LZMA_BUF_ERROR) {
+                    PM_LOG_ERROR("Failed to decompress control tarball: %d", ret);
+                    return false;
+                }
+                streamEnd = (ret == LZMA_STREAM_END);
+                if (!extractor.consume(out.data(), out.size() - stream.avail_out)) {
+                    return extractor.found();
+                }
+            } while (stream.avail_out == 0 && !streamEnd);
+        }
+        return extractor.found();
+    }
+
+    bool extractFromZstd(int fd, uint64_t memberSize, ControlTarExtractor& extractor) {
+        const ZstdLibrary& zstd = zstdLibrary();
+        if (!zstd.isLoaded()) {
+            return false;
+        }
+        void* stream = zstd.createDStream();
+        if (!stream || zstd.isError(zstd.initDStream(stream))) {
+            PM_LOG_ERROR("Failed to initialize zstd decompression");
+            if (stream) {
+                zstd.freeDStream(stream);
+            }
+            return false;
+        }
+        auto streamDeleter = [&zstd](void* s) { zstd.freeDStream(s); };
+        std::unique_ptr<void, decltype(streamDeleter)> streamPtr(stream, streamDeleter);
+
+        std::vector<char> in(readChunkSize);
+        std::vector<char> out(readChunkSize);
+        while (memberSize > 0) {
+            ssize_t bytesRead = readMemberChunk(fd, in, memberSize);
+            if (bytesRead <= 0) {
+                return false;
+            }
+            ZstdInBuffer input = { in.data(), static_cast<size_t>(bytesRead), 0 };
+            do {
+                ZstdOutBuffer output = { out.data(), out.size(), 0 };
+                size_t ret = zstd.decompressStream(stream, &output, &input);
+                if (zstd.isError(ret)) {
+                    PM_LOG_ERROR("Failed to decompress control tarball");
+                    return false;
+                }
+                if (!extractor.consume(out.data(), output.pos)) {
+                    return extractor.found();
+                }
+                if (output.pos < output.size && input.pos == input.size) {
+                    break;
+                }
+            } while (true);
+        }
+        return extractor.found();
+    }
+
+    std::string trim(const std::string& value) {
+        const auto first = value.find_first_not_of(" \t\r");
+        if (first == std::string::npos) {
+            return {};
+        }
+        const auto last = value.find_last_not_of(" \t\r");
+        return value.substr(first, last - first + 1);
+    }
+}
+
+bool DebControlReader::readControlFile(const std::string& debPath, std::string& control) const {
+    int fd = open(debPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        PM_LOG_ERROR("Failed to open package %s: %d", debPath.c_str(), errno);
+        return false;
+    }
+    auto fdDeleter = [](int* f) { (void)close(*f); };
+    std::unique_ptr<int, decltype(fdDeleter)> fdPtr(&fd, fdDeleter);
+
+    char magic[8];
+    if (!readFully(fd, magic, sizeof(magic)) || arMagic.compare(0, arMagic.size(), magic, sizeof(magic)) != 0) {
+        PM_LOG_ERROR("Not a Debian archive: %s", debPath.c_str());
+        return false;
+    }
+
+    char header[arHeaderSize];
+    while (readFully(fd, header, sizeof(header))) {
+        std::string memberName = trim(std::string(header, arNameLength));
+        if (!memberName.empty() && memberName.back() == '/') {
+            memberName.pop_back(); // GNU ar terminates member names with '/'
+        }
+        const std::string sizeField = trim(std::string(header + arSizeOffset, arSizeLength));
+        if (sizeField.empty() || sizeField.find_first_not_of("0123456789") != std::string::npos) {
+            PM_LOG_ERROR("Corrupt ar member header in %s", debPath.c_str());
+            return false;
+        }
+        const uint64_t memberSize = std::stoull(sizeField);
+
+        if (memberName.compare(0, controlTarMember.size(), controlTarMember) == 0) {
+            const std::string compression = memberName.substr(controlTarMember.size());
+            ControlTarExtractor extractor(control);
+            bool extracted = false;
+            if (compression.empty()) {
+                extracted = extractFromPlain(fd, memberSize, extractor);
+            } else if (compression == ".gz") {
+                extracted = extractFromGzip(fd, memberSize, extractor);
+            } else if (compression == ".xz") {
+                extracted = extractFromXz(fd, memberSize, extractor);
+            } else if (compression == ".zst") {
+                extracted = extractFromZstd(fd, memberSize, extractor);
+            } else {
+                PM_LOG_ERROR("Unsupported control member %s in %s", memberName.c_str(), debPath.c_str());
+                return false;
+            }
+            if (!extracted) {
+                PM_LOG_ERROR("Failed to extract control file from %s", debPath.c_str());
+            }
+            return extracted;
+        }
+
+        if (memberName.compare(0, dataTarMember.size(), dataTarMember) == 0) {
+            break; // The control member always precedes the data member.
+        }
+
+        // ar members are aligned on even offsets.
+        if (lseek(fd, static_cast<off_t>(memberSize + (memberSize & 1)), SEEK_CUR) < 0) {
+            return false;
+        }
+    }
+
+    PM_LOG_ERROR("No control member found in %s", debPath.c_str());
+    return false;
+}
+
+bool DebControlReader::readPackageInfo(const std::string& debPath, PackageInfo& packageInfo) const {
+    std::string control;
+    if (!readControlFile(debPath, control)) {
+        return false;
+    }
+
+    const std::string packageName = getControlField(control, "Package");
+    const std::string packageVersion = getControlField(control, "Version");
+    const std::string packageArchitecture = getControlField(control, "Architecture");
+    if (packageName.empty() || packageVersion.empty()) {
+        PM_LOG_ERROR("Control file of %s has no Package or Version field", debPath.c_str());
+        return false;
+    }
+
+    packageInfo.packageIdentifier = packageName + "-" + packageVersion + "." + packageArchitecture;
+    packageInfo.packageName = packageName;
+    packageInfo.version = packageVersion;
+    packageInfo.architecture = packageArchitecture;
+    return true;
+}
+
+std::string DebControlReader::getControlField(const std::string& control, const std::string& fieldName) {
+    const std::string key = fieldName + ":";
+    size_t start = 0;
+    while (start < control.size()) {
+        size_t end = control.find('\n', start);
+        if (end == std::string::npos) {
+            end = control.size();
+        }
+        if (end == start) {
+            break; // A blank line ends the stanza.
+        }
+        if (control.compare(start, key.size(), key) == 0) {
+            return trim(control.substr(start + key.size(), end - start - key.size()));
+        }
+        start = end + 1;
+    }
+    return {};
+}
@@ -0,0 +1,47 @@
+/**
+ * @file
+ *
+ * @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+ */
+#pragma once
+
+#include "IPackageUtil.hpp"
+#include <string>
+
+/**
+ * @brief Reads the control information of a .deb archive in-process.
+ *
+ * A .deb is an 'ar' archive of 'debian-binary', 'control.tar[.gz|.xz|.zst]' and 'data.tar[.*]'. The reader walks
+ * the ar members, streams the control tarball through the matching decompressor and stops as soon as the
+ * 'control' file has been extracted. The data tarball is never read.
+ *
+ * gzip and xz are decoded with zlib and liblzma. zstd (the default of recent dpkg-deb) is decoded with
+ * libzstd loaded at runtime, so the reader reports a failure instead of crashing on systems without it.
+ */
+class DebControlReader {
+public:
+    DebControlReader() = default;
+    ~DebControlReader() = default;
+
+    /**
+     * @brief Extracts the contents of the 'control' file.
+     * @param debPath The path to the .deb archive.
+     * @param control Receives the control file contents.
+     * @return True if the control file was found and extracted.
+     */
+    bool readControlFile(const std::string& debPath, std::string& control) const;
+
+    /**
+     * @brief Reads the Package, Version and Architecture fields of a .deb archive.
+     * @param debPath The path to the .deb archive.
+     * @param packageInfo Receives the package info, with the identifier in the same
+     *        "<name>-<version>.<arch>" form as PackageUtilDEB::getPackageInfo().
+     * @return True if the archive has a control file with at least the Package and Version fields.
+     */
+    bool readPackageInfo(const std::string& debPath, PackageInfo& packageInfo) const;
+
+    /**
+     * @brief Returns the value of a field of a control stanza, or an empty string if it is missing.
+     */
+    static std::string getControlField(const std::string& control, const std::string& fieldName);
+};
@@ -0,0 +1,244 @@
+#include "DirectorySnapshot.hpp"
+#include "PmLogger.hpp"
+#include <algorithm>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <glob.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace { //anonymous namespace
+
+// Layout of the records returned by the getdents64 system call.
+struct LinuxDirent64 {
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+const size_t direntBufferSize = 32 * 1024;
+const char* const wildcardChars = "*?[\\";
+const std::string recursiveWildcard {"**"};
+
+std::string JoinPath(const std::string& base, const std::string& name) {
+    if (base.empty())
+        return name;
+    if (base.back() == '/')
+        return base + name;
+    return base + "/" + name;
+}
+
+}
+
+namespace PackageManager
+{
+
+int32_t DirectorySnapshot::FileSearchWithWildCard(const std::filesystem::path& searchPath, std::vector<std::filesystem::path>& results) {
+    const CompiledPattern& pattern = Compile(searchPath.generic_u8string());
+    if (pattern.root.empty() && pattern.components.empty())
+        return GLOB_NOMATCH;
+
+    std::vector<std::string> matches;
+    Expand(pattern, 0, pattern.root, matches);
+    if (matches.empty())
+        return GLOB_NOMATCH;
+
+    std::sort(matches.begin(), matches.end());
+    for (auto& match : matches) {
+        results.emplace_back(std::move(match));
+    }
+    return 0;
+}
+
+int32_t DirectorySnapshot::FindWildCardMatches(const std::filesystem::path& searchPath, size_t maxResults, std::vector<std::filesystem::path>& results) {
+    const CompiledPattern& pattern = Compile(searchPath.generic_u8string());
+    if (pattern.root.empty() && pattern.components.empty())
+        return GLOB_NOMATCH;
+
+    std::vector<std::string> matches;
+    (void)Stream(pattern, 0, pattern.root, maxResults, matches);
+    if (matches.empty())
+        return GLOB_NOMATCH;
+
+    for (auto& match : matches) {
+        results.emplace_back(std::move(match));
+    }
+    return 0;
+}
+
+size_t DirectorySnapshot::DirectoriesRead() const {
+    return directoriesRead_;
+}
+
+const DirectorySnapshot::CompiledPattern& DirectorySnapshot::Compile(const std::string& pattern) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& compiled = patterns_[pattern];
+    if (compiled)
+        return *compiled;
+
+    compiled = std::make_unique<CompiledPattern>();
+    if (!pattern.empty() && pattern.front() == '/')
+        compiled->root = "/";
+
+    size_t start = 0;
+    while (start < pattern.size()) {
+        size_t end = pattern.find('/', start);
+        if (end == std::string::npos)
+            end = pattern.size();
+        if (end > start) {
+            Component component;
+            component.text = pattern.substr(start, end - start);
+            component.hasWildcard = component.text.find_first_of(wildcardChars) != std::string::npos;
+            component.isRecursive = component.text == recursiveWildcard;
+            compiled->components.push_back(std::move(component));
+        }
+        start = end + 1;
+    }
+    return *compiled;
+}
+
+const DirectorySnapshot::Directory& DirectorySnapshot::ReadDirectory(const std::string& path) {
+    Directory* directory = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& cached = directories_[path];
+        if (!cached)
+            cached = std::make_unique<Directory>();
+        directory = cached.get();
+    }
+
+    // Concurrent searches for the same directory wait for the first one to list it.
+    std::call_once(directory->readOnce, [this, directory, &path]() {
+        const int dirFd = open(path.empty() ? "." : path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dirFd < 0) {
+            if (errno != ENOENT && errno != ENOTDIR)
+                PM_LOG_WARNING("Unable to open directory %s: %d", path.c_str(), errno);
+            return;
+        }
+        ++directoriesRead_;
+
+        std::vector<char> buffer(direntBufferSize);
+        while (true) {
+            const long bytesRead = syscall(SYS_getdents64, dirFd, buffer.data(), buffer.size());
+            if (bytesRead < 0 && errno == EINTR)
+                continue;
+            if (bytesRead < 0)
+                PM_LOG_WARNING("Unable to read directory %s: %d", path.c_str(), errno);
+            if (bytesRead <= 0)
+                break;
+
+            for (long offset = 0; offset < bytesRead; ) {
+                const auto* dirent = reinterpret_cast<const LinuxDirent64*>(buffer.data() + offset);
+                offset += dirent->d_reclen;
+
+                Entry entry;
+                entry.name = dirent->d_name;
+                if (entry.name == "." || entry.name == "..")
+                    continue;
+
+                if (dirent->d_type == DT_DIR) {
+                    entry.isDirectory = true;
+                } else if (dirent->d_type == DT_LNK || dirent->d_type == DT_UNKNOWN) {
+                    struct stat entryStat {};
+                    entry.isLink = dirent->d_type == DT_LNK ||
+                        (fstatat(dirFd, dirent->d_name, &entryStat, AT_SYMLINK_NOFOLLOW) == 0 && S_ISLNK(entryStat.st_mode));
+                    entry.exists = fstatat(dirFd, dirent->d_name, &entryStat, 0) == 0;
+                    entry.isDirectory = entry.exists && S_ISDIR(entryStat.st_mode);
+                }
+                directory->entries.push_back(std::move(entry));
+            }
+        }
+        (void)close(dirFd);
+
+        // Lets FindWildCardMatches() report matches in order without collecting them first.
+        std::sort(directory->entries.begin(), directory->entries.end(),
+            [](const Entry& lhs, const Entry& rhs) { return lhs.name < rhs.name; });
+    });
+
+    return *directory;
+}
+
+void DirectorySnapshot::Expand(const CompiledPattern& pattern, size_t index, const std::string& base, std::vector<std::string>& matches) {
+    if (index == pattern.components.size()) {
+        matches.push_back(base);
+        return;
+    }
+
+    const Component& component = pattern.components[index];
+    const bool isLast = index + 1 == pattern.components.size();
+
+    if (!component.hasWildcard) {
+        const std::string path = JoinPath(base, component.text);
+        struct stat pathStat {};
+        if (isLast ? lstat(path.c_str(), &pathStat) == 0 : (stat(path.c_str(), &pathStat) == 0 && S_ISDIR(pathStat.st_mode)))
+            Expand(pattern, index + 1, path, matches);
+        return;
+    }
+
+    for (const auto& entry : ReadDirectory(base).entries) {
+        if (!isLast && !entry.isDirectory)
+            continue;
+        if (fnmatch(component.text.c_str(), entry.name.c_str(), FNM_PERIOD) != 0)
+            continue;
+        Expand(pattern, index + 1, JoinPath(base, entry.name), matches);
+    }
+}
+
+bool DirectorySnapshot::Stream(const CompiledPattern& pattern, size_t index, const std::string& base, size_t maxResults, std::vector<std::string>& matches) {
+    if (index == pattern.components.size()) {
+        matches.push_back(base);
+        return maxResults == 0 || matches.size() < maxResults;
+    }
+
+    const Component& component = pattern.components[index];
+    const bool isLast = index + 1 == pattern.components.size();
+
+    if (component.isRecursive) {
+        // Consecutive "**" match the same paths as one, only more than once.
+        if (!isLast && pattern.components[index + 1].isRecursive)
+            return Stream(pattern, index + 1, base, maxResults, matches);
+
+        // No directory first, then one more at a time; a trailing "**" reports every entry on the way.
+        // Links are not followed so that cycles end.
+        if (!isLast && !Stream(pattern, index + 1, base, maxResults, matches))
+            return false;
+        for (const auto& entry : ReadDirectory(base).entries) {
+            if (!entry.exists || entry.name.front() == '.')
+                continue;
+            const std::string path = JoinPath(base, entry.name);
+            if (isLast) {
+                matches.push_back(path);
+                if (maxResults != 0 && matches.size() >= maxResults)
+                    return false;
+            }
+            if (entry.isDirectory && !entry.isLink && !Stream(pattern, index, path, maxResults, matches))
+                return false;
+        }
+        return true;
+    }
+
+    if (!component.hasWildcard) {
+        const std::string path = JoinPath(base, component.text);
+        struct stat pathStat {};
+        if (stat(path.c_str(), &pathStat) == 0 && (isLast || S_ISDIR(pathStat.st_mode)))
+            return Stream(pattern, index + 1, path, maxResults, matches);
+        return true;
+    }
+
+    for (const auto& entry : ReadDirectory(base).entries) {
+        if (!entry.exists || (!isLast && !entry.isDirectory))
+            continue;
+        if (fnmatch(component.text.c_str(), entry.name.c_str(), FNM_PERIOD) != 0)
+            continue;
+        if (!Stream(pattern, index + 1, JoinPath(base, entry.name), maxResults, matches))
+            return false;
+    }
+    return true;
+}
+
+}
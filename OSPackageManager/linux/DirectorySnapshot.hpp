@@ -0,0 +1,96 @@
+/**
+ * @file
+ *
+ * @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+ */
+
+#pragma once
+
+#include "IFileUtilities.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace PackageManager
+{
+
+/**
+ * @brief glob() compatible wildcard search over directory listings that are read at most once.
+ *
+ * Each directory a wildcard component has to enumerate is read with a single getdents64 pass and its
+ * entries, with their types, are kept for the lifetime of the snapshot. Patterns are split into
+ * components once and reused. Literal components are checked with a stat instead of a listing.
+ *
+ * Results match glob(pattern, 0): sorted, hidden entries only matched by patterns starting with '.',
+ * and intermediate components followed through symbolic links to directories. Unlike glob(), '.' and '..'
+ * are never matched.
+ * Changes made to the file system after a directory was read are not seen. Thread safe.
+ */
+class DirectorySnapshot : public IDirectorySnapshot {
+public:
+    DirectorySnapshot() = default;
+    ~DirectorySnapshot() = default;
+
+    /**
+     * @return 0 on success, GLOB_NOMATCH if nothing matched.
+     */
+    int32_t FileSearchWithWildCard(const std::filesystem::path& searchPath, std::vector<std::filesystem::path>& results) override;
+
+    /**
+     * @brief Walks the pattern depth first in name order and stops as soon as maxResults matches were found.
+     *        Matches are filtered on the listed entry types: dangling symbolic links are left out without a stat.
+     *        "**" matches any number of directories, not counting hidden ones or symbolic links to directories;
+     *        a trailing "**" matches every entry below. The order is sorted per path component, unlike glob().
+     * @return 0 on success, GLOB_NOMATCH if nothing matched.
+     */
+    int32_t FindWildCardMatches(const std::filesystem::path& searchPath, size_t maxResults, std::vector<std::filesystem::path>& results) override;
+
+    /**
+     * @brief Number of directory listings read so far.
+     */
+    size_t DirectoriesRead() const;
+
+private:
+    struct Entry {
+        std::string name;
+        bool isDirectory = false; /**< Symbolic links are resolved. */
+        bool isLink = false;
+        bool exists = true;       /**< False for dangling symbolic links. */
+    };
+
+    struct Directory {
+        std::once_flag readOnce;
+        std::vector<Entry> entries;
+    };
+
+    struct Component {
+        std::string text;
+        bool hasWildcard = false;
+        bool isRecursive = false; /**< "**", only interpreted by FindWildCardMatches(), glob() reads it as "*". */
+    };
+
+    struct CompiledPattern {
+        std::string root;
+        std::vector<Component> components;
+    };
+
+    const Directory& ReadDirectory(const std::string& path);
+    const CompiledPattern& Compile(const std::string& pattern);
+    void Expand(const CompiledPattern& pattern, size_t index, const std::string& base, std::vector<std::string>& matches);
+
+    /**
+     * @brief Expand() for FindWildCardMatches().
+     * @return False once maxResults matches were found.
+     */
+    bool Stream(const CompiledPattern& pattern, size_t index, const std::string& base, size_t maxResults, std::vector<std::string>& matches);
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::unique_ptr<Directory>> directories_;
+    std::unordered_map<std::string, std::unique_ptr<CompiledPattern>> patterns_;
+    std::atomic<size_t> directoriesRead_{0};
+};
+
+}
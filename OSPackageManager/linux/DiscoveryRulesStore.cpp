@@ -0,0 +1,131 @@
+#include "DiscoveryRulesStore.hpp"
+#include "AtomicFileWriter.hpp"
+#include "PmLogger.hpp"
+#include <fstream>
+#include <sstream>
+#include <json/json.h>
+
+namespace { //anonymous namespace
+    const int rulesFileVersion = 1;
+    const std::string versionKey {"version"};
+    const std::string rulesKey {"rules"};
+    const std::string productKey {"product"};
+    const std::string nvrasKey {"pkgnvra"};
+    const std::string namesKey {"pkgname"};
+    const std::string configurablesKey {"configurables"};
+    const std::string cfgPathKey {"cfgPath"};
+    const std::string unresolvedCfgPathKey {"unresolvedCfgPath"};
+    const std::string deployPathKey {"deployPath"};
+    const std::string unresolvedDeployPathKey {"unresolvedDeployPath"};
+    const std::string maxInstancesKey {"max_instances"};
+
+    std::string Serialize(const std::vector<PmProductDiscoveryRules>& catalogRules) {
+        Json::Value root;
+        root[versionKey] = rulesFileVersion;
+        Json::Value& rules = root[rulesKey] = Json::Value(Json::arrayValue);
+        for (const auto& rule : catalogRules) {
+            Json::Value jsonRule;
+            jsonRule[productKey] = rule.product;
+            jsonRule[nvrasKey] = Json::Value(Json::arrayValue);
+            for (const auto& pkgRule : rule.pkgnvra_discovery) {
+                jsonRule[nvrasKey].append(pkgRule.pkgId);
+            }
+            jsonRule[namesKey] = Json::Value(Json::arrayValue);
+            for (const auto& pkgNameRule : rule.pkgname_discovery) {
+                jsonRule[namesKey].append(pkgNameRule.name);
+            }
+            jsonRule[configurablesKey] = Json::Value(Json::arrayValue);
+            for (const auto& configurable : rule.configurables) {
+                Json::Value jsonConfigurable;
+                jsonConfigurable[cfgPathKey] = configurable.cfgPath.generic_u8string();
+                jsonConfigurable[unresolvedCfgPathKey] = configurable.unresolvedCfgPath.generic_u8string();
+                jsonConfigurable[deployPathKey] = configurable.deployPath.generic_u8string();
+                jsonConfigurable[unresolvedDeployPathKey] = configurable.unresolvedDeployPath.generic_u8string();
+                jsonConfigurable[maxInstancesKey] = Json::UInt64(configurable.max_instances);
+                jsonRule[configurablesKey].append(jsonConfigurable);
+            }
+            rules.append(jsonRule);
+        }
+
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        return Json::writeString(builder, root);
+    }
+
+    bool Deserialize(const std::string& contents, std::vector<PmProductDiscoveryRules>& catalogRules) {
+        Json::Value root;
+        JSONCPP_STRING errors;
+        Json::CharReaderBuilder builder;
+        std::istringstream stream(contents);
+        if (!Json::parseFromStream(builder, stream, &root, &errors)) {
+            PM_LOG_WARNING("Unable to parse stored discovery rules: %s", errors.c_str());
+            return false;
+        }
+        if (!root.isObject() || root.get(versionKey, 0).asInt() != rulesFileVersion || !root[rulesKey].isArray()) {
+            PM_LOG_WARNING("Unsupported stored discovery rules");
+            return false;
+        }
+
+        std::vector<PmProductDiscoveryRules> rules;
+        for (const auto& jsonRule : root[rulesKey]) {
+            rules.emplace_back();
+            auto& rule = rules.back();
+            rule.product = jsonRule[productKey].asString();
+            for (const auto& nvra : jsonRule[nvrasKey]) {
+                rule.pkgnvra_discovery.emplace_back();
+                rule.pkgnvra_discovery.back().pkgId = nvra.asString();
+            }
+            for (const auto& name : jsonRule[namesKey]) {
+                rule.pkgname_discovery.emplace_back();
+                rule.pkgname_discovery.back().name = name.asString();
+            }
+            for (const auto& jsonConfigurable : jsonRule[configurablesKey]) {
+                rule.configurables.emplace_back();
+                auto& configurable = rule.configurables.back();
+                configurable.cfgPath = std::filesystem::u8path(jsonConfigurable[cfgPathKey].asString());
+                configurable.unresolvedCfgPath = std::filesystem::u8path(jsonConfigurable[unresolvedCfgPathKey].asString());
+                configurable.deployPath = std::filesystem::u8path(jsonConfigurable[deployPathKey].asString());
+                configurable.unresolvedDeployPath = std::filesystem::u8path(jsonConfigurable[unresolvedDeployPathKey].asString());
+                configurable.max_instances = jsonConfigurable[maxInstancesKey].asUInt64();
+            }
+        }
+        catalogRules = std::move(rules);
+        return true;
+    }
+}
+
+DiscoveryRulesStore::DiscoveryRulesStore(const std::filesystem::path& filePath)
+    : filePath_(filePath) {
+}
+
+bool DiscoveryRulesStore::Save(const std::vector<PmProductDiscoveryRules>& catalogRules) {
+    const std::string contents = Serialize(catalogRules);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (contents == storedContents_) {
+        return true;
+    }
+
+    if (!PackageManager::AtomicFileWriter::Write(filePath_, contents, {})) {
+        return false;
+    }
+
+    storedContents_ = contents;
+    return true;
+}
+
+bool DiscoveryRulesStore::Load(std::vector<PmProductDiscoveryRules>& catalogRules) {
+    std::ifstream file(filePath_, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!Deserialize(contents.str(), catalogRules)) {
+        return false;
+    }
+    storedContents_ = contents.str();
+    return true;
+}
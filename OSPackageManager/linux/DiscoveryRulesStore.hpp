@@ -0,0 +1,41 @@
+/**
+ * @file
+ *
+ * @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+ */
+#pragma once
+
+#include "PackageManager/PmTypes.h"
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Keeps the last catalog discovery rules on disk, so that discovery can be started before the
+ *        first check-in delivers the catalog again.
+ *
+ * Only the fields that Linux discovery evaluates are stored. The file is replaced atomically and only
+ * rewritten when the rules change.
+ */
+class DiscoveryRulesStore {
+public:
+    explicit DiscoveryRulesStore(const std::filesystem::path& filePath);
+
+    /**
+     * @brief Writes the rules unless they are identical to the stored ones.
+     * @return False if the file could not be written.
+     */
+    bool Save(const std::vector<PmProductDiscoveryRules>& catalogRules);
+
+    /**
+     * @brief Reads the stored rules.
+     * @return False if there is no file or it cannot be parsed.
+     */
+    bool Load(std::vector<PmProductDiscoveryRules>& catalogRules);
+
+private:
+    const std::filesystem::path filePath_;
+    std::mutex mutex_;
+    std::string storedContents_; /**< Contents of the file as last read or written. */
+};
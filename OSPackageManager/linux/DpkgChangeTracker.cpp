@@ -0,0 +1,237 @@
+#include "DpkgChangeTracker.hpp"
+#include "PmLogger.hpp"
+#include <sstream>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace { //anonymous namespace
+    const std::string dpkgStatusFileName {"status"};
+    const std::string dpkgUpdatesDirName {"/updates"};
+    const uint32_t adminDirEvents = IN_CLOSE_WRITE | IN_MOVED_TO;
+    const uint32_t updatesDirEvents = IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE;
+    const size_t logReadChunkSize = 64 * 1024;
+    // dpkg.log lines: "<date> <time> <action> <package> ..." or "<date> <time> status <state> <package> <version>"
+    const std::string dpkgLogStatusAction {"status"};
+    const std::set<std::string> dpkgLogPackageActions {"install", "upgrade", "remove", "purge", "configure", "trigproc"};
+}
+
+DpkgChangeTracker::DpkgChangeTracker(const std::string& dpkgAdminDir, const std::string& dpkgLogPath)
+    : dpkgLogPath_(dpkgLogPath) {
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd_ < 0) {
+        PM_LOG_ERROR("inotify_init1 failed: %d", errno);
+        return;
+    }
+
+    adminDirWatch_ = inotify_add_watch(inotifyFd_, dpkgAdminDir.c_str(), adminDirEvents);
+    updatesDirWatch_ = inotify_add_watch(inotifyFd_, (dpkgAdminDir + dpkgUpdatesDirName).c_str(), updatesDirEvents);
+    if (adminDirWatch_ < 0) {
+        PM_LOG_WARNING("Unable to watch the dpkg database %s (%d), package changes will not be tracked", dpkgAdminDir.c_str(), errno);
+        (void)close(inotifyFd_);
+        inotifyFd_ = -1;
+        return;
+    }
+
+    // Everything logged so far is already reflected in whatever callers read from the database.
+    (void)openLog(false);
+}
+
+DpkgChangeTracker::~DpkgChangeTracker() {
+    if (logFd_ >= 0) {
+        (void)close(logFd_);
+    }
+    if (inotifyFd_ >= 0) {
+        (void)close(inotifyFd_);
+    }
+}
+
+bool DpkgChangeTracker::isWatching() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return inotifyFd_ >= 0;
+}
+
+uint64_t DpkgChangeTracker::refresh() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (inotifyFd_ < 0) {
+        return generation_;
+    }
+
+    bool overflow = false;
+    const bool databaseChanged = drainEvents(overflow);
+    std::set<std::string> packageNames;
+    const bool logComplete = readLogTail(packageNames);
+
+    if (!databaseChanged && packageNames.empty()) {
+        return generation_;
+    }
+
+    ++generation_;
+    for (const auto& packageName : packageNames) {
+        changedPackages_[packageName] = generation_;
+    }
+
+    // A database change that the log cannot account for (yet) may have touched any package.
+    if (overflow || !logComplete || packageNames.empty()) {
+        PM_LOG_DEBUG("dpkg database changed without attributable log entries, invalidating generation %llu",
+            static_cast<unsigned long long>(generation_));
+        invalidatedGeneration_ = generation_;
+    }
+
+    return generation_;
+}
+
+bool DpkgChangeTracker::isUnchangedSince(const std::string& packageName, uint64_t generation) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (inotifyFd_ < 0 || generation < invalidatedGeneration_) {
+        return false;
+    }
+    const auto it = changedPackages_.find(packageName);
+    return it == changedPackages_.end() || it->second <= generation;
+}
+
+bool DpkgChangeTracker::getChangedPackagesSince(uint64_t generation, std::set<std::string>& packageNames) {
+    (void)refresh();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (inotifyFd_ < 0 || generation < invalidatedGeneration_) {
+        return false;
+    }
+    for (const auto& changedPackage : changedPackages_) {
+        if (changedPackage.second > generation) {
+            packageNames.insert(changedPackage.first);
+        }
+    }
+    return true;
+}
+
+bool DpkgChangeTracker::drainEvents(bool& overflow) {
+    alignas(struct inotify_event) char buffer[4096];
+    bool changed = false;
+
+    while (true) {
+        ssize_t length = read(inotifyFd_, buffer, sizeof(buffer));
+        if (length < 0 && errno == EINTR) {
+            continue;
+        }
+        if (length <= 0) {
+            break;
+        }
+
+        for (char* ptr = buffer; ptr < buffer + length; ) {
+            const auto* event = reinterpret_cast<const struct inotify_event*>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflow = true;
+                changed = true;
+            } else if (event->wd == updatesDirWatch_) {
+                changed = true;
+            } else if (event->wd == adminDirWatch_ && event->len > 0 && dpkgStatusFileName == event->name) {
+                // Other files in the directory (lock files, 'available', ...) do not affect installed packages.
+                changed = true;
+            }
+        }
+    }
+
+    return changed;
+}
+
+bool DpkgChangeTracker::openLog(bool fromStart) {
+    logFd_ = open(dpkgLogPath_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (logFd_ < 0) {
+        return false;
+    }
+
+    struct stat logStat = {};
+    if (fstat(logFd_, &logStat) != 0) {
+        (void)close(logFd_);
+        logFd_ = -1;
+        return false;
+    }
+    logInode_ = logStat.st_ino;
+    logOffset_ = fromStart ? 0 : logStat.st_size;
+    partialLogLine_.clear();
+    return true;
+}
+
+bool DpkgChangeTracker::readLogTail(std::set<std::string>& packageNames) {
+    if (logFd_ < 0 && !openLog(true)) {
+        return false;
+    }
+
+    bool complete = true;
+    struct stat pathStat = {};
+    if (stat(dpkgLogPath_.c_str(), &pathStat) == 0 && pathStat.st_ino != logInode_) {
+        // The log was rotated: finish the old file through the descriptor still open, then follow the new one.
+        complete = readLogFrom(logFd_, logOffset_, packageNames);
+        (void)close(logFd_);
+        logFd_ = -1;
+        if (!openLog(true)) {
+            return false;
+        }
+    }
+
+    struct stat logStat = {};
+    if (fstat(logFd_, &logStat) == 0 && logStat.st_size < logOffset_) {
+        // Truncated in place (copytruncate), the entries written in between are lost.
+        logOffset_ = 0;
+        partialLogLine_.clear();
+        complete = false;
+    }
+
+    return readLogFrom(logFd_, logOffset_, packageNames) && complete;
+}
+
+bool DpkgChangeTracker::readLogFrom(int fd, off_t& offset, std::set<std::string>& packageNames) {
+    std::vector<char> buffer(logReadChunkSize);
+    while (true) {
+        ssize_t bytesRead = pread(fd, buffer.data(), buffer.size(), offset);
+        if (bytesRead < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytesRead < 0) {
+            PM_LOG_ERROR("Failed to read %s: %d", dpkgLogPath_.c_str(), errno);
+            return false;
+        }
+        if (bytesRead == 0) {
+            return true;
+        }
+        offset += bytesRead;
+        partialLogLine_.append(buffer.data(), static_cast<size_t>(bytesRead));
+
+        size_t start = 0;
+        size_t end = 0;
+        while ((end = partialLogLine_.find('\n', start)) != std::string::npos) {
+            parseLogLine(partialLogLine_.substr(start, end - start), packageNames);
+            start = end + 1;
+        }
+        partialLogLine_.erase(0, start);
+    }
+}
+
+void DpkgChangeTracker::parseLogLine(const std::string& line, std::set<std::string>& packageNames) const {
+    std::istringstream stream(line);
+    std::string date, time, action, first, second;
+    if (!(stream >> date >> time >> action >> first)) {
+        return;
+    }
+
+    std::string packageName;
+    if (action == dpkgLogStatusAction) {
+        if (stream >> second) {
+            packageName = second;
+        }
+    } else if (dpkgLogPackageActions.count(action) != 0) {
+        packageName = first;
+    }
+
+    packageName = packageName.substr(0, packageName.find(':'));
+    if (!packageName.empty()) {
+        packageNames.insert(packageName);
+    }
+}
@@ -0,0 +1,88 @@
+/**
+ * @file
+ *
+ * @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+ */
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <sys/types.h>
+
+/**
+ * @brief Tracks which Debian packages changed, so that cached package information only needs to be
+ *        refreshed for those packages.
+ *
+ * The dpkg database directory is watched with inotify ('status' is replaced by rename and per-package
+ * changes are journaled in 'updates/'), and new lines of dpkg.log are parsed incrementally to learn the
+ * names of the packages involved. Every refresh that observes a change advances the generation.
+ *
+ * When a database change cannot be attributed to package names (log missing, truncated or not yet
+ * written, inotify queue overflow) the tracker invalidates everything up to the current generation and
+ * callers have to refresh all of their entries. The tracker never reports a package as unchanged unless
+ * it is sure.
+ */
+class DpkgChangeTracker {
+public:
+    /**
+     * @brief Starts watching the dpkg database.
+     * @param dpkgAdminDir The dpkg database directory.
+     * @param dpkgLogPath The dpkg log file.
+     */
+    explicit DpkgChangeTracker(
+        const std::string& dpkgAdminDir = "/var/lib/dpkg",
+        const std::string& dpkgLogPath = "/var/log/dpkg.log");
+    ~DpkgChangeTracker();
+
+    DpkgChangeTracker(const DpkgChangeTracker&) = delete;
+    DpkgChangeTracker& operator=(const DpkgChangeTracker&) = delete;
+
+    /**
+     * @brief Processes pending inotify events and new dpkg.log lines.
+     * @return The current generation. Values are only meaningful to this tracker instance.
+     */
+    uint64_t refresh();
+
+    /**
+     * @brief Checks whether a package is known to be unchanged since the given generation.
+     * @note Does not refresh; callers obtain the generation they compare against from refresh().
+     * @return False if the package changed or if changes since the generation are unknown.
+     */
+    bool isUnchangedSince(const std::string& packageName, uint64_t generation) const;
+
+    /**
+     * @brief Refreshes and collects the names of the packages changed after the given generation.
+     * @param generation A generation previously returned by refresh().
+     * @param packageNames Receives the changed package names (without architecture qualifier).
+     * @return False if the set of changes is unknown and every package must be treated as changed.
+     */
+    bool getChangedPackagesSince(uint64_t generation, std::set<std::string>& packageNames);
+
+    /**
+     * @brief Returns true if the database directory could be watched.
+     */
+    bool isWatching() const;
+
+private:
+    const std::string dpkgLogPath_;
+    mutable std::mutex mutex_;
+    int inotifyFd_ = -1;
+    int adminDirWatch_ = -1;
+    int updatesDirWatch_ = -1;
+    int logFd_ = -1;
+    ino_t logInode_ = 0;
+    off_t logOffset_ = 0;
+    std::string partialLogLine_;
+    uint64_t generation_ = 1;
+    uint64_t invalidatedGeneration_ = 1; /**< Changes at or before this generation are unknown. */
+    std::unordered_map<std::string, uint64_t> changedPackages_; /**< Package name -> generation of its last change. */
+
+    bool drainEvents(bool& overflow);
+    bool openLog(bool fromStart);
+    bool readLogTail(std::set<std::string>& packageNames);
+    bool readLogFrom(int fd, off_t& offset, std::set<std::string>& packageNames);
+    void parseLogLine(const std::string& line, std::set<std::string>& packageNames) const;
+};
@@ -0,0 +1,154 @@
+#include "FileFingerprintCache.hpp"
+#include "PmLogger.hpp"
+#include <errno.h>
+#include <fcntl.h>
+#include <memory>
+#include <openssl/evp.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace { //anonymous namespace
+    // Large enough that the per-read cost vanishes next to hashing, page aligned so the kernel copies whole pages.
+    const size_t readBufferSize = 1024 * 1024;
+    const size_t readBufferAlignment = 4096;
+    // Same granularity allowance as discovery's directory stamps.
+    const int64_t racyWindowNs = 2000000000LL;
+
+    int64_t NowNs() {
+        struct timespec now {};
+        clock_gettime(CLOCK_REALTIME, &now);
+        return static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+    }
+
+    std::string ToHex(const unsigned char* data, size_t size) {
+        static const char hexDigits[] = "0123456789abcdef";
+        std::string hex;
+        hex.reserve(size * 2);
+        for (size_t i = 0; i < size; ++i) {
+            hex.push_back(hexDigits[data[i] >> 4]);
+            hex.push_back(hexDigits[data[i] & 0x0f]);
+        }
+        return hex;
+    }
+}
+
+bool FileFingerprintCache::Sha256(int fd, std::string& digest) {
+    std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> context(EVP_MD_CTX_new(), EVP_MD_CTX_free);
+    if (!context || EVP_DigestInit_ex(context.get(), EVP_sha256(), nullptr) != 1)
+        return false;
+
+    // Read rather than mapped: a file truncated while it is mapped raises SIGBUS, and configurables are
+    // writable by users.
+    std::unique_ptr<char, decltype(&free)> buffer(static_cast<char*>(aligned_alloc(readBufferAlignment, readBufferSize)), free);
+    if (!buffer)
+        return false;
+    (void)posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // EVP dispatches to the SHA extensions of the CPU (SHA-NI, ARMv8 crypto) where they are present.
+    while (true) {
+        const ssize_t bytesRead = read(fd, buffer.get(), readBufferSize);
+        if (bytesRead < 0 && errno == EINTR)
+            continue;
+        if (bytesRead < 0)
+            return false;
+        if (bytesRead == 0)
+            break;
+        if (EVP_DigestUpdate(context.get(), buffer.get(), static_cast<size_t>(bytesRead)) != 1)
+            return false;
+    }
+
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int mdLength = 0;
+    if (EVP_DigestFinal_ex(context.get(), md, &mdLength) != 1)
+        return false;
+    digest = ToHex(md, mdLength);
+    return true;
+}
+
+bool FileFingerprintCache::Sha256(const char* data, size_t size, std::string& digest) {
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int mdLength = 0;
+    if (EVP_Digest(data, size, md, &mdLength, EVP_sha256(), nullptr) != 1)
+        return false;
+    digest = ToHex(md, mdLength);
+    return true;
+}
+
+bool FileFingerprintCache::Identify(int dirFd, const char* path, int flags, FileIdentity& identity) {
+    struct statx fileStat {};
+    if (statx(dirFd, path, flags, STATX_TYPE | STATX_INO | STATX_SIZE | STATX_MTIME, &fileStat) != 0 ||
+        !S_ISREG(fileStat.stx_mode))
+        return false;
+    identity.device = makedev(fileStat.stx_dev_major, fileStat.stx_dev_minor);
+    identity.inode = fileStat.stx_ino;
+    identity.size = fileStat.stx_size;
+    identity.mtimeNs = static_cast<int64_t>(fileStat.stx_mtime.tv_sec) * 1000000000LL + fileStat.stx_mtime.tv_nsec;
+    return true;
+}
+
+bool FileFingerprintCache::Sha256(const std::filesystem::path& path, std::string& digest) {
+    FileIdentity identity;
+    if (!Identify(AT_FDCWD, path.c_str(), 0, identity))
+        return false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto cached = fingerprints_.find(path.native());
+        if (cached != fingerprints_.end() && cached->second.identity == identity) {
+            cached->second.used = true;
+            digest = cached->second.digest;
+            return true;
+        }
+    }
+
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        PM_LOG_DEBUG("Unable to open %s: %d", path.c_str(), errno);
+        return false;
+    }
+
+    // The digest belongs to what was read, so it is keyed on the identity of the opened file.
+    FileIdentity hashedIdentity;
+    FileIdentity afterIdentity;
+    const bool hashed = Identify(fd, "", AT_EMPTY_PATH, hashedIdentity) && Sha256(fd, digest);
+    const bool stable = hashed && Identify(fd, "", AT_EMPTY_PATH, afterIdentity) && afterIdentity == hashedIdentity &&
+        NowNs() - hashedIdentity.mtimeNs >= racyWindowNs;
+    (void)close(fd);
+    if (!hashed) {
+        PM_LOG_WARNING("Unable to hash %s", path.c_str());
+        return false;
+    }
+    ++digestsComputed_;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stable) {
+        fingerprints_[path.native()] = {hashedIdentity, digest, true};
+    } else {
+        fingerprints_.erase(path.native());
+    }
+    return true;
+}
+
+void FileFingerprintCache::Forget(const std::filesystem::path& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fingerprints_.erase(path.native());
+}
+
+void FileFingerprintCache::DropUnused() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = fingerprints_.begin(); it != fingerprints_.end(); ) {
+        if (!it->second.used) {
+            it = fingerprints_.erase(it);
+        } else {
+            it->second.used = false;
+            ++it;
+        }
+    }
+}
+
+size_t FileFingerprintCache::DigestsComputed() const {
+    return digestsComputed_;
+}
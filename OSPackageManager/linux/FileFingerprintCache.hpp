@@ -0,0 +1,83 @@
+/**
+ * @file
+ *
+ * @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <sys/types.h>
+
+/**
+ * @brief SHA-256 digests of files, recomputed only when a file's identity or modification changes.
+ *
+ * A digest is kept with the (device, inode, size, mtime) of the file it was computed from, so a lookup of an
+ * unchanged file costs one statx(). Files modified within the last two seconds, or while being hashed,
+ * are hashed again on the next lookup because their mtime cannot tell a later write apart.
+ * Hashing uses OpenSSL, which selects the SHA extensions when the CPU has them. Thread safe.
+ */
+class FileFingerprintCache {
+public:
+    FileFingerprintCache() = default;
+
+    /**
+     * @brief Looks up the lowercase hex SHA-256 digest of a regular file.
+     * @return False if the file cannot be read.
+     */
+    bool Sha256(const std::filesystem::path& path, std::string& digest);
+
+    /**
+     * @brief Drops the digest of a file, so that the next lookup hashes it again.
+     */
+    void Forget(const std::filesystem::path& path);
+
+    /**
+     * @brief Drops the digests of the files that were not looked up since the previous call.
+     */
+    void DropUnused();
+
+    /**
+     * @brief Number of files hashed so far.
+     */
+    size_t DigestsComputed() const;
+
+    /**
+     * @brief Hashes an open file from its current offset to the end, without caching.
+     * @return False if the file cannot be read.
+     */
+    static bool Sha256(int fd, std::string& digest);
+
+    /**
+     * @brief Hashes data in memory.
+     */
+    static bool Sha256(const char* data, size_t size, std::string& digest);
+
+private:
+    struct FileIdentity {
+        dev_t device = 0;
+        ino_t inode = 0;
+        uint64_t size = 0;
+        int64_t mtimeNs = 0;
+
+        bool operator==(const FileIdentity& other) const {
+            return device == other.device && inode == other.inode && size == other.size && mtimeNs == other.mtimeNs;
+        }
+    };
+
+    struct Fingerprint {
+        FileIdentity identity;
+        std::string digest;
+        bool used = true;
+    };
+
+    static bool Identify(int dirFd, const char* path, int flags, FileIdentity& identity);
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, Fingerprint> fingerprints_; /**< Keyed on the path. */
+    std::atomic<size_t> digestsComputed_{0};
+};
@@ -5,17 +5,23 @@
  */
 
 #include "FileUtilities.hpp"
+#include "DirectorySnapshot.hpp"
+#include "PathPermissions.hpp"
 #include "PmLogger.hpp"
 #include <glob.h>
 #include <pwd.h>
 #include <utmp.h>
 #include <signal.h>
 #include <string.h>
-#include <regex>
+#include <algorithm>
 
 namespace { //anonymous namespace
 
-// NOTE: This function is not thread safe.
+// Template paths come from the catalog, so few distinct ones are seen; the bound only guards against misuse.
+const size_t kMaxCompiledTemplates = 1024;
+
+// NOTE: This function is not thread safe. FileUtilities only calls it through its KnownFolderCache,
+// which runs one resolver at a time.
 bool GetCurrentConsoleUser(std::string &userName) {
     userName.erase();
     setutent();
@@ -34,6 +40,26 @@ bool GetCurrentConsoleUser(std::string &userName) {
     return !userName.empty();
 }
 
+// NOTE: This function is not thread safe, see GetCurrentConsoleUser().
+void GetLoggedInUsers(std::vector<std::string> &userNames) {
+    userNames.clear();
+    setutent();
+    struct utmp *entry = nullptr;
+    while (NULL != (entry = getutent())) {
+        if (USER_PROCESS == entry->ut_type &&
+        0 < entry->ut_pid &&
+        0 == kill(entry->ut_pid,0) &&
+        (0 != strcmp("(unknown)", entry->ut_name))) {
+            // ut_name is not necessarily terminated.
+            const std::string userName(entry->ut_name, strnlen(entry->ut_name, sizeof(entry->ut_name)));
+            if (std::find(userNames.begin(), userNames.end(), userName) == userNames.end()) {
+                userNames.push_back(userName);
+            }
+        }
+    }
+    endutent();
+}
+
 void ResolveUserHomeFolder(std::string &userHomeFolder) {
     std::string userName;
     if (!GetCurrentConsoleUser(userName)) {
@@ -50,6 +76,23 @@ void ResolveUserHomeFolder(std::string &userHomeFolder) {
     userHomeFolder = std::string(pw->pw_dir);
 }
 
+// Users without a home directory get an empty folder, so that the folders stay in the order of the users.
+void ResolveAllUserHomeFolders(std::vector<std::string> &userHomeFolders) {
+    std::vector<std::string> userNames;
+    GetLoggedInUsers(userNames);
+
+    userHomeFolders.clear();
+    for (const auto& userName : userNames) {
+        struct passwd *pw = getpwnam(userName.c_str());
+        if (pw == NULL || pw->pw_dir == NULL) {
+            PM_LOG_ERROR("Failed to get user home directory for user %s", userName.c_str());
+            userHomeFolders.emplace_back();
+            continue;
+        }
+        userHomeFolders.emplace_back(pw->pw_dir);
+    }
+}
+
 }
 
 namespace PackageManager
@@ -58,6 +101,13 @@ const std::unordered_map<std::string, std::function<void(std::string &)>> PathRe
     {"UserHome", ResolveUserHomeFolder}
 };
 
+const std::unordered_map<std::string, std::function<void(std::vector<std::string> &)>> PathResolveUtil::allUsersKnownFolderIdMap = {
+    {"UserHome", ResolveAllUserHomeFolders}
+};
+
+FileUtilities::FileUtilities() : knownFolders_(_PATH_UTMP) {
+}
+
 bool FileUtilities::PathIsValid(const std::filesystem::path &filePath) {
     bool bValid = false;
     try{
@@ -169,27 +219,91 @@ int32_t FileUtilities::FileSearchWithWildCard(const std::filesystem::path& searc
     return dwError;
 }
 
+int32_t FileUtilities::FindWildCardMatches(const std::filesystem::path& searchPath, size_t maxResults, std::vector<std::filesystem::path>& results) {
+    // A snapshot of its own reads each directory once and stops at the limit, unlike glob().
+    return DirectorySnapshot().FindWildCardMatches(searchPath, maxResults, results);
+}
+
+std::unique_ptr<IDirectorySnapshot> FileUtilities::CreateDirectorySnapshot() {
+    return std::make_unique<DirectorySnapshot>();
+}
+
+int32_t FileUtilities::ApplyRestrictions(const std::filesystem::path &filePath, PathRestriction restriction, bool recursive) {
+    return PathPermissions::Apply(filePath, restriction, recursive) ? 0 : -1;
+}
+
 /**
- * @brief Resolves the path by replacing the folder ID with the actual path.
+ * @brief Resolves the path by replacing the folder IDs with the actual paths.
  * @note  The folder ID should be in the format <FOLDERID_xxx>, where xxx is the supported known folder ID.
- * @note  If the format is not correct or the folder ID is not supported, the function will return the base path as is.
+ * @note  If the format is not correct or a folder ID is not supported, the function will return the base path as is.
  */
-std::string FileUtilities::ResolvePath(const std::string &basePath) {   
-    const std::regex folderIdRegex(R"(<FOLDERID_([^>]+)>)");
-    std::smatch matches;
-    
-    if (std::regex_search(basePath, matches, folderIdRegex)) {
-        const auto& folderIdString = matches[1].str();
-        const auto knownFolder = ResolveKnownFolderIdForDefaultUser(folderIdString);
-        
-        if (!knownFolder.empty()) {
-            return std::regex_replace(basePath, folderIdRegex, knownFolder);
-        } else {
-            PM_LOG_WARNING("Failed to resolve path %s", basePath.c_str());
+std::string FileUtilities::ResolvePath(const std::string &basePath) {
+    const auto pathTemplate = CompileTemplate(basePath);
+    if (!pathTemplate->HasFolderIds()) {
+        return basePath;
+    }
+
+    std::string resolvedPath;
+    if (!pathTemplate->Expand([this](const std::string& knownFolderId) { return ResolveKnownFolderIdForDefaultUser(knownFolderId); }, resolvedPath)) {
+        PM_LOG_WARNING("Failed to resolve path %s", basePath.c_str());
+        return basePath;
+    }
+
+    return resolvedPath;
+}
+
+/**
+ * @brief Resolves the path once per logged-in user. Per-user folder IDs take the folder of that user, the
+ *        others resolve as in ResolvePath(). Users for whom a folder ID cannot be resolved are skipped.
+ */
+std::vector<std::string> FileUtilities::ResolvePathForAllUsers(const std::string &basePath) {
+    const auto pathTemplate = CompileTemplate(basePath);
+
+    std::unordered_map<std::string, std::vector<std::string>> userFolders;
+    size_t userCount = 0;
+    for (const auto& knownFolderId : pathTemplate->FolderIds()) {
+        const auto it = PathResolveUtil::allUsersKnownFolderIdMap.find(knownFolderId);
+        if (it == PathResolveUtil::allUsersKnownFolderIdMap.end() || userFolders.count(knownFolderId) != 0) {
+            continue;
         }
+        auto folders = knownFolders_.ResolveForAllUsers(knownFolderId, it->second);
+        userCount = std::max(userCount, folders.size());
+        userFolders.emplace(knownFolderId, std::move(folders));
     }
-    
-    return basePath;
+
+    std::vector<std::string> resolvedPaths;
+    for (size_t user = 0; user < userCount; ++user) {
+        std::string resolvedPath;
+        const bool resolved = pathTemplate->Expand([this, &userFolders, user](const std::string& knownFolderId) {
+            const auto folders = userFolders.find(knownFolderId);
+            if (folders == userFolders.end()) {
+                return ResolveKnownFolderIdForDefaultUser(knownFolderId);
+            }
+            return user < folders->second.size() ? folders->second[user] : std::string {};
+        }, resolvedPath);
+
+        // Users may share a home directory.
+        if (resolved && std::find(resolvedPaths.begin(), resolvedPaths.end(), resolvedPath) == resolvedPaths.end()) {
+            resolvedPaths.push_back(std::move(resolvedPath));
+        }
+    }
+
+    return resolvedPaths;
+}
+
+std::shared_ptr<const PathTemplate> FileUtilities::CompileTemplate(const std::string &basePath) {
+    std::lock_guard<std::mutex> lock(templatesMutex_);
+    const auto cached = templates_.find(basePath);
+    if (cached != templates_.end()) {
+        return cached->second;
+    }
+
+    if (templates_.size() >= kMaxCompiledTemplates) {
+        templates_.clear();
+    }
+    auto pathTemplate = std::make_shared<const PathTemplate>(basePath);
+    templates_.emplace(basePath, pathTemplate);
+    return pathTemplate;
 }
 
 std::string FileUtilities::ResolveKnownFolderIdForDefaultUser(const std::string& knownFolderId) {
@@ -199,10 +313,7 @@ std::string FileUtilities::ResolveKnownFolderIdForDefaultUser(const std::string&
         return std::string {};
     } 
 
-    std::string folderPath {};
-    it->second(folderPath);
-
-    return folderPath;
+    return knownFolders_.Resolve(knownFolderId, it->second);
 }
 
 }
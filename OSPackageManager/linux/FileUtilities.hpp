@@ -7,18 +7,23 @@
 #pragma once
 
 #include "IFileUtilities.hpp"
+#include "KnownFolderCache.hpp"
+#include "PathTemplate.hpp"
 #include <unordered_map>
 #include <functional>
+#include <mutex>
 
 namespace PackageManager
 {
 struct PathResolveUtil {
     const static std::unordered_map<std::string, std::function<void(std::string &)>> knownFolderIdMap;
+    /** Known folders that differ per user, resolved for every logged-in user in the order of GetLoggedInUsers(). */
+    const static std::unordered_map<std::string, std::function<void(std::vector<std::string> &)>> allUsersKnownFolderIdMap;
 };
     
 class FileUtilities : public IFileUtilities{
 public:
-    FileUtilities() = default;
+    FileUtilities();
     ~FileUtilities() = default;
     bool PathIsValid(const std::filesystem::path &filePath) override;
     bool HasAdminRestrictionsApplied(const std::filesystem::path &filePath) override;
@@ -26,9 +31,22 @@ public:
     bool ApplyAdminRestrictions(const std::filesystem::path &filePath) override;
     bool ApplyUserRestrictions(const std::filesystem::path &filePath) override;
     int32_t FileSearchWithWildCard(const std::filesystem::path& searchPath, std::vector<std::filesystem::path>& results) override;
+    int32_t FindWildCardMatches(const std::filesystem::path& searchPath, size_t maxResults, std::vector<std::filesystem::path>& results) override;
     std::string ResolvePath(const std::string& basePath) override;
     std::string ResolveKnownFolderIdForDefaultUser(const std::string& knownFolderId) override;
-    
+    std::unique_ptr<IDirectorySnapshot> CreateDirectorySnapshot() override;
+    std::vector<std::string> ResolvePathForAllUsers(const std::string& basePath) override;
+    int32_t ApplyRestrictions(const std::filesystem::path& filePath, PathRestriction restriction, bool recursive) override;
+
+private:
+    /**
+     * @brief Returns the tokenized form of a path, tokenizing it on first use.
+     */
+    std::shared_ptr<const PathTemplate> CompileTemplate(const std::string& basePath);
+
+    KnownFolderCache knownFolders_; /**< Invalidated when the login sessions change. */
+    std::mutex templatesMutex_;
+    std::unordered_map<std::string, std::shared_ptr<const PathTemplate>> templates_; /**< Keyed on the template text. */
 };
 
 }
@@ -3,12 +3,59 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <chrono>
+#include <cstdint>
+#include <set>
 
 struct PackageInfo {
     std::string packageIdentifier;
     std::string packageName;
     std::string version;
+    std::string architecture;
 };
+
+/**
+ * @brief A single entry of a batched install request.
+ */
+struct PackageInstallRequest {
+    std::string packagePath;
+    std::string catalogProductAndVersion;  // e.g. "uc/1.0.0.150"
+};
+
+/**
+ * @brief installOptions key: when non-zero, package triggers are left pending until processPendingTriggers().
+ */
+const std::string kInstallOptionDeferTriggers {"deferTriggers"};
+
+/**
+ * @brief installOptions key: how long (in seconds) an install may wait for another package manager to release its lock.
+ */
+const std::string kInstallOptionLockWaitTimeoutSec {"lockWaitTimeout_s"};
+
+/**
+ * @brief installOptions key: when non-zero, packages whose exact version is already installed are not reinstalled.
+ */
+const std::string kInstallOptionSkipInstalledVersion {"skipInstalledVersion"};
+
+/**
+ * @brief Counters collected by the package utility across installs.
+ */
+struct PackageInstallMetrics {
+    uint32_t packagesInstalled = 0;
+    uint32_t packagesWithDeferredTriggers = 0;
+    uint32_t deferredTriggerRuns = 0;
+    std::chrono::milliseconds triggerProcessingTime {0}; /**< Measured time of the deferred trigger runs. */
+    /**
+     * @brief Rough estimate, not a measurement: assumes every package of a deferred trigger run would have spent
+     *        as long on a trigger run of its own. Packages that activate fewer triggers make it an overestimate.
+     */
+    std::chrono::milliseconds roughTriggerTimeSavedEstimate {0};
+    std::chrono::milliseconds lockWaitTime {0};
+    uint32_t lockWaitTimeouts = 0;
+    uint32_t packagesSkippedAlreadyInstalled = 0;
+    uint32_t packagesRejectedArchitecture = 0;
+};
+
 typedef enum
 {
     NAME = 0,
@@ -28,6 +75,9 @@ public:
     virtual bool isValidInstallerType(const std::string &installerType) const = 0;
     virtual std::vector<std::string> listPackages() const = 0;
     virtual PackageInfo getPackageInfo(const PKG_ID_TYPE& identifierType, const std::string& packageIdentifier) const = 0;
+    // Every installed package in one pass over the package database. packageIdentifier is the NVRA, empty if the
+    // backend does not support NVRA lookups. False if the database could not be read.
+    virtual bool listInstalledPackages(std::vector<PackageInfo>& packages) const = 0;
     virtual std::vector<std::string> listPackageFiles(const PKG_ID_TYPE& identifierType, const std::string& packageIdentifier) const = 0;
     
     // Install with catalog context (catalog information from manifest)
@@ -35,7 +85,25 @@ public:
         const std::string& packagePath, 
         const std::string& catalogProductAndVersion,  // e.g. "uc/1.0.0.150"
         const std::map<std::string, int>& installOptions = {}) const = 0;
+
+    // Install several packages with catalog context. Returns one result per request, in request order.
+    // The component manager installs one package per call, so nothing batches installs through this yet.
+    virtual std::vector<bool> installPackagesWithContext(
+        const std::vector<PackageInstallRequest>& packages,
+        const std::map<std::string, int>& installOptions = {}) const = 0;
     
+    // Runs trigger processing left pending by installs made with kInstallOptionDeferTriggers.
+    virtual bool processPendingTriggers() const = 0;
+    virtual PackageInstallMetrics getInstallMetrics() const = 0;
+
+    // Package database change tracking. The generation grows whenever installed packages change, 0 means untracked.
+    virtual uint64_t getPackageDbGeneration() const = 0;
+    // Names of the packages changed after the given generation. False if unknown: every package must be treated as changed.
+    virtual bool getChangedPackagesSince(uint64_t generation, std::set<std::string>& packageNames) const = 0;
+
     virtual bool uninstallPackage(const std::string& packageIdentifier) const = 0;
+    // Removes several packages in one package manager transaction, so the lock and database rewrite are paid once.
+    // False if the transaction failed; some of the packages may have been removed.
+    virtual bool uninstallPackages(const std::vector<std::string>& packageIdentifiers) const = 0;
     virtual bool verifyPackage(const std::string& packagePath, const std::string& signerKeyID) const = 0;
 };
\ No newline at end of file
@@ -0,0 +1,209 @@
+#include "InstallJournal.hpp"
+#include "AtomicFileWriter.hpp"
+#include "PmLogger.hpp"
+#include <algorithm>
+#include <cctype>
+#include <errno.h>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+namespace { //anonymous namespace
+    const char fieldSeparator = '\t';
+    const char recordSeparator = '\n';
+
+    const char* const phaseNames[] = {"started", "verified", "finished"};
+
+    uint64_t Fnv1a64(const std::string& data) {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (const char c : data) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    std::string ChecksumOf(const std::string& record) {
+        char checksum[17];
+        (void)snprintf(checksum, sizeof(checksum), "%016llx", static_cast<unsigned long long>(Fnv1a64(record)));
+        return checksum;
+    }
+
+    // Separators in a field would break the record apart.
+    std::string Sanitize(std::string field) {
+        std::replace(field.begin(), field.end(), fieldSeparator, ' ');
+        std::replace(field.begin(), field.end(), recordSeparator, ' ');
+        return field;
+    }
+
+    std::string Lowercase(std::string value) {
+        std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+        return value;
+    }
+
+    std::string FormatRecord(const std::string& component, const InstallJournal::Entry& entry) {
+        std::string record = phaseNames[static_cast<size_t>(entry.phase)];
+        record += fieldSeparator + std::to_string(entry.result) + fieldSeparator + Sanitize(Lowercase(entry.digest)) + fieldSeparator + Sanitize(component);
+        return ChecksumOf(record) + fieldSeparator + record + recordSeparator;
+    }
+
+    bool ParsePhase(const std::string& name, InstallJournal::Phase& phase) {
+        for (size_t i = 0; i < sizeof(phaseNames) / sizeof(phaseNames[0]); ++i) {
+            if (name == phaseNames[i]) {
+                phase = static_cast<InstallJournal::Phase>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+InstallJournal::InstallJournal(const std::filesystem::path& filePath) : filePath_(filePath) {
+    Load();
+    fd_ = open(filePath_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd_ < 0) {
+        PM_LOG_ERROR("Unable to open the install journal %s: %d", filePath_.c_str(), errno);
+    }
+}
+
+InstallJournal::~InstallJournal() {
+    if (fd_ >= 0) {
+        (void)close(fd_);
+    }
+}
+
+bool InstallJournal::Record(const std::string& component, const std::string& digest, Phase phase, int32_t result) {
+    const std::string line = FormatRecord(component, {digest, phase, result});
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fd_ < 0) {
+        return false;
+    }
+    // O_APPEND places the whole line at the end in one write.
+    size_t written = 0;
+    while (written < line.size()) {
+        const ssize_t bytesWritten = write(fd_, line.data() + written, line.size() - written);
+        if (bytesWritten < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytesWritten < 0) {
+            PM_LOG_ERROR("Unable to write the install journal %s: %d", filePath_.c_str(), errno);
+            return false;
+        }
+        written += static_cast<size_t>(bytesWritten);
+    }
+
+    if (phase == Phase::Finished && fdatasync(fd_) != 0) {
+        PM_LOG_ERROR("Unable to sync the install journal %s: %d", filePath_.c_str(), errno);
+        return false;
+    }
+    return true;
+}
+
+bool InstallJournal::Recovered(const std::string& component, Entry& entry) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto recovered = recovered_.find(component);
+    if (recovered == recovered_.end()) {
+        return false;
+    }
+    entry = recovered->second;
+    return true;
+}
+
+void InstallJournal::Forget(const std::string& component) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (component.find('/') != std::string::npos) {
+        (void)recovered_.erase(component);
+        return;
+    }
+    const std::string prefix = component + "/";
+    for (auto recovered = recovered_.begin(); recovered != recovered_.end();) {
+        const bool ofProduct = recovered->first == component || recovered->first.compare(0, prefix.size(), prefix) == 0;
+        recovered = ofProduct ? recovered_.erase(recovered) : std::next(recovered);
+    }
+}
+
+void InstallJournal::Retain(const std::function<bool(const std::string& component, const Entry& entry)>& keep) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto recovered = recovered_.begin(); recovered != recovered_.end();) {
+        recovered = keep(recovered->first, recovered->second) ? std::next(recovered) : recovered_.erase(recovered);
+    }
+}
+
+size_t InstallJournal::RecoveredEntries() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return recovered_.size();
+}
+
+bool InstallJournal::Compact() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string contents;
+    for (const auto& recovered : recovered_) {
+        contents += FormatRecord(recovered.first, recovered.second);
+    }
+    // Replaced rather than truncated, so a crash leaves either the old records or the compacted ones.
+    if (!PackageManager::AtomicFileWriter::Write(filePath_, contents, {})) {
+        PM_LOG_ERROR("Unable to compact the install journal %s", filePath_.c_str());
+        return false;
+    }
+    if (fd_ >= 0) {
+        (void)close(fd_);
+    }
+    fd_ = open(filePath_.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (fd_ < 0) {
+        PM_LOG_ERROR("Unable to open the install journal %s: %d", filePath_.c_str(), errno);
+        return false;
+    }
+    return true;
+}
+
+void InstallJournal::Load() {
+    std::ifstream file(filePath_, std::ios::binary);
+    if (!file.is_open()) {
+        return;
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    const std::string journal = contents.str();
+
+    size_t ignoredRecords = 0;
+    size_t start = 0;
+    // A last line without its separator was torn by the crash.
+    for (size_t end = journal.find(recordSeparator); end != std::string::npos; start = end + 1, end = journal.find(recordSeparator, start)) {
+        const std::string line = journal.substr(start, end - start);
+        std::vector<std::string> fields;
+        std::istringstream fieldStream(line);
+        for (std::string field; std::getline(fieldStream, field, fieldSeparator);) {
+            fields.push_back(field);
+        }
+        if (line.empty() || line.back() == fieldSeparator) {
+            fields.emplace_back();
+        }
+
+        Entry entry;
+        char* resultEnd = nullptr;
+        const bool valid = fields.size() == 5 && fields[0] == ChecksumOf(line.substr(fields[0].size() + 1)) &&
+            ParsePhase(fields[1], entry.phase) && !fields[2].empty() && !fields[4].empty();
+        if (valid) {
+            entry.result = static_cast<int32_t>(strtol(fields[2].c_str(), &resultEnd, 10));
+        }
+        if (!valid || *resultEnd != '\0') {
+            ++ignoredRecords;
+            continue;
+        }
+        entry.digest = fields[3];
+        recovered_[fields[4]] = entry;
+    }
+    if (start < journal.size()) {
+        ++ignoredRecords;
+    }
+
+    if (!recovered_.empty() || ignoredRecords != 0) {
+        PM_LOG_INFO("Recovered %zu components from the install journal, ignored %zu damaged records",
+            recovered_.size(), ignoredRecords);
+    }
+}
@@ -0,0 +1,89 @@
+/**
+ * @file
+ *
+ * @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+ */
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @brief Write-ahead journal of the installs of the current cycle, so that an agent restarted mid-cycle
+ *        resumes where it stopped instead of verifying and installing every component again.
+ *
+ * Each record is one line of phase, result, digest and component, prefixed with an FNV-1a checksum of the rest;
+ * a line that is torn or fails its checksum is ignored. Records are appended as they happen and synced with
+ * fdatasync() when a component finishes, which also covers the records written since the previous sync.
+ * Records lost with the host only cost doing that step again. The records of the previous run are read once,
+ * on construction. Thread safe.
+ */
+class InstallJournal {
+public:
+    enum class Phase {
+        Started,
+        Verified,
+        Finished
+    };
+
+    struct Entry {
+        std::string digest; /**< Lowercase hex SHA-256 digest of the installer, may be empty. */
+        Phase phase = Phase::Started;
+        int32_t result = 0; /**< Result of the install, for Phase::Finished. */
+    };
+
+    /**
+     * @brief Reads the records of the previous run and opens the journal for appending.
+     */
+    explicit InstallJournal(const std::filesystem::path& filePath);
+    ~InstallJournal();
+
+    InstallJournal(const InstallJournal&) = delete;
+    InstallJournal& operator=(const InstallJournal&) = delete;
+
+    /**
+     * @brief Appends a record, and syncs the journal if it finishes a component.
+     * @return False if the record could not be written.
+     */
+    bool Record(const std::string& component, const std::string& digest, Phase phase, int32_t result = 0);
+
+    /**
+     * @brief The last phase the previous run recorded for a component.
+     * @return False if it recorded nothing for the component.
+     */
+    bool Recovered(const std::string& component, Entry& entry) const;
+
+    /**
+     * @brief Drops what the previous run recorded for a component, or for every version of a product if
+     *        component has no version.
+     */
+    void Forget(const std::string& component);
+
+    /**
+     * @brief Drops what the previous run recorded for every component the predicate does not keep.
+     */
+    void Retain(const std::function<bool(const std::string& component, const Entry& entry)>& keep);
+
+    /**
+     * @brief Number of components the previous run recorded.
+     */
+    size_t RecoveredEntries() const;
+
+    /**
+     * @brief Rewrites the journal with only the records of the previous run that were not forgotten yet, once
+     *        the records of this run no longer matter. What was recovered is kept, in memory and on disk.
+     */
+    bool Compact();
+
+private:
+    void Load();
+
+    const std::filesystem::path filePath_;
+    mutable std::mutex mutex_;
+    int fd_ = -1;
+    std::unordered_map<std::string, Entry> recovered_; /**< Keyed on the component. */
+};
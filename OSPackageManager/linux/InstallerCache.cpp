@@ -0,0 +1,328 @@
+#include "InstallerCache.hpp"
+#include "AtomicFileWriter.hpp"
+#include "FileFingerprintCache.hpp"
+#include "PmLogger.hpp"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <json/json.h>
+#include <linux/fs.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace { //anonymous namespace
+    const int indexVersion = 1;
+    const std::string indexFileName {"index.json"};
+    const std::string tempSuffix {".tmp"};
+    const std::string versionKey {"version"};
+    const std::string installersKey {"installers"};
+    const std::string sizeKey {"size"};
+    const std::string inodeKey {"inode"};
+    const std::string mtimeKey {"mtimeNs"};
+    const std::string lastUsedKey {"lastUsed"};
+    const std::string useOrderKey {"useOrder"};
+    const size_t sha256HexLength = 64;
+
+    int64_t NowSeconds() {
+        return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    int64_t MtimeNs(const struct stat& fileStat) {
+        return static_cast<int64_t>(fileStat.st_mtim.tv_sec) * 1000000000LL + fileStat.st_mtim.tv_nsec;
+    }
+
+    // Digests are file names, so anything but hex is rejected.
+    bool NormalizeDigest(const std::string& sha256, std::string& normalized) {
+        if (sha256.size() != sha256HexLength) {
+            return false;
+        }
+        normalized.clear();
+        for (const char c : sha256) {
+            if (!isxdigit(static_cast<unsigned char>(c))) {
+                return false;
+            }
+            normalized.push_back(static_cast<char>(tolower(static_cast<unsigned char>(c))));
+        }
+        return true;
+    }
+
+    // Links the open file itself, so that the linked file is the one that was hashed.
+    bool LinkOrClone(int fd, const std::filesystem::path& installerPath, const std::filesystem::path& target) {
+        char fdPath[32];
+        (void)snprintf(fdPath, sizeof(fdPath), "/proc/self/fd/%d", fd);
+        if (linkat(AT_FDCWD, fdPath, AT_FDCWD, target.c_str(), AT_SYMLINK_FOLLOW) == 0) {
+            return true;
+        }
+        if (errno != EXDEV) {
+            PM_LOG_WARNING("Unable to link %s into the installer cache: %d", installerPath.c_str(), errno);
+            return false;
+        }
+
+        const int targetFd = open(target.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR);
+        if (targetFd < 0) {
+            PM_LOG_WARNING("Unable to create %s: %d", target.c_str(), errno);
+            return false;
+        }
+        const bool cloned = ioctl(targetFd, FICLONE, fd) == 0;
+        const int cloneErrno = errno;
+        (void)close(targetFd);
+        if (!cloned) {
+            PM_LOG_INFO("Not caching %s, it is on another file system that cannot share its blocks: %d",
+                installerPath.c_str(), cloneErrno);
+            (void)unlink(target.c_str());
+        }
+        return cloned;
+    }
+}
+
+InstallerCache::InstallerCache(const std::filesystem::path& directory, std::chrono::seconds maxAge, uint64_t maxBytes)
+    : directory_(directory), indexPath_(directory / indexFileName), maxAge_(maxAge), maxBytes_(maxBytes) {
+    std::error_code errCode;
+    std::filesystem::create_directories(directory_, errCode);
+    if (errCode) {
+        PM_LOG_WARNING("Unable to create %s: %s", directory_.c_str(), errCode.message().c_str());
+    }
+    std::filesystem::permissions(directory_, std::filesystem::perms::owner_all, std::filesystem::perm_options::replace, errCode);
+    LoadIndex();
+}
+
+bool InstallerCache::Add(const std::filesystem::path& installerPath, const std::string& sha256, bool digestVerified) {
+    std::string digest;
+    if (!NormalizeDigest(sha256, digest)) {
+        PM_LOG_WARNING("Not caching %s, invalid digest \"%s\"", installerPath.c_str(), sha256.c_str());
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto cached = entries_.find(digest);
+        if (cached != entries_.end()) {
+            if (IsIntact(digest, cached->second)) {
+                MarkUsed(cached->second);
+                (void)SaveIndex();
+                return true;
+            }
+            Remove(digest);
+        }
+    }
+
+    // Hashed outside the lock, installers can be large.
+    const int fd = open(installerPath.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        PM_LOG_WARNING("Unable to open %s: %d", installerPath.c_str(), errno);
+        return false;
+    }
+    struct FdCloser {
+        int fd;
+        ~FdCloser() { (void)close(fd); }
+    } fdCloser {fd};
+
+    struct stat fileStat {};
+    if (fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+        PM_LOG_WARNING("Unable to add %s, it is not a regular file", installerPath.c_str());
+        return false;
+    }
+    std::string actualDigest = digest;
+    if (!digestVerified && !FileFingerprintCache::Sha256(fd, actualDigest)) {
+        PM_LOG_WARNING("Unable to hash %s", installerPath.c_str());
+        return false;
+    }
+    if (actualDigest != digest) {
+        PM_LOG_WARNING("Not caching %s, its SHA-256 is %s instead of %s", installerPath.c_str(), actualDigest.c_str(), digest.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.count(digest) != 0) {
+        MarkUsed(entries_[digest]);
+        return SaveIndex();
+    }
+
+    std::filesystem::path tempPath = PathOf(digest);
+    tempPath += tempSuffix;
+    (void)unlink(tempPath.c_str());
+    if (!LinkOrClone(fd, installerPath, tempPath)) {
+        return false;
+    }
+
+    struct stat cachedStat {};
+    if (stat(tempPath.c_str(), &cachedStat) != 0 || rename(tempPath.c_str(), PathOf(digest).c_str()) != 0) {
+        PM_LOG_WARNING("Unable to add %s to the installer cache: %d", installerPath.c_str(), errno);
+        (void)unlink(tempPath.c_str());
+        return false;
+    }
+
+    Entry& entry = entries_[digest];
+    entry = {static_cast<uint64_t>(cachedStat.st_size), cachedStat.st_ino, MtimeNs(cachedStat)};
+    MarkUsed(entry);
+    bytes_ += static_cast<uint64_t>(cachedStat.st_size);
+    PM_LOG_DEBUG("Cached installer %s as %s", installerPath.c_str(), digest.c_str());
+    return SaveIndex();
+}
+
+std::filesystem::path InstallerCache::Lookup(const std::string& sha256) {
+    std::string digest;
+    if (!NormalizeDigest(sha256, digest)) {
+        return {};
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto cached = entries_.find(digest);
+    if (cached == entries_.end()) {
+        return {};
+    }
+    if (!IsIntact(digest, cached->second)) {
+        PM_LOG_WARNING("Cached installer %s changed, dropping it", digest.c_str());
+        Remove(digest);
+        (void)SaveIndex();
+        return {};
+    }
+
+    MarkUsed(cached->second);
+    (void)SaveIndex();
+    return PathOf(digest);
+}
+
+size_t InstallerCache::Evict() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int64_t now = NowSeconds();
+
+    std::vector<std::pair<uint64_t, std::string>> byLastUse;
+    std::vector<std::string> evicted;
+    for (const auto& cached : entries_) {
+        if (cached.second.lastUsed + maxAge_.count() <= now) {
+            evicted.push_back(cached.first);
+        } else {
+            byLastUse.emplace_back(cached.second.useOrder, cached.first);
+        }
+    }
+    for (const auto& digest : evicted) {
+        Remove(digest);
+    }
+
+    std::sort(byLastUse.begin(), byLastUse.end());
+    for (const auto& cached : byLastUse) {
+        if (maxBytes_ == 0 || bytes_ <= maxBytes_) {
+            break;
+        }
+        Remove(cached.second);
+        evicted.push_back(cached.second);
+    }
+
+    if (!evicted.empty()) {
+        PM_LOG_INFO("Evicted %zu installers from the installer cache, %zu left", evicted.size(), entries_.size());
+        (void)SaveIndex();
+    }
+    return evicted.size();
+}
+
+size_t InstallerCache::Entries() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+uint64_t InstallerCache::Bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+void InstallerCache::MarkUsed(Entry& entry) {
+    entry.lastUsed = NowSeconds();
+    entry.useOrder = nextUseOrder_++;
+}
+
+bool InstallerCache::IsIntact(const std::string& sha256, const Entry& entry) const {
+    struct stat fileStat {};
+    return lstat(PathOf(sha256).c_str(), &fileStat) == 0 && S_ISREG(fileStat.st_mode) &&
+        static_cast<uint64_t>(fileStat.st_size) == entry.size && fileStat.st_ino == entry.inode &&
+        MtimeNs(fileStat) == entry.mtimeNs;
+}
+
+void InstallerCache::Remove(const std::string& sha256) {
+    const auto cached = entries_.find(sha256);
+    if (cached == entries_.end()) {
+        return;
+    }
+    if (unlink(PathOf(sha256).c_str()) != 0 && errno != ENOENT) {
+        PM_LOG_WARNING("Unable to remove cached installer %s: %d", sha256.c_str(), errno);
+    }
+    bytes_ -= cached->second.size;
+    entries_.erase(cached);
+}
+
+void InstallerCache::LoadIndex() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ifstream file(indexPath_, std::ios::binary);
+    Json::Value root;
+    JSONCPP_STRING errors;
+    Json::CharReaderBuilder builder;
+    size_t indexedEntries = 0;
+    if (file.is_open() && Json::parseFromStream(builder, file, &root, &errors) && root.isObject() &&
+        root.get(versionKey, 0).asInt() == indexVersion && root[installersKey].isObject()) {
+        const Json::Value& installers = root[installersKey];
+        indexedEntries = installers.size();
+        for (const auto& digest : installers.getMemberNames()) {
+            const Json::Value& jsonEntry = installers[digest];
+            std::string normalized;
+            if (!NormalizeDigest(digest, normalized) || normalized != digest) {
+                continue;
+            }
+            Entry entry;
+            entry.size = jsonEntry[sizeKey].asUInt64();
+            entry.inode = static_cast<ino_t>(jsonEntry[inodeKey].asUInt64());
+            entry.mtimeNs = jsonEntry[mtimeKey].asInt64();
+            entry.lastUsed = jsonEntry[lastUsedKey].asInt64();
+            entry.useOrder = jsonEntry[useOrderKey].asUInt64();
+            if (IsIntact(digest, entry)) {
+                entries_[digest] = entry;
+                bytes_ += entry.size;
+                nextUseOrder_ = std::max(nextUseOrder_, entry.useOrder + 1);
+            }
+        }
+    } else if (file.is_open()) {
+        PM_LOG_WARNING("Unable to read the installer cache index %s, starting empty", indexPath_.c_str());
+    }
+
+    // Files of interrupted additions and of dropped entries.
+    std::error_code errCode;
+    bool removedFiles = false;
+    for (const auto& directoryEntry : std::filesystem::directory_iterator(directory_, errCode)) {
+        const std::string name = directoryEntry.path().filename().string();
+        if (name != indexFileName && entries_.count(name) == 0) {
+            std::error_code removeErrCode;
+            removedFiles = std::filesystem::remove(directoryEntry.path(), removeErrCode) || removedFiles;
+        }
+    }
+    if (removedFiles || entries_.size() != indexedEntries) {
+        (void)SaveIndex();
+    }
+}
+
+bool InstallerCache::SaveIndex() {
+    Json::Value root;
+    root[versionKey] = indexVersion;
+    Json::Value& installers = root[installersKey] = Json::Value(Json::objectValue);
+    for (const auto& cached : entries_) {
+        Json::Value& jsonEntry = installers[cached.first];
+        jsonEntry[sizeKey] = Json::UInt64(cached.second.size);
+        jsonEntry[inodeKey] = Json::UInt64(cached.second.inode);
+        jsonEntry[mtimeKey] = Json::Int64(cached.second.mtimeNs);
+        jsonEntry[lastUsedKey] = Json::Int64(cached.second.lastUsed);
+        jsonEntry[useOrderKey] = Json::UInt64(cached.second.useOrder);
+    }
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    const std::string contents = Json::writeString(builder, root);
+
+    return PackageManager::AtomicFileWriter::Write(indexPath_, contents, {});
+}
+
+std::filesystem::path InstallerCache::PathOf(const std::string& sha256) const {
+    return directory_ / sha256;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file
+ *
+ * @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+
+/**
+ * @brief Installers kept under their SHA-256 digest, so that an installer that is needed again once its
+ *        download is gone is served without downloading it again.
+ *
+ * Files enter by hard link, or by reflink when the cache is on another file system, and are never copied;
+ * a file that can be neither linked nor cloned is not cached. The digest, size, identity and last use of each
+ * installer are kept in an index file next to them, which is replaced atomically. An installer whose file no
+ * longer has the indexed identity is dropped rather than served. Entries unused for longer than the maximum
+ * age are evicted first, then the least recently used ones until the total size fits the cap. Thread safe.
+ */
+class InstallerCache {
+public:
+    /**
+     * @param directory Created if missing; only the cache should write to it.
+     * @param maxAge Entries unused for longer are evicted.
+     * @param maxBytes Total size of the cached installers after eviction, 0 for no cap.
+     */
+    InstallerCache(const std::filesystem::path& directory, std::chrono::seconds maxAge, uint64_t maxBytes);
+
+    /**
+     * @brief Adds an installer if its contents have the expected digest. Adding a cached digest only marks
+     *        it used.
+     * @param sha256 Hex SHA-256 digest of the installer, in either case.
+     * @param digestVerified True if the caller has just hashed the installer and found this digest, so it is
+     *        not hashed again.
+     * @return False if the digest does not match or the installer cannot be linked in.
+     */
+    bool Add(const std::filesystem::path& installerPath, const std::string& sha256, bool digestVerified = false);
+
+    /**
+     * @brief Returns the path of the cached installer with the digest and marks it used.
+     * @return Empty if the digest is not cached.
+     */
+    std::filesystem::path Lookup(const std::string& sha256);
+
+    /**
+     * @brief Evicts expired entries, then the least recently used ones while the cache is over its size cap.
+     * @return Number of evicted installers.
+     */
+    size_t Evict();
+
+    /**
+     * @brief Number of cached installers.
+     */
+    size_t Entries() const;
+
+    /**
+     * @brief Total size of the cached installers.
+     */
+    uint64_t Bytes() const;
+
+private:
+    struct Entry {
+        uint64_t size = 0;
+        ino_t inode = 0;
+        int64_t mtimeNs = 0;
+        int64_t lastUsed = 0; /**< Seconds since the epoch. */
+        uint64_t useOrder = 0; /**< Larger for later uses, orders uses within the same second. */
+    };
+
+    /**
+     * @brief Records a use of an entry. Called with mutex_ held.
+     */
+    void MarkUsed(Entry& entry);
+
+    /**
+     * @brief Returns true if the cached file is still the one that was linked in. Called with mutex_ held.
+     */
+    bool IsIntact(const std::string& sha256, const Entry& entry) const;
+
+    /**
+     * @brief Removes an entry and its file. Called with mutex_ held.
+     */
+    void Remove(const std::string& sha256);
+
+    /**
+     * @brief Reads the index and drops entries whose files changed, and files that are not indexed.
+     */
+    void LoadIndex();
+
+    /**
+     * @brief Writes the index. Called with mutex_ held.
+     */
+    bool SaveIndex();
+
+    std::filesystem::path PathOf(const std::string& sha256) const;
+
+    const std::filesystem::path directory_;
+    const std::filesystem::path indexPath_;
+    const std::chrono::seconds maxAge_;
+    const uint64_t maxBytes_;
+    mutable std::mutex mutex_;
+    std::map<std::string, Entry> entries_; /**< Keyed on the lowercase hex digest. */
+    uint64_t bytes_ = 0;
+    uint64_t nextUseOrder_ = 0;
+};
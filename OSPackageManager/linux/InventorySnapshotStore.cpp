@@ -0,0 +1,215 @@
+#include "InventorySnapshotStore.hpp"
+#include "AtomicFileWriter.hpp"
+#include "PmLogger.hpp"
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace { //anonymous namespace
+    const char snapshotMagic[8] = {'P', 'M', 'I', 'N', 'V', 'S', 'N', 'P'};
+    const uint32_t snapshotVersion = 1;
+
+    struct SnapshotHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t payloadSize;
+        uint64_t checksum;
+    };
+
+    uint64_t Fnv1a64(const char* data, size_t size) {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    class PayloadWriter {
+    public:
+        template <typename T>
+        void Put(T value) {
+            buffer_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+        void Put(const std::string& value) {
+            Put(static_cast<uint32_t>(value.size()));
+            buffer_.append(value);
+        }
+        void Put(const std::filesystem::path& value) {
+            Put(value.generic_u8string());
+        }
+        std::string& Buffer() { return buffer_; }
+
+    private:
+        std::string buffer_;
+    };
+
+    class PayloadReader {
+    public:
+        PayloadReader(const char* data, size_t size) : data_(data), size_(size) {}
+
+        template <typename T>
+        bool Get(T& value) {
+            if (size_ - offset_ < sizeof(value))
+                return false;
+            std::memcpy(&value, data_ + offset_, sizeof(value));
+            offset_ += sizeof(value);
+            return true;
+        }
+        bool Get(std::string& value) {
+            uint32_t length = 0;
+            if (!Get(length) || size_ - offset_ < length)
+                return false;
+            value.assign(data_ + offset_, length);
+            offset_ += length;
+            return true;
+        }
+        bool Get(std::filesystem::path& value) {
+            std::string text;
+            if (!Get(text))
+                return false;
+            value = std::filesystem::u8path(text);
+            return true;
+        }
+        bool AtEnd() const { return offset_ == size_; }
+
+    private:
+        const char* data_;
+        size_t size_;
+        size_t offset_ = 0;
+    };
+
+    std::string Serialize(const PackageInventory& inventory, uint64_t inventoryGeneration) {
+        PayloadWriter payload;
+        payload.Put(inventoryGeneration);
+        payload.Put(inventory.architecture);
+        payload.Put(inventory.platform);
+        payload.Put(static_cast<uint32_t>(inventory.packages.size()));
+        for (const auto& package : inventory.packages) {
+            payload.Put(package.product);
+            payload.Put(package.version);
+            payload.Put(static_cast<uint32_t>(package.configs.size()));
+            for (const auto& config : package.configs) {
+                payload.Put(config.cfgPath);
+                payload.Put(config.unresolvedCfgPath);
+                payload.Put(config.deployPath);
+                payload.Put(config.unresolvedDeployPath);
+                payload.Put(config.sha256);
+                payload.Put(static_cast<uint8_t>(config.isDiscoveredAtDeployPath ? 1 : 0));
+            }
+        }
+
+        SnapshotHeader header {};
+        std::memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+        header.version = snapshotVersion;
+        header.payloadSize = payload.Buffer().size();
+        header.checksum = Fnv1a64(payload.Buffer().data(), payload.Buffer().size());
+
+        std::string contents(reinterpret_cast<const char*>(&header), sizeof(header));
+        contents.append(payload.Buffer());
+        return contents;
+    }
+
+    bool Deserialize(const char* data, size_t size, PackageInventory& inventory, uint64_t& inventoryGeneration) {
+        SnapshotHeader header {};
+        if (size < sizeof(header))
+            return false;
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, snapshotMagic, sizeof(header.magic)) != 0 || header.version != snapshotVersion) {
+            PM_LOG_WARNING("Unsupported inventory snapshot");
+            return false;
+        }
+        if (header.payloadSize != size - sizeof(header) ||
+            header.checksum != Fnv1a64(data + sizeof(header), header.payloadSize)) {
+            PM_LOG_WARNING("Inventory snapshot is truncated or corrupt");
+            return false;
+        }
+
+        PayloadReader payload(data + sizeof(header), header.payloadSize);
+        PackageInventory snapshot;
+        uint64_t generation = 0;
+        uint32_t packageCount = 0;
+        if (!payload.Get(generation) || !payload.Get(snapshot.architecture) || !payload.Get(snapshot.platform) ||
+            !payload.Get(packageCount))
+            return false;
+
+        for (uint32_t i = 0; i < packageCount; ++i) {
+            PmInstalledPackage package;
+            uint32_t configCount = 0;
+            if (!payload.Get(package.product) || !payload.Get(package.version) || !payload.Get(configCount))
+                return false;
+            for (uint32_t j = 0; j < configCount; ++j) {
+                PackageConfigInfo config = {};
+                uint8_t discoveredAtDeployPath = 0;
+                if (!payload.Get(config.cfgPath) || !payload.Get(config.unresolvedCfgPath) ||
+                    !payload.Get(config.deployPath) || !payload.Get(config.unresolvedDeployPath) ||
+                    !payload.Get(config.sha256) || !payload.Get(discoveredAtDeployPath))
+                    return false;
+                config.isDiscoveredAtDeployPath = discoveredAtDeployPath != 0;
+                package.configs.push_back(std::move(config));
+            }
+            snapshot.packages.push_back(std::move(package));
+        }
+        if (!payload.AtEnd())
+            return false;
+
+        inventory = std::move(snapshot);
+        inventoryGeneration = generation;
+        return true;
+    }
+}
+
+InventorySnapshotStore::InventorySnapshotStore(const std::filesystem::path& filePath)
+    : filePath_(filePath) {
+}
+
+bool InventorySnapshotStore::Save(const PackageInventory& inventory, uint64_t inventoryGeneration) {
+    const std::string contents = Serialize(inventory, inventoryGeneration);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (contents == storedContents_) {
+        return true;
+    }
+
+    if (!PackageManager::AtomicFileWriter::Write(filePath_, contents, {})) {
+        return false;
+    }
+
+    storedContents_ = contents;
+    return true;
+}
+
+bool InventorySnapshotStore::Load(PackageInventory& inventory, uint64_t& inventoryGeneration) {
+    const int fd = open(filePath_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno != ENOENT)
+            PM_LOG_WARNING("Unable to open %s: %d", filePath_.c_str(), errno);
+        return false;
+    }
+
+    struct stat fileStat {};
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0) {
+        (void)close(fd);
+        return false;
+    }
+    const size_t size = static_cast<size_t>(fileStat.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    (void)close(fd);
+    if (mapping == MAP_FAILED) {
+        PM_LOG_WARNING("Unable to map %s: %d", filePath_.c_str(), errno);
+        return false;
+    }
+
+    const char* data = static_cast<const char*>(mapping);
+    std::lock_guard<std::mutex> lock(mutex_);
+    const bool loaded = Deserialize(data, size, inventory, inventoryGeneration);
+    if (loaded) {
+        storedContents_.assign(data, size);
+    }
+    (void)munmap(mapping, size);
+    return loaded;
+}
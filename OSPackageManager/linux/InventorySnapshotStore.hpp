@@ -0,0 +1,44 @@
+/**
+ * @file
+ *
+ * @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+ */
+#pragma once
+
+#include "PackageManager/PmTypes.h"
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+
+/**
+ * @brief Keeps the last discovered inventory on disk, so that a restarted agent has a cached inventory
+ *        before its first discovery finishes.
+ *
+ * The file is a fixed header (magic, format version, payload size, FNV-1a checksum of the payload) followed
+ * by a length-prefixed binary payload in host byte order; it is only meant to be read back on the same host.
+ * It is loaded through a read-only mapping and rejected as a whole if any check fails. Writes go to a
+ * temporary file that is synced and renamed over the previous one, and are skipped when nothing changed.
+ */
+class InventorySnapshotStore {
+public:
+    explicit InventorySnapshotStore(const std::filesystem::path& filePath);
+
+    /**
+     * @brief Writes the inventory unless it is identical to the stored one.
+     * @param inventoryGeneration The inventory generation the inventory was published at.
+     * @return False if the file could not be written.
+     */
+    bool Save(const PackageInventory& inventory, uint64_t inventoryGeneration);
+
+    /**
+     * @brief Reads the stored inventory.
+     * @return False if there is no file, or it is truncated, corrupt or of another format version.
+     */
+    bool Load(PackageInventory& inventory, uint64_t& inventoryGeneration);
+
+private:
+    const std::filesystem::path filePath_;
+    std::mutex mutex_;
+    std::string storedContents_; /**< Contents of the file as last read or written. */
+};
@@ -0,0 +1,114 @@
+#include "KnownFolderCache.hpp"
+#include "PmLogger.hpp"
+#include <filesystem>
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace { //anonymous namespace
+    // utmp is written in place by login and logind, and replaced or removed by some tools.
+    const uint32_t utmpEvents = IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+}
+
+namespace PackageManager
+{
+
+constexpr std::chrono::seconds KnownFolderCache::kDefaultMaxAge;
+
+KnownFolderCache::KnownFolderCache(const std::string& utmpPath, std::chrono::seconds maxAge)
+    : utmpName_(std::filesystem::path(utmpPath).filename().string()), maxAge_(maxAge) {
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd_ < 0) {
+        PM_LOG_WARNING("inotify_init1 failed (%d), known folders are not cached", errno);
+        return;
+    }
+
+    // The directory is watched rather than the file, so that a replaced utmp is still seen.
+    const auto utmpDir = std::filesystem::path(utmpPath).parent_path();
+    if (inotify_add_watch(inotifyFd_, utmpDir.c_str(), utmpEvents | IN_ONLYDIR) < 0) {
+        PM_LOG_WARNING("Unable to watch %s (%d), known folders are not cached", utmpDir.c_str(), errno);
+        (void)close(inotifyFd_);
+        inotifyFd_ = -1;
+    }
+}
+
+KnownFolderCache::~KnownFolderCache() {
+    if (inotifyFd_ >= 0) {
+        (void)close(inotifyFd_);
+    }
+}
+
+std::string KnownFolderCache::Resolve(const std::string& knownFolderId, const std::function<void(std::string&)>& resolver) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto now = std::chrono::steady_clock::now();
+
+    if (inotifyFd_ >= 0) {
+        DrainEvents();
+        const auto cached = entries_.find(knownFolderId);
+        if (cached != entries_.end() && now - cached->second.resolvedAt < maxAge_) {
+            return cached->second.folder;
+        }
+    }
+
+    std::string folder;
+    resolver(folder);
+    ++resolutions_;
+    if (inotifyFd_ >= 0) {
+        entries_[knownFolderId] = {folder, now};
+    }
+    return folder;
+}
+
+std::vector<std::string> KnownFolderCache::ResolveForAllUsers(const std::string& knownFolderId,
+    const std::function<void(std::vector<std::string>&)>& resolver) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto now = std::chrono::steady_clock::now();
+
+    if (inotifyFd_ >= 0) {
+        DrainEvents();
+        const auto cached = allUsersEntries_.find(knownFolderId);
+        if (cached != allUsersEntries_.end() && now - cached->second.resolvedAt < maxAge_) {
+            return cached->second.folders;
+        }
+    }
+
+    std::vector<std::string> folders;
+    resolver(folders);
+    ++resolutions_;
+    if (inotifyFd_ >= 0) {
+        allUsersEntries_[knownFolderId] = {folders, now};
+    }
+    return folders;
+}
+
+size_t KnownFolderCache::Resolutions() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return resolutions_;
+}
+
+void KnownFolderCache::DrainEvents() {
+    alignas(struct inotify_event) char buffer[4096];
+
+    while (true) {
+        const ssize_t length = read(inotifyFd_, buffer, sizeof(buffer));
+        if (length < 0 && errno == EINTR) {
+            continue;
+        }
+        if (length <= 0) {
+            break;
+        }
+
+        for (ssize_t offset = 0; offset < length; ) {
+            const auto* event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+            offset += static_cast<ssize_t>(sizeof(struct inotify_event) + event->len);
+
+            // An overflow may have hidden a utmp change.
+            if ((event->mask & IN_Q_OVERFLOW) || (event->len > 0 && utmpName_ == event->name)) {
+                entries_.clear();
+                allUsersEntries_.clear();
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,84 @@
+/**
+ * @file
+ *
+ * @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+ */
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace PackageManager
+{
+
+/**
+ * @brief Remembers resolved known folders until the login sessions change.
+ *
+ * Known folders depend on the console user, which is looked up in utmp. The directory holding utmp is
+ * watched with inotify and every entry is dropped when utmp is written, replaced or removed. Entries also
+ * expire after a maximum age, because a session leader can die without its utmp record being cleared.
+ * Resolvers run under the cache lock, so the non-reentrant utmp and passwd functions they use are never
+ * called concurrently through it. Without inotify nothing is cached. Thread safe.
+ */
+class KnownFolderCache {
+public:
+    static constexpr std::chrono::seconds kDefaultMaxAge{60};
+
+    /**
+     * @param utmpPath The utmp file whose changes invalidate the cache.
+     * @param maxAge How long an entry is used at most.
+     */
+    explicit KnownFolderCache(const std::string& utmpPath, std::chrono::seconds maxAge = kDefaultMaxAge);
+    ~KnownFolderCache();
+
+    KnownFolderCache(const KnownFolderCache&) = delete;
+    KnownFolderCache& operator=(const KnownFolderCache&) = delete;
+
+    /**
+     * @brief Returns the cached folder of a known folder ID, calling the resolver on a miss. Failed
+     *        resolutions (empty folders) are cached as well.
+     */
+    std::string Resolve(const std::string& knownFolderId, const std::function<void(std::string&)>& resolver);
+
+    /**
+     * @brief Returns the cached folders of a known folder ID for every logged-in user, calling the resolver
+     *        on a miss. Cached separately from Resolve().
+     */
+    std::vector<std::string> ResolveForAllUsers(const std::string& knownFolderId,
+        const std::function<void(std::vector<std::string>&)>& resolver);
+
+    /**
+     * @brief Number of resolver calls so far.
+     */
+    size_t Resolutions() const;
+
+private:
+    struct Entry {
+        std::string folder;
+        std::chrono::steady_clock::time_point resolvedAt;
+    };
+
+    struct AllUsersEntry {
+        std::vector<std::string> folders;
+        std::chrono::steady_clock::time_point resolvedAt;
+    };
+
+    /**
+     * @brief Drops every entry if utmp changed since the previous call. Called with mutex_ held.
+     */
+    void DrainEvents();
+
+    const std::string utmpName_;
+    const std::chrono::seconds maxAge_;
+    int inotifyFd_ = -1;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;
+    std::unordered_map<std::string, AllUsersEntry> allUsersEntries_;
+    size_t resolutions_ = 0;
+};
+
+}
@@ -7,16 +7,44 @@
 #include <ctime>
 #include <filesystem>
 #include <sstream>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace { //anonymous namespace
     const std::string debPackageInstaller {"deb"};
     const std::string dpkgBinStr {"/bin/dpkg"};
     const std::string dpkgGetPkgInfoOption {"-s"};
     const std::string dpkgListPkgFilesOption {"-L"};
+    const std::string dpkgQueryBinStr {"/bin/dpkg-query"};
+    const std::string dpkgQueryShowOption {"-W"};
+    const std::string dpkgQueryShowFormatOption {"--showformat=${Package}\t${Version}\t${Architecture}\n"};
     const std::string dpkgInstallPkgOption {"-i"}; //Supports both install and upgrade
+    const std::string dpkgForceDependsOption {"--force-depends"};
+    const std::string dpkgForceConfoldOption {"--force-confold"};
+    const std::string dpkgNoTriggersOption {"--no-triggers"};
+    const std::string dpkgTriggersOnlyOption {"--triggers-only"};
+    const std::string dpkgPendingOption {"--pending"};
+    const std::string dpkgPrintArchitectureOption {"--print-architecture"};
+    const std::string dpkgPrintForeignArchitecturesOption {"--print-foreign-architectures"};
+    const std::string dpkgArchitectureAll {"all"};
+    const std::string dpkgInstalledStatusStr {" ok installed"};
     const std::string dpkgUninstallPkgOption {"-P"}; // -P: Purge (Removes configuration files also), -r: Remove (Keeps configuration files)
     const std::string dpkgSigBinStr {"/bin/dpkg-sig"};
     const std::string dpkgSigVerifyOption {"--verify"};
+    // Lock files taken by dpkg frontends (apt, unattended-upgrades) and by dpkg itself, in acquisition order.
+    const std::vector<std::string> dpkgLockFiles {"/var/lib/dpkg/lock-frontend", "/var/lib/dpkg/lock"};
+    const std::string dpkgLockedStr {"locked by another process"};
+    const std::chrono::seconds defaultLockWaitTimeout {120};
+    const std::chrono::milliseconds initialLockBackoff {250};
+    const std::chrono::milliseconds maxLockBackoff {15000};
+    // Progress and error messages of 'dpkg -i' used to attribute the combined output of a batch to its archives.
+    const std::string dpkgPreparingToUnpackStr {"Preparing to unpack "};
+    const std::string dpkgUnpackingStr {"Unpacking "};
+    const std::string dpkgSettingUpStr {"Setting up "};
+    const std::string dpkgErrorArchiveStr {"dpkg: error processing archive "};
+    const std::string dpkgErrorPackageStr {"dpkg: error processing package "};
+    const std::string dpkgErrorsEncounteredStr {"Errors were encountered while processing:"};
     const int signer_keyID_pos = 3; // The position of the key ID in the output line of dpkg-sig
     typedef enum {
         SIG_GOOD = 0,
@@ -60,6 +88,150 @@ namespace { //anonymous namespace
         }
     }
 
+    // Probes the dpkg lock files with F_GETLK, which reports a conflicting lock without taking it.
+    bool findDpkgLockHolder(pid_t& holderPid, std::string& lockFile) {
+        for (const auto& path : dpkgLockFiles) {
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                continue;
+            }
+
+            struct flock lockInfo = {};
+            lockInfo.l_type = F_WRLCK;
+            lockInfo.l_whence = SEEK_SET;
+            lockInfo.l_start = 0;
+            lockInfo.l_len = 0;
+            int ret = fcntl(fd, F_GETLK, &lockInfo);
+            (void)close(fd);
+
+            if (ret == 0 && lockInfo.l_type != F_UNLCK) {
+                holderPid = lockInfo.l_pid;
+                lockFile = path;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::chrono::seconds lockWaitTimeoutFromOptions(const std::map<std::string, int>& installOptions) {
+        const auto option = installOptions.find(kInstallOptionLockWaitTimeoutSec);
+        if (option == installOptions.end() || option->second < 0) {
+            return defaultLockWaitTimeout;
+        }
+        return std::chrono::seconds(option->second);
+    }
+
+    // dpkg prints archives as ".../<basename>" in its progress messages, so match on the basename as well.
+    int findArchiveIndex(const std::vector<std::string>& archivePaths, const std::string& token) {
+        const std::string tokenBaseName = std::filesystem::path(token).filename().string();
+        for (size_t i = 0; i < archivePaths.size(); ++i) {
+            if (archivePaths[i] == token || std::filesystem::path(archivePaths[i]).filename().string() == tokenBaseName) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    // Package names in dpkg messages may carry an architecture qualifier, e.g. "foo:amd64".
+    int findPackageIndex(const std::vector<std::string>& packageNames, const std::string& token) {
+        const std::string name = token.substr(0, token.find(':'));
+        for (size_t i = 0; i < packageNames.size(); ++i) {
+            if (!name.empty() && packageNames[i] == name) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    // Returns the first word following the given prefix, e.g. the package name in "Setting up foo (1.0) ...".
+    std::string wordAfter(const std::string& line, const std::string& prefix) {
+        std::string rest = line.substr(prefix.length());
+        return rest.substr(0, rest.find(' '));
+    }
+
+    /**
+     * Splits the combined output of a batched 'dpkg -i' back into one segment per archive and works out
+     * which archives failed. Lines that cannot be attributed to a single archive (database reads, shared
+     * trigger processing) are added to every segment.
+     */
+    void splitBatchInstallOutput(
+        const std::vector<std::string>& archivePaths,
+        const std::vector<std::string>& outputLines,
+        bool batchSucceeded,
+        std::vector<std::string>& segments,
+        std::vector<bool>& results) {
+
+        const size_t count = archivePaths.size();
+        std::vector<std::string> packageNames(count);
+        std::vector<bool> failed(count, false);
+        bool failuresAttributed = false;
+        bool inErrorList = false;
+        int current = -1;
+
+        segments.assign(count, std::string {});
+        results.assign(count, batchSucceeded);
+
+        for (const auto& line : outputLines) {
+            int owner = current;
+
+            if (inErrorList && !line.empty() && line[0] == ' ') {
+                // Entries of the trailing error summary are either archive paths or package names.
+                std::string token = line.substr(line.find_first_not_of(' '));
+                owner = findArchiveIndex(archivePaths, token);
+                if (owner < 0) {
+                    owner = findPackageIndex(packageNames, token);
+                }
+                if (owner >= 0) {
+                    failed[owner] = true;
+                    failuresAttributed = true;
+                }
+            } else if (line.rfind(dpkgPreparingToUnpackStr, 0) == 0) {
+                std::string token = line.substr(dpkgPreparingToUnpackStr.length());
+                token = token.substr(0, token.rfind(" ..."));
+                current = owner = findArchiveIndex(archivePaths, token);
+            } else if (line.rfind(dpkgUnpackingStr, 0) == 0) {
+                if (current >= 0) {
+                    std::string name = wordAfter(line, dpkgUnpackingStr);
+                    packageNames[current] = name.substr(0, name.find(':'));
+                }
+            } else if (line.rfind(dpkgSettingUpStr, 0) == 0) {
+                current = owner = findPackageIndex(packageNames, wordAfter(line, dpkgSettingUpStr));
+            } else if (line.rfind(dpkgErrorArchiveStr, 0) == 0) {
+                std::string token = line.substr(dpkgErrorArchiveStr.length());
+                token = token.substr(0, token.rfind(" ("));
+                current = owner = findArchiveIndex(archivePaths, token);
+                if (owner >= 0) {
+                    failed[owner] = true;
+                    failuresAttributed = true;
+                }
+            } else if (line.rfind(dpkgErrorPackageStr, 0) == 0) {
+                current = owner = findPackageIndex(packageNames, wordAfter(line, dpkgErrorPackageStr));
+                if (owner >= 0) {
+                    failed[owner] = true;
+                    failuresAttributed = true;
+                }
+            } else if (line == dpkgErrorsEncounteredStr) {
+                inErrorList = true;
+                current = owner = -1;
+            }
+
+            if (owner >= 0) {
+                segments[owner] += line + "\n";
+            } else {
+                for (auto& segment : segments) {
+                    segment += line + "\n";
+                }
+            }
+        }
+
+        if (!batchSucceeded && failuresAttributed) {
+            // dpkg carries on past a failing archive, so only the archives it reported are failures.
+            for (size_t i = 0; i < count; ++i) {
+                results[i] = !failed[i];
+            }
+        }
+    }
+
     void retrieveFingerprint(const std::string& outputLine, std::string& fingerprint) {
         std::istringstream stream(outputLine);
         std::string word;
@@ -105,6 +277,15 @@ PackageInfo PackageUtilDEB::getPackageInfo(const PKG_ID_TYPE& identifierType, co
         return {};
     }
 
+    const uint64_t generation = changeTracker_.refresh();
+    {
+        std::lock_guard<std::mutex> lock(packageInfoCacheMutex_);
+        const auto cached = packageInfoCache_.find(packageIdentifier);
+        if (cached != packageInfoCache_.end() && changeTracker_.isUnchangedSince(packageIdentifier, cached->second.generation)) {
+            return cached->second.packageInfo;
+        }
+    }
+
     PackageInfo packageInfo;
     std::string packageName {};
     std::string packageVersion {};
@@ -136,11 +317,66 @@ PackageInfo PackageUtilDEB::getPackageInfo(const PKG_ID_TYPE& identifierType, co
         packageInfo.packageIdentifier = packageName + "-" + packageVersion + "." + packageArchitecture;
         packageInfo.packageName = packageName;
         packageInfo.version = packageVersion;
+        packageInfo.architecture = packageArchitecture;
+    }
+
+    if (ret == 0) {
+        // A package that is not installed is cached as well, most catalog rules do not match on a given host.
+        std::lock_guard<std::mutex> lock(packageInfoCacheMutex_);
+        packageInfoCache_[packageIdentifier] = {packageInfo, generation};
     }
 
     return packageInfo;
 }
 
+bool PackageUtilDEB::listInstalledPackages(std::vector<PackageInfo>& packages) const {
+    const uint64_t generation = changeTracker_.refresh();
+    std::vector<std::string> queryArgv = {dpkgQueryBinStr, dpkgQueryShowOption, dpkgQueryShowFormatOption};
+    int exitCode = 0;
+    std::string outputBuffer;
+
+    int ret = commandExecutor_.ExecuteCommandCaptureOutput(dpkgQueryBinStr, queryArgv, exitCode, outputBuffer);
+    if(ret != 0){
+        PM_LOG_ERROR("Failed to execute list installed packages command.");
+        return false;
+    } else if(exitCode != 0) {
+        PM_LOG_ERROR("Failed to list installed packages. Exit code: %d", exitCode);
+        return false;
+    }
+
+    std::vector<std::string> outputLines;
+    commandExecutor_.ParseOutput(outputBuffer, outputLines);
+
+    std::set<std::string> listedNames;
+    std::lock_guard<std::mutex> lock(packageInfoCacheMutex_);
+    for (const auto& line : outputLines) {
+        const size_t versionStart = line.find('\t');
+        const size_t architectureStart = line.find('\t', versionStart + 1);
+        if (versionStart == std::string::npos || architectureStart == std::string::npos) {
+            continue;
+        }
+
+        PackageInfo packageInfo;
+        packageInfo.packageName = line.substr(0, versionStart);
+        packageInfo.version = line.substr(versionStart + 1, architectureStart - versionStart - 1);
+        packageInfo.architecture = line.substr(architectureStart + 1);
+        if (packageInfo.version.empty()) {
+            // Known to dpkg but neither installed nor leaving configuration files behind.
+            continue;
+        }
+
+        // Same identifier as getPackageInfo(). Of a package installed for several architectures the first is kept.
+        if (listedNames.insert(packageInfo.packageName).second) {
+            PackageInfo cachedInfo = packageInfo;
+            cachedInfo.packageIdentifier = packageInfo.packageName + "-" + packageInfo.version + "." + packageInfo.architecture;
+            packageInfoCache_[packageInfo.packageName] = {cachedInfo, generation};
+        }
+        packages.push_back(std::move(packageInfo));
+    }
+
+    return true;
+}
+
 std::vector<std::string> PackageUtilDEB::listPackageFiles(const PKG_ID_TYPE& identifierType, const std::string& packageIdentifier) const {
     (void) identifierType; // Currently this is of no use as dpkg -L command works with both name and NVRA format similarly.
     std::vector<std::string>result;
@@ -164,43 +400,298 @@ bool PackageUtilDEB::installPackageWithContext(
     const std::string& packagePath, 
     const std::string& catalogProductAndVersion,
     const std::map<std::string, int>& installOptions) const {
-    
-    (void) installOptions; // Currently unused
-    
-    // Extract package info from catalog context
-    std::string logFileName = extractPackageInfoFromCatalog(catalogProductAndVersion);
-    std::string logFilePath = static_cast<const PmPlatformConfiguration&>(platformConfig_).GetLogDirectory() + logFileName + ".log";
-    
-    PM_LOG_INFO("Installing package %s (catalog: %s), logs will be saved to %s", 
-                packagePath.c_str(), catalogProductAndVersion.c_str(), logFilePath.c_str());
 
-    // Execute installation command (using shell to capture stderr)
-    std::string installCmd = std::string(dpkgBinStr) + " " + dpkgInstallPkgOption + " --force-depends --force-confold '" + packagePath + "' 2>&1";
-    std::vector<std::string> installArgv = {"/bin/sh", "-c", installCmd};
+    return installPackagesWithContext({{packagePath, catalogProductAndVersion}}, installOptions).front();
+}
+
+std::vector<bool> PackageUtilDEB::installPackagesWithContext(
+    const std::vector<PackageInstallRequest>& packages,
+    const std::map<std::string, int>& installOptions) const {
+
+    std::vector<bool> results(packages.size(), false);
+    std::vector<std::string> packageOutputs(packages.size());
+    if (packages.empty()) {
+        return results;
+    }
+
+    const auto deferOption = installOptions.find(kInstallOptionDeferTriggers);
+    const bool deferTriggers = deferOption != installOptions.end() && deferOption->second != 0;
+    const auto skipOption = installOptions.find(kInstallOptionSkipInstalledVersion);
+    const bool skipInstalledVersion = skipOption != installOptions.end() && skipOption->second != 0;
+
+    // Inspect each archive's control file in-process so that foreign-architecture archives are rejected and
+    // (optionally) already installed versions are skipped without spawning dpkg for them.
+    std::vector<size_t> pendingIndexes;
+    uint32_t skippedCount = 0;
+    uint32_t rejectedCount = 0;
+    for (size_t i = 0; i < packages.size(); ++i) {
+        PackageInfo archiveInfo;
+        if (controlReader_.readPackageInfo(packages[i].packagePath, archiveInfo)) {
+            if (!isSupportedArchitecture(archiveInfo.architecture)) {
+                PM_LOG_ERROR("Package %s has architecture %s which is not supported by dpkg on this system",
+                    packages[i].packagePath.c_str(), archiveInfo.architecture.c_str());
+                packageOutputs[i] = "Rejected " + archiveInfo.packageIdentifier + ": unsupported architecture " + archiveInfo.architecture;
+                ++rejectedCount;
+                continue;
+            }
+            if (skipInstalledVersion && getInstalledVersion(archiveInfo.packageName) == archiveInfo.version) {
+                PM_LOG_INFO("Package %s is already installed, skipping %s", archiveInfo.packageIdentifier.c_str(), packages[i].packagePath.c_str());
+                packageOutputs[i] = "Skipped " + archiveInfo.packageIdentifier + ": version already installed";
+                results[i] = true;
+                ++skippedCount;
+                continue;
+            }
+        }
+        pendingIndexes.push_back(i);
+    }
+
+    if (!pendingIndexes.empty()) {
+        // A single 'dpkg -i' for the whole batch: the dpkg lock, database load and trigger processing are paid once.
+        std::vector<std::string> installArgv = {dpkgBinStr, dpkgInstallPkgOption, dpkgForceDependsOption, dpkgForceConfoldOption};
+        if (deferTriggers) {
+            installArgv.push_back(dpkgNoTriggersOption);
+        }
+        std::vector<std::string> archivePaths;
+        for (size_t index : pendingIndexes) {
+            const auto& package = packages[index];
+            PM_LOG_INFO("Installing package %s (catalog: %s)", package.packagePath.c_str(), package.catalogProductAndVersion.c_str());
+            installArgv.push_back(package.packagePath);
+            archivePaths.push_back(package.packagePath);
+        }
+
+        int exitCode = 0;
+        std::string dpkgOutput;
+
+        int ret = executeDpkgWhenUnlocked(installArgv, lockWaitTimeoutFromOptions(installOptions), exitCode, dpkgOutput);
+
+        PM_LOG_DEBUG("dpkg installation result: ret=%d, exitCode=%d, packages=%zu, output length=%zu", ret, exitCode, archivePaths.size(), dpkgOutput.length());
+        PM_LOG_DEBUG("dpkg installation output: %s", dpkgOutput.c_str());
+
+        if (ret != 0) {
+            PM_LOG_ERROR("Failed to execute install package command. Return code: %d", ret);
+        } else if (exitCode != 0) {
+            PM_LOG_ERROR("Failed to install package(s). Exit code: %d", exitCode);
+        }
+
+        std::vector<std::string> outputLines;
+        commandExecutor_.ParseOutput(dpkgOutput, outputLines);
+
+        std::vector<std::string> batchOutputs;
+        std::vector<bool> batchResults;
+        splitBatchInstallOutput(archivePaths, outputLines, ret == 0 && exitCode == 0, batchOutputs, batchResults);
+        for (size_t i = 0; i < pendingIndexes.size(); ++i) {
+            results[pendingIndexes[i]] = batchResults[i];
+            packageOutputs[pendingIndexes[i]] = batchOutputs[i];
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(metricsMutex_);
+        metrics_.packagesInstalled += static_cast<uint32_t>(std::count(results.begin(), results.end(), true)) - skippedCount;
+        metrics_.packagesSkippedAlreadyInstalled += skippedCount;
+        metrics_.packagesRejectedArchitecture += rejectedCount;
+        if (deferTriggers) {
+            // Even failed archives may have been unpacked and activated triggers, so count every package dpkg saw.
+            metrics_.packagesWithDeferredTriggers += static_cast<uint32_t>(pendingIndexes.size());
+            packagesPendingTriggers_ += static_cast<uint32_t>(pendingIndexes.size());
+        }
+    }
+
+    for (size_t i = 0; i < packages.size(); ++i) {
+        // Save each package's share of the installation output to its own log file (matching RPM format)
+        std::string logFileName = extractPackageInfoFromCatalog(packages[i].catalogProductAndVersion);
+        std::string logFilePath = static_cast<const PmPlatformConfiguration&>(platformConfig_).GetLogDirectory() + logFileName + ".log";
+        saveInstallerLog(logFilePath, packageOutputs[i]);
+
+        if (results[i]) {
+            PM_LOG_INFO("Package installed successfully: %s, logs saved to %s", logFileName.c_str(), logFilePath.c_str());
+        } else {
+            PM_LOG_ERROR("Failed to install package: %s, logs saved to %s", logFileName.c_str(), logFilePath.c_str());
+        }
+    }
+
+    return results;
+}
+
+bool PackageUtilDEB::isSupportedArchitecture(const std::string& architecture) const {
+    if (architecture.empty() || architecture == dpkgArchitectureAll) {
+        return true;
+    }
+
+    std::call_once(dpkgArchitecturesOnce_, [this]() {
+        for (const auto& option : {dpkgPrintArchitectureOption, dpkgPrintForeignArchitecturesOption}) {
+            std::vector<std::string> archArgv = {dpkgBinStr, option};
+            int exitCode = 0;
+            std::string outputBuffer;
+            if (commandExecutor_.ExecuteCommandCaptureOutput(dpkgBinStr, archArgv, exitCode, outputBuffer) != 0 || exitCode != 0) {
+                PM_LOG_ERROR("Failed to query dpkg architectures (%s). Exit code: %d", option.c_str(), exitCode);
+                continue;
+            }
+            std::vector<std::string> outputLines;
+            commandExecutor_.ParseOutput(outputBuffer, outputLines);
+            for (const auto& line : outputLines) {
+                if (!line.empty()) {
+                    dpkgArchitectures_.push_back(line);
+                }
+            }
+        }
+    });
+
+    // Without the list of architectures leave the decision to dpkg.
+    return dpkgArchitectures_.empty() ||
+        std::find(dpkgArchitectures_.begin(), dpkgArchitectures_.end(), architecture) != dpkgArchitectures_.end();
+}
+
+std::string PackageUtilDEB::getInstalledVersion(const std::string& packageName) const {
+    std::vector<std::string> infoArgv = {dpkgBinStr, dpkgGetPkgInfoOption, packageName};
+    int exitCode = 0;
+    std::string outputBuffer;
+
+    if (commandExecutor_.ExecuteCommandCaptureOutput(dpkgBinStr, infoArgv, exitCode, outputBuffer) != 0 || exitCode != 0) {
+        return {};
+    }
+
+    std::vector<std::string> outputLines;
+    commandExecutor_.ParseOutput(outputBuffer, outputLines);
+
+    bool installed = false;
+    std::string version;
+    for (const auto& line : outputLines) {
+        if (line.find("Status:") == 0) {
+            // Removed packages keep their status entry, e.g. "Status: deinstall ok config-files".
+            installed = line.size() >= dpkgInstalledStatusStr.size() &&
+                line.compare(line.size() - dpkgInstalledStatusStr.size(), dpkgInstalledStatusStr.size(), dpkgInstalledStatusStr) == 0;
+        } else if (line.find("Version:") == 0) {
+            version = line.substr(strlen("Version: "));
+        }
+    }
+
+    return installed ? version : std::string {};
+}
+
+int PackageUtilDEB::executeDpkgWhenUnlocked(
+    const std::vector<std::string>& argv,
+    std::chrono::seconds lockWaitTimeout,
+    int& exitCode,
+    std::string& output) const {
+
+    const auto deadline = std::chrono::steady_clock::now() + lockWaitTimeout;
+    auto backoff = initialLockBackoff;
+    std::chrono::steady_clock::duration waited {0};
+    bool timedOut = false;
+    int ret = -1;
+
+    // Sleeps for the current backoff, bounded by the deadline. Returns false once the deadline has passed.
+    auto backOff = [&]() {
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(backoff, deadline - now));
+        waited += std::chrono::steady_clock::now() - now;
+        backoff = std::min(backoff * 2, maxLockBackoff);
+        return true;
+    };
+
+    while (true) {
+        pid_t holderPid = 0;
+        std::string lockFile;
+        if (findDpkgLockHolder(holderPid, lockFile)) {
+            PM_LOG_INFO("dpkg lock %s is held by pid %d, waiting %lld ms before retrying",
+                        lockFile.c_str(), holderPid, static_cast<long long>(backoff.count()));
+            if (backOff()) {
+                continue;
+            }
+            timedOut = true;
+            PM_LOG_ERROR("Timed out after %lld s waiting for dpkg lock %s held by pid %d",
+                         static_cast<long long>(lockWaitTimeout.count()), lockFile.c_str(), holderPid);
+        }
+
+        ret = commandExecutor_.ExecuteCommandCaptureCombinedOutput(dpkgBinStr, argv, exitCode, output);
+
+        // Another frontend may have taken the lock between the probe and dpkg starting.
+        if (!timedOut && ret == 0 && exitCode != 0 && output.find(dpkgLockedStr) != std::string::npos) {
+            PM_LOG_INFO("dpkg lost the lock to another process, waiting %lld ms before retrying", static_cast<long long>(backoff.count()));
+            if (backOff()) {
+                continue;
+            }
+            timedOut = true;
+        }
+        break;
+    }
+
+    const auto waitedMs = std::chrono::duration_cast<std::chrono::milliseconds>(waited);
+    if (waitedMs.count() > 0) {
+        PM_LOG_INFO("Waited %lld ms for the dpkg lock", static_cast<long long>(waitedMs.count()));
+    }
+
+    std::lock_guard<std::mutex> lock(metricsMutex_);
+    metrics_.lockWaitTime += waitedMs;
+    if (timedOut) {
+        metrics_.lockWaitTimeouts++;
+    }
+    return ret;
+}
+
+bool PackageUtilDEB::processPendingTriggers() const {
+    uint32_t deferredPackages = 0;
+    std::chrono::milliseconds lockWaitBefore {0};
+    {
+        std::lock_guard<std::mutex> lock(metricsMutex_);
+        deferredPackages = packagesPendingTriggers_;
+        packagesPendingTriggers_ = 0;
+        lockWaitBefore = metrics_.lockWaitTime;
+    }
+
+    if (deferredPackages == 0) {
+        return true;
+    }
+
+    std::vector<std::string> triggersArgv = {dpkgBinStr, dpkgTriggersOnlyOption, dpkgPendingOption};
     int exitCode = 0;
     std::string dpkgOutput;
 
-    PM_LOG_DEBUG("Executing dpkg command with shell: %s", installCmd.c_str());
-    int ret = commandExecutor_.ExecuteCommandCaptureOutput("/bin/sh", installArgv, exitCode, dpkgOutput);
-    
-    PM_LOG_DEBUG("dpkg installation result: ret=%d, exitCode=%d, output length=%zu", ret, exitCode, dpkgOutput.length());
-    PM_LOG_DEBUG("dpkg installation output: %s", dpkgOutput.c_str());
-    
-    // Save the installation output to log file (matching RPM format)
-    saveInstallerLog(logFilePath, dpkgOutput);
-    
-    if(ret != 0){
-        PM_LOG_ERROR("Failed to execute install package command. Return code: %d", ret);
-        return false;
-    } else if(exitCode != 0) {
-        PM_LOG_ERROR("Failed to install package. Exit code: %d", exitCode);
+    const auto start = std::chrono::steady_clock::now();
+    int ret = executeDpkgWhenUnlocked(triggersArgv, defaultLockWaitTimeout, exitCode, dpkgOutput);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    PM_LOG_DEBUG("dpkg trigger processing output: %s", dpkgOutput.c_str());
+
+    std::lock_guard<std::mutex> lock(metricsMutex_);
+    // Time spent waiting for the dpkg lock is not trigger processing time.
+    elapsed -= std::min(elapsed, metrics_.lockWaitTime - lockWaitBefore);
+    if (ret != 0 || exitCode != 0) {
+        PM_LOG_ERROR("Failed to process pending triggers. Return code: %d, exit code: %d", ret, exitCode);
+        // The triggers are still pending in dpkg, keep them accounted for the next attempt.
+        packagesPendingTriggers_ += deferredPackages;
         return false;
     }
-    
-    PM_LOG_INFO("Package installed successfully: %s", logFileName.c_str());
+
+    // Without deferral each package would have paid for a trigger run of its own. How long those would have
+    // taken is not measured, so the saving is only a rough estimate.
+    metrics_.deferredTriggerRuns++;
+    metrics_.triggerProcessingTime += elapsed;
+    metrics_.roughTriggerTimeSavedEstimate += elapsed * (deferredPackages - 1);
+
+    PM_LOG_INFO("Processed deferred triggers for %u package(s) in %lld ms, roughly %lld ms saved by deferring",
+                deferredPackages, static_cast<long long>(elapsed.count()),
+                static_cast<long long>((elapsed * (deferredPackages - 1)).count()));
     return true;
 }
 
+PackageInstallMetrics PackageUtilDEB::getInstallMetrics() const {
+    std::lock_guard<std::mutex> lock(metricsMutex_);
+    return metrics_;
+}
+
+uint64_t PackageUtilDEB::getPackageDbGeneration() const {
+    return changeTracker_.isWatching() ? changeTracker_.refresh() : 0;
+}
+
+bool PackageUtilDEB::getChangedPackagesSince(uint64_t generation, std::set<std::string>& packageNames) const {
+    return changeTracker_.getChangedPackagesSince(generation, packageNames);
+}
+
 std::string PackageUtilDEB::extractPackageInfoFromCatalog(const std::string& catalogProductAndVersion) const {
     if (catalogProductAndVersion.empty()) {
         PM_LOG_ERROR("Empty catalog product and version information");
@@ -241,6 +732,28 @@ bool PackageUtilDEB::uninstallPackage(const std::string& packageIdentifier) cons
     return true;
 }
 
+bool PackageUtilDEB::uninstallPackages(const std::vector<std::string>& packageIdentifiers) const {
+    if (packageIdentifiers.empty()) {
+        return true;
+    }
+
+    std::vector<std::string> uninstallArgv = {dpkgBinStr, dpkgUninstallPkgOption};
+    uninstallArgv.insert(uninstallArgv.end(), packageIdentifiers.begin(), packageIdentifiers.end());
+    int exitCode = 0;
+
+    int ret = commandExecutor_.ExecuteCommand(dpkgBinStr, uninstallArgv, exitCode);
+    if(ret != 0){
+        PM_LOG_ERROR("Failed to execute uninstall packages command.");
+        return false;
+    } else if(exitCode != 0) {
+        PM_LOG_ERROR("Failed to uninstall %zu packages. Exit code: %d", packageIdentifiers.size(), exitCode);
+        return false;
+    }
+
+    PM_LOG_INFO("%zu packages uninstalled successfully.", packageIdentifiers.size());
+    return true;
+}
+
 // NOTE: packagePath is expected to be the complete path to the debian package (e.g., "/home/Downloads/package-1.0.0-1.x86_64.deb")
 bool PackageUtilDEB::verifyPackage(const std::string& packagePath, const std::string& signerKeyID) const {
     if (signerKeyID.empty()) {
@@ -1,8 +1,12 @@
 #pragma once
 
 #include "IPackageUtil.hpp"
+#include "DebControlReader.hpp"
+#include "DpkgChangeTracker.hpp"
 #include "OSPackageManager/common/ICommandExec.hpp"
 #include "PackageManager/IPmPlatformConfiguration.h"
+#include <mutex>
+#include <unordered_map>
 
 /**
  * @brief A class that implements the 'PackageUtil' utility to perform package-related operations for DEB.
@@ -20,7 +24,19 @@ public:
 
     bool isValidInstallerType(const std::string &installerType) const override;
     std::vector<std::string> listPackages() const override;
+
+    /**
+     * @brief Returns the info of an installed package by name.
+     * @note Results (including "not installed") are cached and only queried from dpkg again once the
+     *       DpkgChangeTracker reports the package as changed.
+     */
     PackageInfo getPackageInfo(const PKG_ID_TYPE& identifierType, const std::string& packageIdentifier) const override;
+
+    /**
+     * @brief Lists every package dpkg has a version for with a single dpkg-query, and caches them for getPackageInfo().
+     * @note dpkg does not support NVRA lookups, the returned packageIdentifiers are empty.
+     */
+    bool listInstalledPackages(std::vector<PackageInfo>& packages) const override;
     std::vector<std::string> listPackageFiles(const PKG_ID_TYPE& identifierType, const std::string& packageIdentifier) const override;
     
     /**
@@ -34,14 +50,103 @@ public:
         const std::string& packagePath, 
         const std::string& catalogProductAndVersion,
         const std::map<std::string, int>& installOptions = {}) const override;
+
+    /**
+     * @brief Installs several packages in a single 'dpkg -i' invocation.
+     * @param packages The packages to install, each with its catalog context.
+     * @param installOptions Options for installation (optional).
+     * @return One result per package, in request order. The combined dpkg output is split back
+     *         into one installer log per package.
+     * @note If apt, unattended-upgrades or another dpkg frontend holds the dpkg lock, the install waits for
+     *       it with bounded exponential backoff for up to kInstallOptionLockWaitTimeoutSec seconds.
+     * @note Each archive's control file is read in-process first: archives built for an architecture dpkg does
+     *       not support fail without running dpkg, and with kInstallOptionSkipInstalledVersion set, archives
+     *       whose exact version is already installed are reported as successful without being reinstalled.
+     * @note With kInstallOptionDeferTriggers set, dpkg runs with '--no-triggers' and the triggers
+     *       (ldconfig, systemd reload, man-db, ...) stay pending until processPendingTriggers().
+     */
+    std::vector<bool> installPackagesWithContext(
+        const std::vector<PackageInstallRequest>& packages,
+        const std::map<std::string, int>& installOptions = {}) const override;
     
+    /**
+     * @brief Runs a single 'dpkg --triggers-only --pending' for all installs made with deferred triggers.
+     * @return True if there was nothing pending or the triggers were processed successfully.
+     */
+    bool processPendingTriggers() const override;
+
+    /**
+     * @brief Returns the install counters, including the measured trigger processing time and a rough estimate
+     *        of the time deferring saved.
+     */
+    PackageInstallMetrics getInstallMetrics() const override;
+
+    /**
+     * @brief Returns the dpkg database generation, or 0 if the database cannot be watched.
+     */
+    uint64_t getPackageDbGeneration() const override;
+
+    /**
+     * @brief Returns the packages that changed after the given generation, as seen in dpkg.log.
+     */
+    bool getChangedPackagesSince(uint64_t generation, std::set<std::string>& packageNames) const override;
+
     bool uninstallPackage(const std::string& packageIdentifier) const override;
+
+    /**
+     * @brief Purges several packages with one dpkg run. dpkg goes on past a package it cannot remove, so the
+     *        others may be gone when this fails.
+     */
+    bool uninstallPackages(const std::vector<std::string>& packageIdentifiers) const override;
     bool verifyPackage(const std::string& packagePath, const std::string& signerKeyID) const override;
 
 private:
     ICommandExec &commandExecutor_;
     IPmPlatformConfiguration &platformConfig_;
+    DebControlReader controlReader_;
+    mutable DpkgChangeTracker changeTracker_;
+
+    struct CachedPackageInfo {
+        PackageInfo packageInfo;
+        uint64_t generation;
+    };
+    mutable std::mutex packageInfoCacheMutex_;
+    mutable std::unordered_map<std::string, CachedPackageInfo> packageInfoCache_;
+
+    mutable std::once_flag dpkgArchitecturesOnce_;
+    mutable std::vector<std::string> dpkgArchitectures_; /**< Native and foreign architectures configured in dpkg. */
+
+    mutable std::mutex metricsMutex_;
+    mutable PackageInstallMetrics metrics_ {};
+    mutable uint32_t packagesPendingTriggers_ = 0; /**< Packages installed with '--no-triggers' since the last trigger run. */
     
+    /**
+     * @brief Runs a dpkg command once no other process holds the dpkg locks, retrying if the lock is lost to
+     *        another frontend between the probe and dpkg starting.
+     * @param argv The dpkg arguments.
+     * @param lockWaitTimeout The longest time to wait for the locks before running dpkg regardless.
+     * @param exitCode The exit code of dpkg.
+     * @param output The combined output of dpkg.
+     * @return 0 if dpkg was executed.
+     */
+    int executeDpkgWhenUnlocked(
+        const std::vector<std::string>& argv,
+        std::chrono::seconds lockWaitTimeout,
+        int& exitCode,
+        std::string& output) const;
+
+    /**
+     * @brief Checks an archive's architecture against the native and foreign architectures of dpkg.
+     * @param architecture The Architecture field of the archive.
+     * @return True for "all", for any architecture dpkg accepts, and when the dpkg architectures are unknown.
+     */
+    bool isSupportedArchitecture(const std::string& architecture) const;
+
+    /**
+     * @brief Returns the installed version of a package, or an empty string if the package is not installed.
+     */
+    std::string getInstalledVersion(const std::string& packageName) const;
+
     /**
      * @brief Extracts package info from catalog context (e.g. "uc/1.0.0.150" -> "uc_1.0.0.150").
      * @param catalogProductAndVersion The catalog product and version string from manifest.
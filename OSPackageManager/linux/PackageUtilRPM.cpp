@@ -142,6 +142,9 @@ PackageInfo PackageUtilRPM::getPackageInfo(const PKG_ID_TYPE& identifierType, co
     (void) identifierType;
     (void) packageIdentifier;
 
+    // librpm is not thread-safe, discovery may query packages from several threads.
+    std::lock_guard<std::mutex> lock(rpmDbMutex_);
+
     rpmts ts = fpRpmTsCreate_();
     if(NULL == ts) {
         PM_LOG_ERROR("Failed to create rpm transaction set.");
@@ -173,6 +176,7 @@ PackageInfo PackageUtilRPM::getPackageInfo(const PKG_ID_TYPE& identifierType, co
             result.packageIdentifier = packageNVRAFormat;
             result.packageName = packageName;
             result.version = packageVersion;
+            result.architecture = packageArch;
             break;
         }
     }
@@ -183,6 +187,45 @@ PackageInfo PackageUtilRPM::getPackageInfo(const PKG_ID_TYPE& identifierType, co
     return result;
 }
 
+bool PackageUtilRPM::listInstalledPackages(std::vector<PackageInfo>& packages) const {
+    std::lock_guard<std::mutex> lock(rpmDbMutex_);
+
+    rpmts ts = fpRpmTsCreate_();
+    if(NULL == ts) {
+        PM_LOG_ERROR("Failed to create rpm transaction set.");
+        return false;
+    }
+
+    rpmdbMatchIterator mi = fpRpmTsInitIterator_(ts, RPMDBI_PACKAGES, NULL, 0);
+    if(NULL == mi) {
+        PM_LOG_ERROR("Failed to iterate the rpm database.");
+        fpRpmTsFree_(ts);
+        return false;
+    }
+
+    Header packageHeader;
+    while ((packageHeader = fpRpmDbNextIterator_(mi)) != NULL) {
+        const char* packageName = fpHeaderGetString_(packageHeader, RPMTAG_NAME);
+        const char* packageVersion = fpHeaderGetString_(packageHeader, RPMTAG_VERSION);
+        const char* packageRelease = fpHeaderGetString_(packageHeader, RPMTAG_RELEASE);
+        const char* packageArch = fpHeaderGetString_(packageHeader, RPMTAG_ARCH);
+        if(NULL == packageName || NULL == packageVersion || NULL == packageRelease || NULL == packageArch) {
+            continue;
+        }
+
+        PackageInfo packageInfo;
+        packageInfo.packageIdentifier = std::string(packageName) + "-" + packageVersion + "-" + packageRelease + "." + packageArch;
+        packageInfo.packageName = packageName;
+        packageInfo.version = packageVersion;
+        packageInfo.architecture = packageArch;
+        packages.push_back(std::move(packageInfo));
+    }
+
+    fpRpmDbFreeIterator_(mi);
+    fpRpmTsFree_(ts);
+    return true;
+}
+
 std::vector<std::string> PackageUtilRPM::listPackageFiles(const PKG_ID_TYPE& identifierType, const std::string& packageIdentifier) const {
     (void) identifierType; // Currently this is of no use as rpm -ql command works with both name and NVRA format similarly.
     std::vector<std::string>result;
@@ -232,10 +275,48 @@ bool PackageUtilRPM::installPackageWithContext(
         PM_LOG_ERROR("Failed to install package. Exit code: %d", exitCode);
         return false;
     }
+
+    {
+        std::lock_guard<std::mutex> lock(metricsMutex_);
+        metrics_.packagesInstalled++;
+    }
+
     PM_LOG_INFO("Package installed successfully: %s", logFileName.c_str());
     return true;
 }
 
+std::vector<bool> PackageUtilRPM::installPackagesWithContext(
+    const std::vector<PackageInstallRequest>& packages,
+    const std::map<std::string, int>& installOptions) const {
+
+    std::vector<bool> results;
+    results.reserve(packages.size());
+    for (const auto& package : packages) {
+        results.push_back(installPackageWithContext(package.packagePath, package.catalogProductAndVersion, installOptions));
+    }
+
+    return results;
+}
+
+bool PackageUtilRPM::processPendingTriggers() const {
+    return true;
+}
+
+PackageInstallMetrics PackageUtilRPM::getInstallMetrics() const {
+    std::lock_guard<std::mutex> lock(metricsMutex_);
+    return metrics_;
+}
+
+uint64_t PackageUtilRPM::getPackageDbGeneration() const {
+    return 0;
+}
+
+bool PackageUtilRPM::getChangedPackagesSince(uint64_t generation, std::set<std::string>& packageNames) const {
+    (void) generation;
+    (void) packageNames;
+    return false;
+}
+
 std::string PackageUtilRPM::extractPackageInfoFromCatalog(const std::string& catalogProductAndVersion) const {
     if (catalogProductAndVersion.empty()) {
         PM_LOG_ERROR("Empty catalog product and version information");
@@ -276,6 +357,28 @@ bool PackageUtilRPM::uninstallPackage(const std::string& packageIdentifier) cons
     return true;
 }
 
+bool PackageUtilRPM::uninstallPackages(const std::vector<std::string>& packageIdentifiers) const {
+    if (packageIdentifiers.empty()) {
+        return true;
+    }
+
+    std::vector<std::string> uninstallArgv = {rpmBinStr, rpmUninstallPkgOption};
+    uninstallArgv.insert(uninstallArgv.end(), packageIdentifiers.begin(), packageIdentifiers.end());
+    int exitCode = 0;
+
+    int ret = commandExecutor_.ExecuteCommand(rpmBinStr, uninstallArgv, exitCode);
+    if(ret != 0){
+        PM_LOG_ERROR("Failed to execute uninstall packages command.");
+        return false;
+    } else if(exitCode != 0) {
+        PM_LOG_ERROR("Failed to uninstall %zu packages. Exit code: %d", packageIdentifiers.size(), exitCode);
+        return false;
+    }
+
+    PM_LOG_INFO("%zu packages uninstalled successfully.", packageIdentifiers.size());
+    return true;
+}
+
 bool PackageUtilRPM::is_trusted_by_system(std::string keyId) const {
     std::vector<std::string> imported_rpm_pubkeys_argv = { rpmBinStr, "-q", rpmPubKeySearchStr };
     std::vector<std::string> pubkey_block_argv = { rpmBinStr, "-q", "--queryformat", rpmPubkeyFormatStr, "" };
@@ -5,6 +5,7 @@
 #include "OSPackageManager/common/ICommandExec.hpp"
 #include "PackageManager/IPmPlatformConfiguration.h"
 #include <dlfcn.h>
+#include <mutex>
 #include <rpm/rpmlib.h>
 #include <rpm/rpmts.h>
 #include <rpm/rpmdb.h>
@@ -58,6 +59,13 @@ public:
      *         If the package does not exist, the API will return an empty PackageInfo object.
      */
     PackageInfo getPackageInfo(const PKG_ID_TYPE& identifierType, const std::string& packageIdentifier) const override;
+
+    /**
+     * @brief Lists every installed package with a single iteration over the rpm database.
+     * @param packages Receives the packages, identified by NVRA, in database order.
+     * @return False if the rpm database could not be opened.
+     */
+    bool listInstalledPackages(std::vector<PackageInfo>& packages) const override;
     
     /**
      * @brief Lists the files contained within a specific package.
@@ -78,7 +86,42 @@ public:
         const std::string& packagePath, 
         const std::string& catalogProductAndVersion,
         const std::map<std::string, int>& installOptions = {}) const override;
+
+    /**
+     * @brief Installs several packages with catalog context information.
+     * @param packages The packages to install, each with its catalog context.
+     * @param installOptions Options for installation (optional).
+     * @return One result per package, in request order.
+     * @note Packages are installed one 'rpm -U' at a time so that a failing package does not
+     *       roll back the others, which is what a single rpm transaction would do.
+     */
+    std::vector<bool> installPackagesWithContext(
+        const std::vector<PackageInstallRequest>& packages,
+        const std::map<std::string, int>& installOptions = {}) const override;
     
+    /**
+     * @brief rpm has no deferred trigger mode, so there is never anything pending.
+     * @return Always true.
+     */
+    bool processPendingTriggers() const override;
+
+    /**
+     * @brief Returns the install counters.
+     */
+    PackageInstallMetrics getInstallMetrics() const override;
+
+    /**
+     * @brief rpm database changes are not tracked.
+     * @return Always 0.
+     */
+    uint64_t getPackageDbGeneration() const override;
+
+    /**
+     * @brief rpm database changes are not tracked.
+     * @return Always false, every package has to be treated as changed.
+     */
+    bool getChangedPackagesSince(uint64_t generation, std::set<std::string>& packageNames) const override;
+
     /**
      * @brief Uninstalls a package with the specified identifier.
      * @param packageIdentifier The identifier of the package.
@@ -86,6 +129,12 @@ public:
      */
     bool uninstallPackage(const std::string& packageIdentifier) const override;
 
+    /**
+     * @brief Uninstalls several packages in one rpm transaction; none is removed if any cannot be.
+     * @return True if every package was uninstalled, false otherwise.
+     */
+    bool uninstallPackages(const std::vector<std::string>& packageIdentifiers) const override;
+
     bool verifyPackage(const std::string& packagePath, const std::string& signerKeyID) const override;
 
 private:
@@ -95,6 +144,10 @@ private:
     IGpgUtil &gpgUtil_;
     IPmPlatformConfiguration &platformConfig_;
 
+    mutable std::mutex rpmDbMutex_;
+    mutable std::mutex metricsMutex_;
+    mutable PackageInstallMetrics metrics_ {};
+
     // Function pointers for librpm functions
     fpRpmReadConfigFiles_t fpRpmReadConfigFiles_ = nullptr;
     fpRpmTsCreate_t fpRpmTsCreate_ = nullptr;
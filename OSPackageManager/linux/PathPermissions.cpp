@@ -0,0 +1,163 @@
+#include "PathPermissions.hpp"
+#include "PmLogger.hpp"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace { //anonymous namespace
+    // Every level of a recursive walk holds two descriptors open.
+    const size_t kMaxDepth = 256;
+
+    const mode_t adminRemovedBits = S_IWGRP | S_IXGRP | S_IWOTH | S_IXOTH;
+    const mode_t adminRequiredBits = S_IRUSR | S_IWUSR;
+    const mode_t userRequiredBits = S_IROTH;
+    const mode_t executeBits = S_IXUSR | S_IXGRP | S_IXOTH;
+
+    // Group and others may enter a directory of a tree wherever they may read it.
+    mode_t TraversableMode(mode_t mode) {
+        return mode | (mode & S_IRGRP ? S_IXGRP : 0) | (mode & S_IROTH ? S_IXOTH : 0) | S_IXUSR;
+    }
+
+    std::string JoinPath(const std::string& directory, const char* name) {
+        return directory.empty() || directory.back() == '/' ? directory + name : directory + "/" + name;
+    }
+}
+
+namespace PackageManager
+{
+
+bool PathPermissions::Apply(const std::filesystem::path& path, PathRestriction restriction, bool recursive) {
+    if (path.empty()) {
+        return false;
+    }
+
+    const int pathFd = open(path.c_str(), O_PATH | O_NOFOLLOW | O_CLOEXEC);
+    if (pathFd < 0) {
+        if (errno != ENOENT) {
+            PM_LOG_ERROR("Unable to open %s: %d", path.c_str(), errno);
+        }
+        return false;
+    }
+
+    struct stat pathStat {};
+    bool applied = false;
+    if (fstat(pathFd, &pathStat) != 0) {
+        PM_LOG_ERROR("Unable to stat %s: %d", path.c_str(), errno);
+    } else if (S_ISLNK(pathStat.st_mode)) {
+        PM_LOG_ERROR("Refusing to change permissions through symbolic link %s", path.c_str());
+    } else {
+        applied = ApplyAt(pathFd, pathStat, path.string(), restriction, recursive);
+        if (applied && recursive && S_ISDIR(pathStat.st_mode)) {
+            applied = ApplyBelow(pathFd, pathStat.st_dev, path.string(), restriction, 0);
+        }
+    }
+
+    (void)close(pathFd);
+    return applied;
+}
+
+mode_t PathPermissions::RestrictedMode(mode_t mode, PathRestriction restriction) {
+    switch (restriction) {
+    case PathRestriction::Admins:
+        return (mode & ~adminRemovedBits) | adminRequiredBits;
+    case PathRestriction::Users:
+        return mode | userRequiredBits;
+    }
+    return mode;
+}
+
+mode_t PathPermissions::RestrictedTreeMode(mode_t mode, PathRestriction restriction) {
+    const mode_t permissions = mode & 07777;
+    if (S_ISDIR(mode)) {
+        return TraversableMode(RestrictedMode(permissions, restriction));
+    }
+    if (permissions & executeBits) {
+        // Programs keep whatever execute bits they have.
+        return RestrictedMode(permissions, restriction) | (permissions & executeBits);
+    }
+    return RestrictedMode(permissions, restriction);
+}
+
+bool PathPermissions::ApplyAt(int pathFd, const struct stat& pathStat, const std::string& path, PathRestriction restriction, bool inTree) {
+    const mode_t mode = pathStat.st_mode & 07777;
+    const mode_t restrictedMode = inTree ? RestrictedTreeMode(pathStat.st_mode, restriction) : RestrictedMode(mode, restriction);
+    if (restrictedMode == mode) {
+        return true;
+    }
+
+    // An O_PATH descriptor cannot be passed to fchmod(), its /proc link refers to the opened inode itself.
+    char fdPath[32];
+    (void)snprintf(fdPath, sizeof(fdPath), "/proc/self/fd/%d", pathFd);
+    if (fchmodat(AT_FDCWD, fdPath, restrictedMode, 0) != 0) {
+        PM_LOG_ERROR("Unable to change permissions of %s from %o to %o: %d", path.c_str(), mode, restrictedMode, errno);
+        return false;
+    }
+    return true;
+}
+
+bool PathPermissions::ApplyBelow(int dirFd, dev_t device, const std::string& path, PathRestriction restriction, size_t depth) {
+    if (depth == kMaxDepth) {
+        PM_LOG_ERROR("Directory tree below %s is too deep", path.c_str());
+        return false;
+    }
+
+    // Reopening "." relative to the directory's descriptor lists the very directory that was checked.
+    const int listFd = openat(dirFd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR* directory = listFd < 0 ? nullptr : fdopendir(listFd);
+    if (directory == nullptr) {
+        PM_LOG_ERROR("Unable to list %s: %d", path.c_str(), errno);
+        if (listFd >= 0) {
+            (void)close(listFd);
+        }
+        return false;
+    }
+
+    bool applied = true;
+    errno = 0;
+    while (const struct dirent* entry = readdir(directory)) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0 || entry->d_type == DT_LNK) {
+            continue;
+        }
+
+        const std::string entryPath = JoinPath(path, entry->d_name);
+        const int entryFd = openat(listFd, entry->d_name, O_PATH | O_NOFOLLOW | O_CLOEXEC);
+        if (entryFd < 0) {
+            // Entries removed while walking need no permissions.
+            if (errno != ENOENT) {
+                PM_LOG_ERROR("Unable to open %s: %d", entryPath.c_str(), errno);
+                applied = false;
+            }
+            errno = 0;
+            continue;
+        }
+
+        struct stat entryStat {};
+        if (fstat(entryFd, &entryStat) != 0) {
+            PM_LOG_ERROR("Unable to stat %s: %d", entryPath.c_str(), errno);
+            applied = false;
+        } else if (!S_ISLNK(entryStat.st_mode)) {
+            applied = ApplyAt(entryFd, entryStat, entryPath, restriction, true) && applied;
+            if (S_ISDIR(entryStat.st_mode)) {
+                if (entryStat.st_dev == device) {
+                    applied = ApplyBelow(entryFd, device, entryPath, restriction, depth + 1) && applied;
+                } else {
+                    PM_LOG_DEBUG("Not descending into mount point %s", entryPath.c_str());
+                }
+            }
+        }
+        (void)close(entryFd);
+        errno = 0;
+    }
+    if (errno != 0) {
+        PM_LOG_ERROR("Unable to list %s: %d", path.c_str(), errno);
+        applied = false;
+    }
+
+    (void)closedir(directory);
+    return applied;
+}
+
+}
@@ -0,0 +1,60 @@
+/**
+ * @file
+ *
+ * @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+ */
+#pragma once
+
+#include "IFileUtilities.hpp"
+#include <filesystem>
+#include <string>
+#include <sys/stat.h>
+
+namespace PackageManager
+{
+
+/**
+ * @brief Applies path restrictions through file descriptors instead of path names.
+ *
+ * Each path is opened once with O_PATH | O_NOFOLLOW, the decision is taken on a single fstat() of that
+ * descriptor and the mode is changed with fchmodat() on the same descriptor, so the checked file is the changed
+ * one even if its name is replaced meanwhile. Directories are walked with openat() relative to their descriptor.
+ * Symbolic links are never followed or changed. Changing modes goes through /proc/self/fd.
+ */
+class PathPermissions {
+public:
+    /**
+     * @brief Applies a restriction to a path and, if recursive is set and the path is a directory, to every
+     *        entry below it on the same file system.
+     * @return False if the path is missing or a symbolic link, or if an entry could not be changed.
+     */
+    static bool Apply(const std::filesystem::path& path, PathRestriction restriction, bool recursive);
+
+    /**
+     * @brief The mode a file has once the restriction is applied; equal to mode if it is applied already.
+     */
+    static mode_t RestrictedMode(mode_t mode, PathRestriction restriction);
+
+    /**
+     * @brief The mode an entry of a recursively restricted tree has; mode includes the file type.
+     *
+     * Plain files get the mode of RestrictedMode(). Directories stay enterable by whoever may read them, so
+     * admins leave them at most 0755 and users make them readable and enterable by others. Files that are
+     * executable keep their execute bits.
+     */
+    static mode_t RestrictedTreeMode(mode_t mode, PathRestriction restriction);
+
+private:
+    /**
+     * @brief Changes the mode of an opened path if the restriction is not applied yet.
+     * @param inTree Whether the path is part of a recursively restricted tree, see RestrictedTreeMode().
+     */
+    static bool ApplyAt(int pathFd, const struct stat& pathStat, const std::string& path, PathRestriction restriction, bool inTree);
+
+    /**
+     * @brief Applies the restriction to the entries of an opened directory and below.
+     */
+    static bool ApplyBelow(int dirFd, dev_t device, const std::string& path, PathRestriction restriction, size_t depth);
+};
+
+}
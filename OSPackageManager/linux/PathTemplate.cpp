@@ -0,0 +1,66 @@
+#include "PathTemplate.hpp"
+
+namespace { //anonymous namespace
+    const std::string folderIdPrefix {"<FOLDERID_"};
+    const char folderIdSuffix = '>';
+}
+
+namespace PackageManager
+{
+
+PathTemplate::PathTemplate(const std::string& text) {
+    size_t literalStart = 0;
+    size_t position = 0;
+    while ((position = text.find(folderIdPrefix, position)) != std::string::npos) {
+        const size_t idStart = position + folderIdPrefix.size();
+        const size_t idEnd = text.find(folderIdSuffix, idStart);
+        if (idEnd == std::string::npos) {
+            break;
+        }
+        if (idEnd == idStart) {
+            position = idStart;
+            continue;
+        }
+
+        if (position > literalStart) {
+            segments_.push_back({text.substr(literalStart, position - literalStart), false});
+            literalLength_ += position - literalStart;
+        }
+        segments_.push_back({text.substr(idStart, idEnd - idStart), true});
+        folderIds_.push_back(segments_.back().text);
+        position = literalStart = idEnd + 1;
+    }
+
+    if (literalStart < text.size()) {
+        segments_.push_back({text.substr(literalStart), false});
+        literalLength_ += text.size() - literalStart;
+    }
+}
+
+bool PathTemplate::HasFolderIds() const {
+    return !folderIds_.empty();
+}
+
+const std::vector<std::string>& PathTemplate::FolderIds() const {
+    return folderIds_;
+}
+
+bool PathTemplate::Expand(const std::function<std::string(const std::string&)>& resolve, std::string& out_path) const {
+    std::string path;
+    path.reserve(literalLength_);
+    for (const auto& segment : segments_) {
+        if (!segment.isFolderId) {
+            path += segment.text;
+            continue;
+        }
+        const std::string folder = resolve(segment.text);
+        if (folder.empty()) {
+            return false;
+        }
+        path += folder;
+    }
+    out_path = std::move(path);
+    return true;
+}
+
+}
@@ -0,0 +1,54 @@
+/**
+ * @file
+ *
+ * @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+ */
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace PackageManager
+{
+
+/**
+ * @brief A path containing <FOLDERID_xxx> tokens, split into literal text and known folder IDs once so that
+ *        it can be expanded repeatedly without scanning the text again.
+ *
+ * A token is "<FOLDERID_" followed by a non-empty ID and ">". Anything else, including an unterminated
+ * token, is literal text.
+ */
+class PathTemplate {
+public:
+    explicit PathTemplate(const std::string& text);
+
+    /**
+     * @brief Returns true if the path contains at least one token.
+     */
+    bool HasFolderIds() const;
+
+    /**
+     * @brief Returns the IDs of the tokens, in order of appearance.
+     */
+    const std::vector<std::string>& FolderIds() const;
+
+    /**
+     * @brief Replaces every token with the folder resolved for its ID, in one pass.
+     * @param resolve Returns the folder of an ID, empty if it cannot be resolved.
+     * @return False if a token could not be resolved.
+     */
+    bool Expand(const std::function<std::string(const std::string&)>& resolve, std::string& out_path) const;
+
+private:
+    struct Segment {
+        std::string text;       /**< Literal text, or the folder ID of a token. */
+        bool isFolderId = false;
+    };
+
+    std::vector<Segment> segments_;
+    std::vector<std::string> folderIds_;
+    size_t literalLength_ = 0;
+};
+
+}
@@ -7,8 +7,37 @@
 #include "PmPlatformComponentManager.hpp"
 #include "PmLogger.hpp"
 #include "FileUtilities.hpp"
+#include "FileFingerprintCache.hpp"
+#include "ConfigurationWriter.hpp"
 #include "PackageManager/PmTypes.h"
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace { //anonymous namespace
+    // Lowest scheduling priority; threads started by discovery inherit it.
+    const int prewarmNiceValue = 19;
+
+    // Triggers (ldconfig, systemd reload, man-db, ...) run once for the whole batch, and packages whose exact
+    // version is installed already are not reinstalled. The package lock is waited for with its default timeout.
+    const std::map<std::string, int> kBatchInstallOptions {
+        {kInstallOptionDeferTriggers, 1},
+        {kInstallOptionSkipInstalledVersion, 1}
+    };
+
+    // Components are named "product/version".
+    bool IsInInventory(const PackageInventory &inventory, const std::string &productAndVersion) {
+        return std::any_of(inventory.packages.begin(), inventory.packages.end(), [&productAndVersion](const PmInstalledPackage &package) {
+            return package.product + "/" + package.version == productAndVersion;
+        });
+    }
+}
 
 PmPlatformComponentManager::PmPlatformComponentManager(
     std::shared_ptr<IPackageUtil> pkgUtil,
@@ -21,8 +50,40 @@ PmPlatformComponentManager::PmPlatformComponentManager(
         }
     }
 
+PmPlatformComponentManager::OperationScope::OperationScope(PmPlatformComponentManager &manager)
+    : manager_(manager), muted_(false) {
+    std::lock_guard<std::mutex> lock(manager_.activityMutex_);
+    ++manager_.runningOperations_;
+}
+
+PmPlatformComponentManager::OperationScope::OperationScope(PmPlatformComponentManager &manager, const std::string &mutedDirectory)
+    : manager_(manager), muted_(true), mutedDirectory_(mutedDirectory) {
+    manager_.discovery_.MuteConfigurableChanges(mutedDirectory_);
+    std::lock_guard<std::mutex> lock(manager_.activityMutex_);
+    ++manager_.runningOperations_;
+}
+
+PmPlatformComponentManager::OperationScope::~OperationScope() {
+    if (muted_) {
+        manager_.discovery_.UnmuteConfigurableChanges(mutedDirectory_);
+    }
+    std::lock_guard<std::mutex> lock(manager_.activityMutex_);
+    --manager_.runningOperations_;
+    manager_.lastOperationEnd_ = std::chrono::steady_clock::now();
+}
+
+bool PmPlatformComponentManager::IsIdleFor(std::chrono::milliseconds quiet) {
+    std::lock_guard<std::mutex> lock(activityMutex_);
+    return runningOperations_ == 0 && std::chrono::steady_clock::now() - lastOperationEnd_ >= quiet;
+}
+
 int32_t PmPlatformComponentManager::GetInstalledPackages(const std::vector<PmProductDiscoveryRules> &catalogRules, PackageInventory &packagesDiscovered) {
-    
+    const OperationScope operation(*this);
+    std::lock_guard<std::mutex> lock(discoveryMutex_);
+    if (prewarm_.valid()) {
+        prewarm_.get();
+    }
+
     try {
         packagesDiscovered = discovery_.DiscoverInstalledPackages(catalogRules);
     } catch (PkgUtilException& e) {
@@ -30,39 +91,326 @@ int32_t PmPlatformComponentManager::GetInstalledPackages(const std::vector<PmPro
         return -1;
     }
 
+    if (rulesStore_) {
+        (void)rulesStore_->Save(catalogRules);
+    }
+    SaveInventorySnapshot();
+
+    // The installs journaled so far are part of this inventory. Of the previous run, only the installs this
+    // inventory confirms are kept, for the batch it left unfinished to resume; a package that was removed since,
+    // or whose install never took, must be installed again when it is requested.
+    if (installJournal_) {
+        installJournal_->Retain([&packagesDiscovered](const std::string &component, const InstallJournal::Entry &entry) {
+            return entry.phase == InstallJournal::Phase::Finished && entry.result == 0 && IsInInventory(packagesDiscovered, component);
+        });
+        (void)installJournal_->Compact();
+    }
     return 0;
 }
 
+bool PmPlatformComponentManager::RestoreInventorySnapshot(const std::filesystem::path &snapshotFile) {
+    std::lock_guard<std::mutex> lock(discoveryMutex_);
+    if (inventoryStore_) {
+        return false;
+    }
+    inventoryStore_ = std::make_unique<InventorySnapshotStore>(snapshotFile);
+
+    const auto start = std::chrono::steady_clock::now();
+    PackageInventory inventory;
+    uint64_t inventoryGeneration = 0;
+    if (!inventoryStore_->Load(inventory, inventoryGeneration)) {
+        PM_LOG_INFO("No inventory snapshot, the cached inventory stays empty until discovery");
+        return false;
+    }
+    if (!discovery_.RestoreInventory(inventory, inventoryGeneration)) {
+        return false;
+    }
+    PM_LOG_INFO("Restored inventory generation %llu of %zu products in %lld us",
+        static_cast<unsigned long long>(inventoryGeneration), inventory.packages.size(),
+        static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count()));
+    return true;
+}
+
+bool PmPlatformComponentManager::WatchConfigurables(std::chrono::milliseconds debounce, std::function<void()> onChange) {
+    std::lock_guard<std::mutex> lock(discoveryMutex_);
+    if (prewarm_.valid()) {
+        PM_LOG_WARNING("Configurables must be watched before the inventory pre-warm starts");
+        return false;
+    }
+    return discovery_.WatchConfigurables(debounce, std::move(onChange));
+}
+
+void PmPlatformComponentManager::SaveInventorySnapshot() {
+    if (inventoryStore_) {
+        (void)inventoryStore_->Save(*discovery_.CachedInventory(), discovery_.LastInventoryDelta().inventoryGeneration);
+    }
+}
+
+void PmPlatformComponentManager::StartInventoryPrewarm(const std::filesystem::path &rulesFile) {
+    std::lock_guard<std::mutex> lock(discoveryMutex_);
+    if (rulesStore_) {
+        return;
+    }
+    rulesStore_ = std::make_unique<DiscoveryRulesStore>(rulesFile);
+
+    std::vector<PmProductDiscoveryRules> catalogRules;
+    if (!rulesStore_->Load(catalogRules)) {
+        PM_LOG_INFO("No stored discovery rules, inventory is not pre-warmed");
+        return;
+    }
+
+    // GetInstalledPackages() waits for this under discoveryMutex_, so discovery never runs twice at once.
+    prewarm_ = std::async(std::launch::async, [this, catalogRules = std::move(catalogRules)]() {
+        if (setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), prewarmNiceValue) != 0) {
+            PM_LOG_WARNING("Unable to lower the pre-warm thread priority: %d", errno);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        try {
+            const auto inventory = discovery_.DiscoverInstalledPackages(catalogRules);
+            PM_LOG_INFO("Pre-warmed inventory of %zu products in %lld ms", inventory.packages.size(),
+                static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()));
+            SaveInventorySnapshot();
+        } catch (PkgUtilException& e) {
+            PM_LOG_WARNING("Inventory pre-warm failed: [%s]", e.what());
+        }
+    });
+}
+
 int32_t PmPlatformComponentManager::GetCachedInventory(PackageInventory &cachedInventory) {
-    cachedInventory = discovery_.CachedInventory();
+    cachedInventory = *discovery_.CachedInventory();
     return 0;
 }
 
-int32_t PmPlatformComponentManager::InstallComponent(const PmComponent &package) {
-    int32_t ret = -1;
+bool PmPlatformComponentManager::EnableInstallerCache(const std::filesystem::path &directory, std::chrono::seconds maxAge, uint64_t maxBytes) {
+    if (installerCache_) {
+        return false;
+    }
+    installerCache_ = std::make_unique<InstallerCache>(directory, maxAge, maxBytes);
+    (void)installerCache_->Evict();
+    PM_LOG_INFO("Installer cache holds %zu installers of %llu bytes", installerCache_->Entries(),
+        static_cast<unsigned long long>(installerCache_->Bytes()));
+    return true;
+}
+
+std::filesystem::path PmPlatformComponentManager::FindInstaller(const PmComponent &package) {
+    if (fileUtils_->PathIsValid(package.downloadedInstallerPath)) {
+        return package.downloadedInstallerPath;
+    }
+
+    if (!installerCache_ || package.installerHash.empty()) {
+        return {};
+    }
+    const auto cachedInstaller = installerCache_->Lookup(package.installerHash);
+    if (!cachedInstaller.empty()) {
+        PM_LOG_INFO("Installing %s from the installer cache", package.productAndVersion.c_str());
+    }
+    return cachedInstaller;
+}
+
+bool PmPlatformComponentManager::VerifyInstallerDigest(const std::filesystem::path &installerPath, const PmComponent &package) {
+    if (package.installerHash.empty()) {
+        PM_LOG_DEBUG("No installer digest for package(%s)", package.productAndVersion.c_str());
+        return true;
+    }
+
+    const int fd = open(installerPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        PM_LOG_ERROR("Unable to open %s: %d", installerPath.c_str(), errno);
+        return false;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    std::string digest;
+    const bool hashed = FileFingerprintCache::Sha256(fd, digest);
+    (void)close(fd);
+    if (!hashed) {
+        PM_LOG_ERROR("Unable to hash %s", installerPath.c_str());
+        return false;
+    }
+    if (strcasecmp(digest.c_str(), package.installerHash.c_str()) != 0) {
+        PM_LOG_ERROR("Installer digest %s does not match %s for package(%s)", digest.c_str(),
+            package.installerHash.c_str(), package.productAndVersion.c_str());
+        return false;
+    }
+    PM_LOG_DEBUG("Verified installer digest for package(%s) in %lld ms", package.productAndVersion.c_str(),
+        static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()));
+    return true;
+}
+
+bool PmPlatformComponentManager::EnableInstallJournal(const std::filesystem::path &journalFile) {
+    if (installJournal_) {
+        return false;
+    }
+    installJournal_ = std::make_unique<InstallJournal>(journalFile);
+    return true;
+}
+
+bool PmPlatformComponentManager::InstalledBeforeRestart(const PmComponent &package) {
+    // Without a digest there is no telling whether the journaled installer is this one.
+    InstallJournal::Entry entry;
+    if (!installJournal_ || package.installerHash.empty() || !installJournal_->Recovered(package.productAndVersion, entry) ||
+        strcasecmp(entry.digest.c_str(), package.installerHash.c_str()) != 0 ||
+        entry.phase != InstallJournal::Phase::Finished || entry.result != 0) {
+        return false;
+    }
+    if (!IsInInventory(*discovery_.CachedInventory(), package.productAndVersion)) {
+        PM_LOG_INFO("Package(%s) was installed before the restart but is not discovered, installing it again",
+            package.productAndVersion.c_str());
+        installJournal_->Forget(package.productAndVersion);
+        return false;
+    }
+    PM_LOG_INFO("Package(%s) was installed before the restart, skipping it", package.productAndVersion.c_str());
+    installJournal_->Forget(package.productAndVersion);
+    return true;
+}
+
+std::filesystem::path PmPlatformComponentManager::VerifyComponent(const PmComponent &package) {
+    if (installJournal_) {
+        (void)installJournal_->Record(package.productAndVersion, package.installerHash, InstallJournal::Phase::Started);
+    }
 
-    if (!fileUtils_->PathIsValid(package.downloadedInstallerPath))
-        return ret;
+    const auto installerPath = FindInstaller(package);
+    if (installerPath.empty())
+        return {};
 
     if( !pkgUtil_->isValidInstallerType(package.installerType)) {
         PM_LOG_ERROR("Invalid Installer Type: %s for package(%s)", package.installerType.c_str(), package.productAndVersion.c_str());
-        return ret;
+        return {};
+    }
+
+    // Hashing is far cheaper than verifying the signature, so corrupt downloads are rejected first.
+    if (!VerifyInstallerDigest(installerPath, package)) {
+        return {};
     }
 
 #ifdef ENABLE_CODESIGN_VERIFICATION
-    if( !pkgUtil_->verifyPackage(package.downloadedInstallerPath, package.signerName) ) {
+    // Verified on every run, even if the journal says the previous run did: the trust store may have changed since.
+    if( !pkgUtil_->verifyPackage(installerPath, package.signerName) ) {
         PM_LOG_ERROR("Package verification failed for package(%s)", package.productAndVersion.c_str());
-        return ret;
+        return {};
     }
 #endif
 
+    if (installJournal_) {
+        (void)installJournal_->Record(package.productAndVersion, package.installerHash, InstallJournal::Phase::Verified);
+    }
+    return installerPath;
+}
+
+int32_t PmPlatformComponentManager::InstallVerifiedComponent(const PmComponent &package, const std::filesystem::path &installerPath,
+    const std::map<std::string, int> &installOptions) {
     // Use installPackageWithContext to pass catalog information
-    ret = (pkgUtil_->installPackageWithContext(package.downloadedInstallerPath, package.productAndVersion)) ? 0 : -1;
+    const int32_t ret = (pkgUtil_->installPackageWithContext(installerPath, package.productAndVersion, installOptions)) ? 0 : -1;
     
     PM_LOG_INFO("Package installation status %d for %s", ret, package.productAndVersion.c_str());
+    if (installerCache_) {
+        // Only installers that verified and installed are cached. VerifyComponent already hashed this one.
+        if (ret == 0 && installerPath == package.downloadedInstallerPath && !package.installerHash.empty()) {
+            (void)installerCache_->Add(installerPath, package.installerHash, true);
+        }
+    }
+    if (installJournal_) {
+        (void)installJournal_->Record(package.productAndVersion, package.installerHash, InstallJournal::Phase::Finished, ret);
+        installJournal_->Forget(package.productAndVersion);
+    }
+    return ret;
+}
+
+int32_t PmPlatformComponentManager::InstallComponent(const PmComponent &package) {
+    // Installs change configurables anywhere; the next discovery picks them up without an early check-in.
+    const OperationScope operation(*this, {});
+    if (InstalledBeforeRestart(package))
+        return 0;
+
+    const auto installerPath = VerifyComponent(package);
+    if (installerPath.empty())
+        return -1;
+
+    const int32_t ret = InstallVerifiedComponent(package, installerPath);
+    if (installerCache_) {
+        (void)installerCache_->Evict();
+    }
+    return ret;
+}
+
+int32_t PmPlatformComponentManager::InstallComponents(const std::vector<PmComponent> &packages, size_t &installedCount) {
+    const OperationScope operation(*this, {});
+    installedCount = 0;
+
+    // A batch interrupted by a restart resumes at its first package that was not installed.
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < packages.size(); ++i) {
+        if (InstalledBeforeRestart(packages[i])) {
+            ++installedCount;
+        } else {
+            pending.push_back(i);
+        }
+    }
+    if (pending.empty()) {
+        return 0;
+    }
+    if (installedCount != 0) {
+        PM_LOG_INFO("Resuming batch install at package(%s), %zu of %zu packages were installed before the restart",
+            packages[pending.front()].productAndVersion.c_str(), installedCount, packages.size());
+    }
+
+    // Verifying is CPU bound and installing is mostly waiting on the package manager, so the next package is
+    // verified on a worker while the current one installs. The future's destructor waits for the worker, so no
+    // verification outlives this call.
+    int32_t ret = 0;
+    std::future<std::filesystem::path> nextInstaller;
+    std::filesystem::path installerPath = VerifyComponent(packages[pending.front()]);
+    for (size_t i = 0; i < pending.size(); ++i) {
+        const PmComponent &package = packages[pending[i]];
+        if (i > 0) {
+            installerPath = nextInstaller.get();
+        }
+        if (installerPath.empty()) {
+            ret = -1;
+        } else {
+            if (i + 1 < pending.size()) {
+                nextInstaller = std::async(std::launch::async, [this, &next = packages[pending[i + 1]]]() { return VerifyComponent(next); });
+            }
+            ret = InstallVerifiedComponent(package, installerPath, kBatchInstallOptions);
+        }
+        if (ret != 0) {
+            PM_LOG_ERROR("Stopping batch install at package(%s), %zu of %zu packages installed",
+                package.productAndVersion.c_str(), installedCount, packages.size());
+            break;
+        }
+        ++installedCount;
+    }
+
+    // Evicted only once no verification is running: the next package may be served from the cache, and evicting
+    // while it installs could unlink its installer.
+    if (nextInstaller.valid()) {
+        nextInstaller.wait();
+    }
+    if (installerCache_) {
+        (void)installerCache_->Evict();
+    }
+
+    // The packages installed before a failure still need their triggers.
+    if (!pkgUtil_->processPendingTriggers()) {
+        PM_LOG_ERROR("Failed to process the triggers of the batch, %zu of %zu packages installed", installedCount, packages.size());
+        ret = -1;
+    }
+    LogInstallMetrics();
     return ret;
 }
 
+void PmPlatformComponentManager::LogInstallMetrics() {
+    const PackageInstallMetrics metrics = pkgUtil_->getInstallMetrics();
+    PM_LOG_INFO("Install metrics: %u installed, %u already installed, %u rejected for their architecture, "
+        "%lld ms waiting for the package lock (%u timeouts), %u packages with deferred triggers processed in %u runs "
+        "taking %lld ms, roughly %lld ms saved by deferring",
+        metrics.packagesInstalled, metrics.packagesSkippedAlreadyInstalled, metrics.packagesRejectedArchitecture,
+        static_cast<long long>(metrics.lockWaitTime.count()), metrics.lockWaitTimeouts,
+        metrics.packagesWithDeferredTriggers, metrics.deferredTriggerRuns,
+        static_cast<long long>(metrics.triggerProcessingTime.count()),
+        static_cast<long long>(metrics.roughTriggerTimeSavedEstimate.count()));
+}
+
 IPmPlatformComponentManager::PmInstallResult PmPlatformComponentManager::UpdateComponent(const PmComponent &package, std::string &error) {
     (void) error;
     //TODO: Re-start required handling if needed
@@ -75,13 +423,96 @@ IPmPlatformComponentManager::PmInstallResult PmPlatformComponentManager::UpdateC
 }
 
 int32_t PmPlatformComponentManager::UninstallComponent(const PmComponent &package) {
-    (void) package;
-    return 0;
+    size_t uninstalledCount = 0;
+    return UninstallComponents({package}, uninstalledCount);
+}
+
+int32_t PmPlatformComponentManager::UninstallComponents(const std::vector<PmComponent> &packages, size_t &uninstalledCount) {
+    uninstalledCount = 0;
+    const OperationScope operation(*this, {});
+    std::lock_guard<std::mutex> lock(discoveryMutex_);
+    if (prewarm_.valid()) {
+        prewarm_.get();
+    }
+
+    // Packages are found through the discovery that put their products in the inventory.
+    int32_t ret = 0;
+    const auto inventory = discovery_.CachedInventory();
+    std::vector<std::pair<std::string, std::string>> removals;
+    std::set<std::string> requestedProducts;
+    for (const auto &package : packages) {
+        const std::string product = package.productAndVersion.substr(0, package.productAndVersion.find('/'));
+        if (!requestedProducts.insert(product).second) {
+            continue;
+        }
+        const std::string pkgIdentifier = discovery_.InstalledPackageOf(product);
+        if (!pkgIdentifier.empty()) {
+            removals.emplace_back(product, pkgIdentifier);
+        } else if (std::any_of(inventory->packages.begin(), inventory->packages.end(),
+                       [&product](const PmInstalledPackage &installed) { return installed.product == product; })) {
+            PM_LOG_ERROR("The package of %s is not known before discovery runs", product.c_str());
+            ret = -1;
+        } else {
+            PM_LOG_INFO("%s is not installed, nothing to uninstall", product.c_str());
+            ++uninstalledCount;
+        }
+    }
+
+    // One transaction pays for the package lock and database rewrite once. If it fails, removing the packages
+    // one at a time tells which ones cannot be removed.
+    std::set<std::string> removedProducts;
+    bool batchRemoved = false;
+    if (removals.size() > 1) {
+        std::vector<std::string> pkgIdentifiers;
+        for (const auto &removal : removals) {
+            pkgIdentifiers.push_back(removal.second);
+        }
+        batchRemoved = pkgUtil_->uninstallPackages(pkgIdentifiers);
+        if (!batchRemoved) {
+            PM_LOG_WARNING("Uninstalling %zu packages at once failed, uninstalling them one at a time", removals.size());
+        }
+    }
+    for (const auto &removal : removals) {
+        if (batchRemoved || pkgUtil_->uninstallPackage(removal.second)) {
+            removedProducts.insert(removal.first);
+        } else {
+            PM_LOG_ERROR("Failed to uninstall package %s of %s", removal.second.c_str(), removal.first.c_str());
+            ret = -1;
+        }
+    }
+
+    if (!removedProducts.empty()) {
+        for (const auto &product : removedProducts) {
+            if (installJournal_)
+                installJournal_->Forget(product);
+        }
+        discovery_.RemoveProducts(removedProducts);
+        SaveInventorySnapshot();
+    }
+    uninstalledCount += removedProducts.size();
+    return ret;
 }
 
 int32_t PmPlatformComponentManager::DeployConfiguration(const PackageConfigInfo &config) {
-    (void) config;
-    return 0;
+    const std::filesystem::path &target = config.deployPath.empty() ? config.cfgPath : config.deployPath;
+    if (target.empty() || target.native().find_first_of("*?") != std::string::npos) {
+        PM_LOG_ERROR("No deploy path for configuration of %s", config.forProductAndVersion.c_str());
+        return -1;
+    }
+
+    const OperationScope operation(*this, target.parent_path().generic_u8string());
+    switch (PackageManager::ConfigurationWriter::Write(target, config.contents, config.sha256)) {
+    case PackageManager::ConfigurationWriter::Result::Unchanged:
+        PM_LOG_DEBUG("Configuration %s is unchanged", target.c_str());
+        return 0;
+    case PackageManager::ConfigurationWriter::Result::Written:
+        PM_LOG_INFO("Deployed configuration %s for %s", target.c_str(), config.forProductAndVersion.c_str());
+        return 0;
+    case PackageManager::ConfigurationWriter::Result::Failed:
+        break;
+    }
+    PM_LOG_ERROR("Failed to deploy configuration %s for %s", target.c_str(), config.forProductAndVersion.c_str());
+    return -1;
 }
 
 std::string PmPlatformComponentManager::ResolvePath(const std::string &basePath) {
@@ -99,6 +530,10 @@ void PmPlatformComponentManager::NotifySystemRestart() {
 
 int32_t PmPlatformComponentManager::ApplyBultinUsersReadPermissions(const std::filesystem::path &filePath)
 {
+    const int32_t nRet = fileUtils_->ApplyRestrictions(filePath, PackageManager::PathRestriction::Users, false);
+    if (nRet != PackageManager::IFileUtilities::kRestrictionsNotSupported)
+        return nRet;
+
     if (!fileUtils_->PathIsValid(filePath))
         return -1;
     
@@ -111,7 +546,11 @@ int32_t PmPlatformComponentManager::ApplyBultinUsersReadPermissions(const std::f
 
 int32_t PmPlatformComponentManager::RestrictPathPermissionsToAdmins(const std::filesystem::path &filePath)
 {
-    int32_t nRet = -1;
+    int32_t nRet = fileUtils_->ApplyRestrictions(filePath, PackageManager::PathRestriction::Admins, false);
+    if (nRet != PackageManager::IFileUtilities::kRestrictionsNotSupported)
+        return nRet;
+
+    nRet = -1;
     if (!fileUtils_->PathIsValid(filePath))
         return  nRet;
 
@@ -123,3 +562,15 @@ int32_t PmPlatformComponentManager::RestrictPathPermissionsToAdmins(const std::f
 
     return nRet;
 }
+
+int32_t PmPlatformComponentManager::ApplyBultinUsersReadPermissionsToTree(const std::filesystem::path &directory)
+{
+    const int32_t nRet = fileUtils_->ApplyRestrictions(directory, PackageManager::PathRestriction::Users, true);
+    return nRet == PackageManager::IFileUtilities::kRestrictionsNotSupported ? -1 : nRet;
+}
+
+int32_t PmPlatformComponentManager::RestrictTreePermissionsToAdmins(const std::filesystem::path &directory)
+{
+    const int32_t nRet = fileUtils_->ApplyRestrictions(directory, PackageManager::PathRestriction::Admins, true);
+    return nRet == PackageManager::IFileUtilities::kRestrictionsNotSupported ? -1 : nRet;
+}
@@ -8,8 +8,16 @@
 #include "PackageManager/IPmPlatformComponentManager.h"
 #include "IPackageUtil.hpp"
 #include "PmPlatformDiscovery.hpp"
+#include "DiscoveryRulesStore.hpp"
+#include "InventorySnapshotStore.hpp"
+#include "InstallerCache.hpp"
+#include "InstallJournal.hpp"
 #include "IFileUtilities.hpp"
+#include <chrono>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
 
 class IPmCodesignVerifier;
 
@@ -33,6 +41,65 @@ public:
      */
     int32_t GetCachedInventory(PackageInventory &cachedInventory);
 
+    /**
+     * @brief Starts discovering the installed packages for the catalog rules stored by the previous run, on a
+     *   low priority background thread. The first GetInstalledPackages() waits for it and reuses its per-rule
+     *   results wherever the package database and configurable directories did not change since.
+     *   The catalog rules of every successful discovery are stored to rulesFile from then on.
+     *
+     * @param[in] rulesFile - File the catalog rules are kept in
+     */
+    void StartInventoryPrewarm(const std::filesystem::path &rulesFile);
+
+    /**
+     * @brief Publishes the inventory persisted by the previous run as the cached inventory, so that
+     *   GetCachedInventory() has a result before the first discovery finishes. The inventory of every
+     *   discovery is persisted to snapshotFile from then on. Call before StartInventoryPrewarm().
+     *
+     * @param[in] snapshotFile - File the inventory snapshot is kept in
+     * @return true if a snapshot was restored
+     */
+    bool RestoreInventorySnapshot(const std::filesystem::path &snapshotFile);
+
+    /**
+     * @brief Watches the directories of the discovered configurables with inotify, so that discovery only
+     *   re-checks the ones that changed. Call before StartInventoryPrewarm().
+     *
+     * @param[in] debounce - How long the directories have to be quiet before onChange runs
+     * @param[in] onChange - Called on the watcher thread after a burst of configurable changes, may be empty
+     * @return true if the directories can be watched
+     */
+    bool WatchConfigurables(std::chrono::milliseconds debounce, std::function<void()> onChange);
+
+    /**
+     * @brief Returns true if no check-in operation (discovery, install, uninstall or deploy) is running and none
+     *   ended within the quiet period, that is if no check-in appears to be in progress.
+     */
+    bool IsIdleFor(std::chrono::milliseconds quiet);
+
+    /**
+     * @brief Keeps the installer of every successful install that has a digest in a cache under its SHA-256 digest, so that
+     *   installing it again is served from the cache once its download is gone. Expired entries are evicted
+     *   after every install. Call before the first install.
+     *
+     * @param[in] directory - Directory the installers and their index are kept in
+     * @param[in] maxAge - Installers unused for longer are evicted
+     * @param[in] maxBytes - Total size the cache is evicted down to, 0 for no cap
+     * @return true if the cache is enabled
+     */
+    bool EnableInstallerCache(const std::filesystem::path &directory, std::chrono::seconds maxAge, uint64_t maxBytes);
+
+    /**
+     * @brief Journals every install, so that after a restart the components the previous run installed are
+     *   skipped, provided they come with the same digest and discovery finds them installed. Every discovery
+     *   drops the records of this run from the journal, and keeps those of the previous run's installs that it
+     *   finds and that were not acted on yet. Call before the first install.
+     *
+     * @param[in] journalFile - File the journal is kept in
+     * @return true if the journal is enabled
+     */
+    bool EnableInstallJournal(const std::filesystem::path &journalFile);
+
     /**
      * @brief This API will be used to install a package. The package will provide the following:
      *   - Installation binary
@@ -44,6 +111,21 @@ public:
      */
     int32_t InstallComponent(const PmComponent &package);
 
+    /**
+     * @brief Installs packages in order, as InstallComponent() does for each one, stopping at the first package
+     *   that fails to verify or install. The next package is verified while the current one installs. Package
+     *   triggers are deferred and processed once after the last install, and packages whose exact version is
+     *   installed already are not reinstalled.
+     *
+     * @param[in] packages - The packages, in install order
+     * @param[out] installedCount - Number of packages installed, from the first one on
+     * @return 0 if every package was installed and its triggers processed. -1 otherwise
+     * @note The PackageManager library does not call this: it installs the packages of a check-in one at a time
+     *   through InstallComponent(), which neither pipelines verification nor defers triggers. Only callers that
+     *   hold the whole batch get those savings.
+     */
+    int32_t InstallComponents(const std::vector<PmComponent> &packages, size_t &installedCount);
+
     /**
      * @brief This API will be used to update a package. The package will provide the following:
      *   - Installation binary
@@ -69,14 +151,27 @@ public:
      */
     int32_t UninstallComponent(const PmComponent &package);
 
+    /**
+     * @brief Removes the installed packages of several products through the package manager, in one transaction
+     *   where possible. The cached inventory drops each removed product without a new discovery. Products that
+     *   are not installed count as uninstalled.
+     *
+     * @param[in] packages - The packages, identified by the product of productAndVersion
+     * @param[out] uninstalledCount - Number of products no longer installed
+     * @return 0 if every product was uninstalled. -1 otherwise
+     */
+    int32_t UninstallComponents(const std::vector<PmComponent> &packages, size_t &uninstalledCount);
+
     /**
      * @brief This API will be used to deploy a configuration file for a package. The configuration will provide the
      *   following:
      *   - Configuration file path
      *   - Configuration contents
      *   - commandline to validate the configuration file
+     *   The file at the deploy path, or the config path if there is none, is replaced atomically, and only if
+     *   its contents differ.
      *
-     * @return 0 if the configuration was deployed. -1 otherwise
+     * @return 0 if the configuration was deployed or was deployed already. -1 otherwise
      */
     int32_t DeployConfiguration(const PackageConfigInfo &config);
 
@@ -120,9 +215,102 @@ public:
     * @return 0 on success
     */
     int32_t RestrictPathPermissionsToAdmins(const std::filesystem::path &filePath);
+
+    /**
+    * @brief Same as ApplyBultinUsersReadPermissions(), for a directory and everything below it on the same
+    *   file system. Symbolic links are neither followed nor changed.
+    *
+    * @return 0 on success
+    */
+    int32_t ApplyBultinUsersReadPermissionsToTree(const std::filesystem::path &directory);
+
+    /**
+    * @brief Same as RestrictPathPermissionsToAdmins(), for a directory and everything below it on the same
+    *   file system. Symbolic links are neither followed nor changed.
+    *
+    * @return 0 on success
+    */
+    int32_t RestrictTreePermissionsToAdmins(const std::filesystem::path &directory);
     
 private:
+    /**
+     * @brief Marks a check-in operation as running for IsIdleFor(). A muted scope also keeps the configurable
+     *   changes the operation makes from running the configurable change handler.
+     */
+    class OperationScope {
+    public:
+        explicit OperationScope(PmPlatformComponentManager &manager);
+        /**
+         * @param[in] mutedDirectory - Directory the operation changes, empty for anywhere
+         */
+        OperationScope(PmPlatformComponentManager &manager, const std::string &mutedDirectory);
+        ~OperationScope();
+
+        OperationScope(const OperationScope&) = delete;
+        OperationScope& operator=(const OperationScope&) = delete;
+
+    private:
+        PmPlatformComponentManager &manager_;
+        const bool muted_;
+        const std::string mutedDirectory_;
+    };
+
+    /**
+     * @brief Persists the inventory of the last discovery, if a snapshot file was set.
+     */
+    void SaveInventorySnapshot();
+
+    /**
+     * @brief The installer to install a package from: its download, or else the cached installer with the
+     *   package's digest.
+     *
+     * @return Empty if there is neither
+     */
+    std::filesystem::path FindInstaller(const PmComponent &package);
+
+    /**
+     * @brief Checks that the installer hashes to the package's SHA-256 digest, if it has one.
+     */
+    bool VerifyInstallerDigest(const std::filesystem::path &installerPath, const PmComponent &package);
+
+    /**
+     * @brief Checks everything about a package that InstallComponent() checks before installing it.
+     *
+     * @return The installer to install the package from, empty if the package must not be installed
+     */
+    std::filesystem::path VerifyComponent(const PmComponent &package);
+
+    /**
+     * @brief Installs a package from an installer that VerifyComponent() returned. Does not evict the installer
+     *   cache: the caller does, once no installer the cache handed out is still to be installed.
+     *
+     * @param[in] installOptions - Options passed to the package utility, see IPackageUtil.hpp
+     * @return 0 if the package was installed. -1 otherwise
+     */
+    int32_t InstallVerifiedComponent(const PmComponent &package, const std::filesystem::path &installerPath,
+        const std::map<std::string, int> &installOptions = {});
+
+    /**
+     * @brief Logs the install counters of the package utility, which add up across batches.
+     */
+    void LogInstallMetrics();
+
+    /**
+     * @brief Returns true if the run before the restart installed the package, with the same digest, and the
+     *   last discovery found it installed, so that it needs no install.
+     */
+    bool InstalledBeforeRestart(const PmComponent &package);
+
     std::shared_ptr<IPackageUtil> pkgUtil_;
     PmPlatformDiscovery discovery_;
     std::shared_ptr<PackageManager::IFileUtilities> fileUtils_;
+    std::unique_ptr<DiscoveryRulesStore> rulesStore_;
+    std::unique_ptr<InventorySnapshotStore> inventoryStore_;
+    std::unique_ptr<InstallerCache> installerCache_;
+    std::unique_ptr<InstallJournal> installJournal_;
+    std::mutex discoveryMutex_; /**< Discovery is not reentrant. */
+    std::mutex activityMutex_;
+    size_t runningOperations_ = 0;
+    std::chrono::steady_clock::time_point lastOperationEnd_ = std::chrono::steady_clock::now();
+    std::future<void> prewarm_; /**< Declared last: destroying it waits for the pre-warm to finish. */
 };
@@ -9,12 +9,74 @@
 #include "PmCertRetrieverImpl.hpp"
 #include "CMIDAPIProxy.hpp"
 #include "FileUtilities.hpp"
+#include "PmLogger.hpp"
+#include <fstream>
+#include <json/json.h>
 #ifdef IS_RHEL
 #include "PackageUtilRPM.hpp"
 #else
 #include "PackageUtilDEB.hpp"
 #endif
 
+namespace { //anonymous namespace
+    const std::string kDiscoveryRulesFileName {"discovery_rules.json"};
+    const std::string kInventorySnapshotFileName {"inventory_snapshot.bin"};
+    const std::string kCmConfigFileName {"cm_config.json"};
+    const std::string kPmConfigKey {"pm"};
+    const std::string kCheckinOnConfigurableChangeKey {"CheckinOnConfigurableChange"};
+    const std::string kConfigurableChangeDebounceKey {"ConfigurableChangeDebounce_ms"};
+
+    const std::string kMaxFileCacheAgeKey {"maxFileCacheAge_s"};
+    const std::string kMaxFileCacheSizeKey {"maxFileCacheSize_MB"};
+    const std::string kInstallerCacheDirectoryName {"installer_cache"};
+    const std::string kInstallJournalFileName {"install_journal.log"};
+
+    const std::chrono::seconds kDefaultMaxFileCacheAge {604800};
+    const uint64_t kDefaultMaxFileCacheSize_MB = 1024;
+
+    // How long no check-in operation must have run before an early check-in restarts the package manager.
+    // The package manager does not report whether a check-in is in progress, and only the component manager's
+    // operations are seen here: a check-in that spends longer than this downloading or talking to the cloud
+    // looks idle and is cut off by the restart, then starts over.
+    const std::chrono::milliseconds kEarlyCheckinQuietPeriod {60000};
+
+    struct PmSettings {
+        bool checkinOnChange = false;
+        std::chrono::milliseconds debounce = ConfigurableWatcher::kDefaultDebounce;
+        std::chrono::seconds maxFileCacheAge = kDefaultMaxFileCacheAge;
+        uint64_t maxFileCacheSize_MB = kDefaultMaxFileCacheSize_MB;
+    };
+
+    PmSettings ReadPmSettings(const std::filesystem::path& configFile) {
+        PmSettings settings;
+        std::ifstream file(configFile);
+        Json::Value root;
+        JSONCPP_STRING errors;
+        Json::CharReaderBuilder builder;
+        if (!file.is_open() || !Json::parseFromStream(builder, file, &root, &errors) || !root.isObject()) {
+            return settings;
+        }
+
+        const Json::Value& pmConfig = root[kPmConfigKey];
+        if (!pmConfig.isObject()) {
+            return settings;
+        }
+        if (pmConfig[kCheckinOnConfigurableChangeKey].isBool()) {
+            settings.checkinOnChange = pmConfig[kCheckinOnConfigurableChangeKey].asBool();
+        }
+        if (pmConfig[kConfigurableChangeDebounceKey].isUInt()) {
+            settings.debounce = std::chrono::milliseconds(pmConfig[kConfigurableChangeDebounceKey].asUInt());
+        }
+        if (pmConfig[kMaxFileCacheAgeKey].isUInt()) {
+            settings.maxFileCacheAge = std::chrono::seconds(pmConfig[kMaxFileCacheAgeKey].asUInt());
+        }
+        if (pmConfig[kMaxFileCacheSizeKey].isUInt()) {
+            settings.maxFileCacheSize_MB = pmConfig[kMaxFileCacheSizeKey].asUInt();
+        }
+        return settings;
+    }
+}
+
 PmPlatformDependencies::PmPlatformDependencies()
         :
         gpgUtil_(std::make_shared<GpgUtil>()),
@@ -28,8 +90,21 @@ PmPlatformDependencies::PmPlatformDependencies()
 #else
         pmPkgUtil_(std::make_shared<PackageUtilDEB>(*std::move(commandExec_), pmConfiguration_)),
 #endif
-        pmComponentManager_{PmPlatformComponentManager(pmPkgUtil_, std::make_shared<PackageManager::FileUtilities>())}
-{}
+        pmComponentManager_(pmPkgUtil_, std::make_shared<PackageManager::FileUtilities>())
+{
+    const std::filesystem::path dataDirectory(pmConfiguration_.GetDataDirectory());
+    const auto settings = ReadPmSettings(dataDirectory / kCmConfigFileName);
+    earlyCheckinEnabled_ = settings.checkinOnChange;
+    (void)pmComponentManager_.WatchConfigurables(settings.debounce, [this]() { OnConfigurablesChanged(); });
+    (void)pmComponentManager_.EnableInstallerCache(dataDirectory / kInstallerCacheDirectoryName,
+        settings.maxFileCacheAge, settings.maxFileCacheSize_MB * 1024 * 1024);
+    (void)pmComponentManager_.EnableInstallJournal(dataDirectory / kInstallJournalFileName);
+
+    // The inventory of the previous run is served until discovery for its catalog, started now instead of
+    // on the first check-in, replaces it.
+    (void)pmComponentManager_.RestoreInventorySnapshot(dataDirectory / kInventorySnapshotFileName);
+    pmComponentManager_.StartInventoryPrewarm(dataDirectory / kDiscoveryRulesFileName);
+}
 
 IPmPlatformConfiguration &PmPlatformDependencies::Configuration()
 {
@@ -40,3 +115,20 @@ IPmPlatformComponentManager &PmPlatformDependencies::ComponentManager()
 {
     return pmComponentManager_;
 }
+
+bool PmPlatformDependencies::TakeEarlyCheckin()
+{
+    // A check-in in progress finishes first; restarting the package manager would cut it off.
+    if (!earlyCheckinPending_ || !pmComponentManager_.IsIdleFor(kEarlyCheckinQuietPeriod)) {
+        return false;
+    }
+    return earlyCheckinPending_.exchange(false);
+}
+
+void PmPlatformDependencies::OnConfigurablesChanged()
+{
+    if (earlyCheckinEnabled_) {
+        PM_LOG_INFO("Configurables changed, queuing an early check-in");
+        earlyCheckinPending_ = true;
+    }
+}
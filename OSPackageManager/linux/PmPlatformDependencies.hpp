@@ -10,6 +10,7 @@
 #include "PackageManager/IPmPlatformDependencies.h"
 #include "Gpg/include/GpgUtil.hpp"
 #include "OSPackageManager/common/CommandExec.hpp"
+#include <atomic>
 
 class IPmPkgUtil;
 
@@ -20,7 +21,21 @@ public:
     IPmPlatformConfiguration &Configuration();
     IPmPlatformComponentManager &ComponentManager();
 
+    /**
+     * @brief Returns true, once per burst of changes, when watched configurables changed, "CheckinOnConfigurableChange"
+     *        is enabled in the "pm" section of cm_config.json, and no check-in appears to be in progress. Changes
+     *        made by the package manager's own installs and deploys do not count.
+     * @note A check-in appears to be in progress only while the component manager works for it, or did within the
+     *       last minute; a longer download or cloud exchange is not seen and the early check-in interrupts it.
+     */
+    bool TakeEarlyCheckin();
+
 private:
+    void OnConfigurablesChanged();
+
+    std::atomic<bool> earlyCheckinPending_ {false};
+    bool earlyCheckinEnabled_ = false;
+
     std::shared_ptr<IGpgUtil>   gpgUtil_;
     std::shared_ptr<ICommandExec> commandExec_;
     PmPlatformConfiguration pmConfiguration_;     // Moved before pmPkgUtil_
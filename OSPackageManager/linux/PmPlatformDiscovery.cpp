@@ -1,8 +1,15 @@
 #include "PmPlatformDiscovery.hpp"
 #include "PmLogger.hpp"
+#include "ParallelForEach.hpp"
 #include <regex>
+#include <sys/stat.h>
 #include <sys/utsname.h>
 #include <cassert>
+#include <ctime>
+#include <fnmatch.h>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace
 {
@@ -20,43 +27,160 @@ namespace
     };
 
     static std::string sArchForDiscovery = determineArch();
+
+    const char* const kWildcardChars = "*?[";
+    const std::string kRecursiveWildcard {"**"};
+    // A directory modified this recently may change again within the same timestamp tick without its mtime moving.
+    const int64_t kRacyStampWindowNs = 2LL * 1000 * 1000 * 1000;
+
+    int64_t toNanoseconds(const struct timespec& ts) {
+        return static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 * 1000 + ts.tv_nsec;
+    }
+
+    // Everything a rule's result depends on, so that edited catalog rules never reuse stale results.
+    std::string RuleCacheKey(const PmProductDiscoveryRules& rule) {
+        std::string key = rule.product;
+        auto append = [&key](const std::string& value) {
+            key += '\x1f';
+            key += value;
+        };
+        for (const auto& pkgRule : rule.pkgnvra_discovery) {
+            append("nvra:" + pkgRule.pkgId);
+        }
+        for (const auto& pkgNameRule : rule.pkgname_discovery) {
+            append("name:" + pkgNameRule.name);
+        }
+        for (const auto& configurable : rule.configurables) {
+            append(configurable.cfgPath.generic_u8string());
+            append(configurable.unresolvedCfgPath.generic_u8string());
+            append(configurable.deployPath.generic_u8string());
+            append(configurable.unresolvedDeployPath.generic_u8string());
+            append(std::to_string(configurable.max_instances));
+        }
+        return key;
+    }
+
+    // Equal std::filesystem::path values compare equal element-wise; hash their normal form instead.
+    std::string NormalizedPath(const std::filesystem::path& path) {
+        return path.lexically_normal().generic_u8string();
+    }
+
+    // NVRA identifiers are "<name>-<version>-<release>.<arch>", so a changed name is a prefix of them.
+    bool IsRulePackageChanged(const PmProductDiscoveryRules& rule, const std::set<std::string>& changedPackages) {
+        for (const auto& pkgNameRule : rule.pkgname_discovery) {
+            if (changedPackages.count(pkgNameRule.name) != 0)
+                return true;
+        }
+        for (const auto& pkgRule : rule.pkgnvra_discovery) {
+            // Any package may match a wildcard NVRA identifier.
+            if (!changedPackages.empty() && pkgRule.pkgId.find_first_of(kWildcardChars) != std::string::npos)
+                return true;
+            for (const auto& changedPackage : changedPackages) {
+                if (pkgRule.pkgId.size() > changedPackage.size() &&
+                    pkgRule.pkgId.compare(0, changedPackage.size(), changedPackage) == 0 &&
+                    pkgRule.pkgId[changedPackage.size()] == '-')
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    bool HasNvraPattern(const PmProductDiscoveryRules& rule) {
+        return std::any_of(rule.pkgnvra_discovery.begin(), rule.pkgnvra_discovery.end(), [](const auto& pkgRule) {
+            return pkgRule.pkgId.find_first_of(kWildcardChars) != std::string::npos;
+        });
+    }
+
+    bool SameConfigs(const std::vector<PackageConfigInfo>& lhs, const std::vector<PackageConfigInfo>& rhs) {
+        if (lhs.size() != rhs.size())
+            return false;
+        for (size_t i = 0; i < lhs.size(); ++i) {
+            if (lhs[i].cfgPath != rhs[i].cfgPath ||
+                lhs[i].unresolvedCfgPath != rhs[i].unresolvedCfgPath ||
+                lhs[i].deployPath != rhs[i].deployPath ||
+                lhs[i].unresolvedDeployPath != rhs[i].unresolvedDeployPath ||
+                lhs[i].isDiscoveredAtDeployPath != rhs[i].isDiscoveredAtDeployPath ||
+                lhs[i].sha256 != rhs[i].sha256)
+                return false;
+        }
+        return true;
+    }
+}
+
+std::vector<std::filesystem::path> PmPlatformDiscovery::SearchPathsOf(
+    const std::filesystem::path& unresolvedPath,
+    const std::filesystem::path& resolvedPath ) {
+
+    assert(fileUtils_);
+    const std::string tempUnresolvedPath = unresolvedPath.generic_u8string();
+    if( tempUnresolvedPath.find( "<FOLDERID_" ) != std::string::npos ) {
+        const auto userPaths = fileUtils_->ResolvePathForAllUsers( tempUnresolvedPath );
+        if( !userPaths.empty() ) {
+            std::vector<std::filesystem::path> searchPaths;
+            for( const auto& userPath : userPaths ) {
+                searchPaths.push_back( std::filesystem::u8path( userPath ) );
+            }
+            return searchPaths;
+        }
+    }
+    return { resolvedPath };
+}
+
+std::vector<std::string> PmPlatformDiscovery::SearchPathsOf( const std::vector<PmProductDiscoveryConfigurable>& configurables ) {
+    std::vector<std::string> searchPaths;
+    for( const auto& configurable : configurables ) {
+        for( const auto& path : SearchPathsOf( configurable.unresolvedDeployPath, configurable.deployPath ) ) {
+            searchPaths.push_back( path.generic_u8string() );
+        }
+        for( const auto& path : SearchPathsOf( configurable.unresolvedCfgPath, configurable.cfgPath ) ) {
+            searchPaths.push_back( path.generic_u8string() );
+        }
+    }
+    return searchPaths;
 }
 
 void PmPlatformDiscovery::ResolveAndDiscover(
     const std::filesystem::path& unresolvedPath,
     const std::filesystem::path& resolvedPath,
-    std::string& out_knownFolderId,
-    std::string& out_knownFolderIdConversion,
-    std::vector<std::filesystem::path>& out_discoveredFiles ) {
+    size_t maxInstances,
+    std::vector<std::filesystem::path>& out_discoveredFiles,
+    std::vector<std::string>& out_unresolvedFiles ) {
 
-    out_knownFolderId = "";
-    out_knownFolderIdConversion = "";
     out_discoveredFiles.clear();
+    out_unresolvedFiles.clear();
     assert(fileUtils_);
-    if( unresolvedPath != resolvedPath )
-    {
-        //Resolved path is different which means we must calculate the knownfolderid
-        std::string tempResolvedPath = resolvedPath.generic_u8string();
-        std::string tempUnresolvedPath = unresolvedPath.generic_u8string();
-        size_t first = tempUnresolvedPath.find( "<FOLDERID_" );
-        size_t last = tempUnresolvedPath.find_first_of( ">" );
-        if ( std::string::npos != first && std::string::npos != last ) {
-            out_knownFolderId = tempUnresolvedPath.substr( first, last + 1 );
-            std::string remainingPath = tempUnresolvedPath.substr( last + 1, tempUnresolvedPath.length() );
+    const size_t instancesPerSearchPath = std::max<size_t>( maxInstances, 1 );
 
-            first = tempResolvedPath.find( remainingPath );
+    for( const auto& searchPath : SearchPathsOf( unresolvedPath, resolvedPath ) ) {
+        std::string knownFolderId = "";
+        std::string knownFolderIdConversion = "";
+        if( unresolvedPath != searchPath )
+        {
+            //Search path is different which means we must calculate the knownfolderid
+            std::string tempResolvedPath = searchPath.generic_u8string();
+            std::string tempUnresolvedPath = unresolvedPath.generic_u8string();
+            size_t first = tempUnresolvedPath.find( "<FOLDERID_" );
+            size_t last = tempUnresolvedPath.find_first_of( ">" );
+            if ( std::string::npos != first && std::string::npos != last ) {
+                knownFolderId = tempUnresolvedPath.substr( first, last + 1 );
+                std::string remainingPath = tempUnresolvedPath.substr( last + 1, tempUnresolvedPath.length() );
 
-            out_knownFolderIdConversion = tempResolvedPath.substr( 0, first );
-        }
-    }
+                first = tempResolvedPath.find( remainingPath );
 
-    fileUtils_->FileSearchWithWildCard( resolvedPath, out_discoveredFiles );
-    for( auto it = out_discoveredFiles.begin(); it != out_discoveredFiles.end(); ) {
-        if( !fileUtils_->PathIsValid( *it ) ) {
-            it = out_discoveredFiles.erase( it );
+                knownFolderIdConversion = tempResolvedPath.substr( 0, first );
+            }
         }
-        else {
-            it++;
+
+        std::vector<std::filesystem::path> discoveredFiles;
+        FindWildCardMatches( searchPath, instancesPerSearchPath, discoveredFiles );
+        for( auto& discoveredFile : discoveredFiles ) {
+            std::string tempPath = discoveredFile.generic_u8string();
+            if( knownFolderId != "" ) {
+                //We need to convert the path to include knownfolderid
+                tempPath = knownFolderId + tempPath.substr( knownFolderIdConversion.length(), tempPath.length() );
+            }
+            out_unresolvedFiles.push_back( std::move( tempPath ) );
+            out_discoveredFiles.push_back( std::move( discoveredFile ) );
         }
     }
 }
@@ -65,19 +189,28 @@ void PmPlatformDiscovery::DiscoverPackageConfigurables(
     const std::vector<PmProductDiscoveryConfigurable>& configurables,
     std::vector<PackageConfigInfo>& packageConfigs ) {
 
+    // Paths already collected, to reject duplicates and deploy paths that collide with config paths.
+    std::unordered_set<std::string> seenCfgPaths;
+    std::unordered_set<std::string> seenDeployPaths;
+    for( auto& it : packageConfigs ) {
+        if( !it.cfgPath.empty() )
+            seenCfgPaths.insert( NormalizedPath( it.cfgPath ) );
+        if( !it.deployPath.empty() )
+            seenDeployPaths.insert( NormalizedPath( it.deployPath ) );
+    }
+
     for( auto& configurable : configurables ) {
-        std::string knownFolderId = "";
-        std::string knownFolderIdConversion = "";
         std::vector<std::filesystem::path> discoveredFiles;
+        std::vector<std::string> unresolvedFiles;
         bool usingDeployPath = false;
 
         if( !configurable.deployPath.empty() ) {
             ResolveAndDiscover(
                 configurable.unresolvedDeployPath,
                 configurable.deployPath,
-                knownFolderId,
-                knownFolderIdConversion,
-                discoveredFiles
+                configurable.max_instances,
+                discoveredFiles,
+                unresolvedFiles
             );
 
             usingDeployPath = discoveredFiles.size() > 0;
@@ -87,32 +220,18 @@ void PmPlatformDiscovery::DiscoverPackageConfigurables(
             ResolveAndDiscover(
                 configurable.unresolvedCfgPath,
                 configurable.cfgPath,
-                knownFolderId,
-                knownFolderIdConversion,
-                discoveredFiles
+                configurable.max_instances,
+                discoveredFiles,
+                unresolvedFiles
             );
         }
 
-        if( discoveredFiles.size() > configurable.max_instances ) {
-            if( configurable.max_instances == 0 ) {
-                discoveredFiles = std::vector<std::filesystem::path>( discoveredFiles.begin(), discoveredFiles.begin() + 1 );
-            }
-            else {
-                discoveredFiles = std::vector<std::filesystem::path>( discoveredFiles.begin(), discoveredFiles.begin() + configurable.max_instances );
-            }
-        }
-
-        for( auto& discoveredFile : discoveredFiles ) {
+        for( size_t fileIndex = 0; fileIndex < discoveredFiles.size(); ++fileIndex ) {
+            const auto& discoveredFile = discoveredFiles[fileIndex];
+            const std::string& tempPath = unresolvedFiles[fileIndex];
             PackageConfigInfo configInfo = {};
             bool uniqueConfigurable = true;
 
-            std::string tempPath = discoveredFile.generic_u8string();
-            if( knownFolderId != "" ) {
-                //We need to convert the path to include knownfolderid
-                tempPath = tempPath.substr( knownFolderIdConversion.length(), tempPath.length() );
-                tempPath = knownFolderId + tempPath;
-            }
-
             configInfo.isDiscoveredAtDeployPath = usingDeployPath;
 
             if( usingDeployPath ) {
@@ -129,53 +248,229 @@ void PmPlatformDiscovery::DiscoverPackageConfigurables(
                 configInfo.unresolvedCfgPath = std::filesystem::u8path( tempPath );
             }
 
-            for( auto& it : packageConfigs ) {
-                if( usingDeployPath && ( configInfo.deployPath == it.deployPath ) ) {
-                    uniqueConfigurable = false;
-                    break;
-                }
-                else if( !configInfo.cfgPath.empty() && ( configInfo.cfgPath == it.cfgPath ) ) {
-                    uniqueConfigurable = false;
-                    break;
-                } 
-                else if( usingDeployPath && ( configInfo.deployPath == it.cfgPath ) ) {
-                    PM_LOG_ERROR( "Deploy path %s matches a previous config path. Bad cloud configuration", configInfo.deployPath.c_str() );
-                    uniqueConfigurable = false;
-                    break;
-                }
-                else if( !configInfo.cfgPath.empty() && ( configInfo.cfgPath == it.deployPath) ) {
-                    PM_LOG_ERROR( "Deploy path %s matches a previous config path. Bad cloud configuration", configInfo.cfgPath.c_str() );
-                    uniqueConfigurable = false;
-                    break;
-                }
+            const std::string discoveredPath = NormalizedPath( discoveredFile );
+            if( usingDeployPath && seenDeployPaths.count( discoveredPath ) != 0 ) {
+                uniqueConfigurable = false;
+            }
+            else if( !usingDeployPath && seenCfgPaths.count( discoveredPath ) != 0 ) {
+                uniqueConfigurable = false;
+            }
+            else if( usingDeployPath && seenCfgPaths.count( discoveredPath ) != 0 ) {
+                PM_LOG_ERROR( "Deploy path %s matches a previous config path. Bad cloud configuration", configInfo.deployPath.c_str() );
+                uniqueConfigurable = false;
+            }
+            else if( !usingDeployPath && seenDeployPaths.count( discoveredPath ) != 0 ) {
+                PM_LOG_ERROR( "Deploy path %s matches a previous config path. Bad cloud configuration", configInfo.cfgPath.c_str() );
+                uniqueConfigurable = false;
             }
             
             if( uniqueConfigurable ) {
+                ( usingDeployPath ? seenDeployPaths : seenCfgPaths ).insert( discoveredPath );
                 packageConfigs.push_back( configInfo );
             }
         }
     }
 }
-void PmPlatformDiscovery::ProcessPackageDiscovery(
-    const PmProductDiscoveryRules& rule,
-    const std::string& pkgIdentifier,
-    PKG_ID_TYPE pkgType,
-    std::set<std::string>& uniquePks,
-    PackageInventory& packagesDiscovered) {
-    if (uniquePks.find(rule.product) != uniquePks.end())
-        return;
-    const auto& pkgInfo = pkgUtilManager_->getPackageInfo(pkgType, pkgIdentifier);
-    
-    if(pkgInfo.version.empty())
-        return;
-    uniquePks.insert(rule.product);  
-    std::vector<PackageConfigInfo> configs;
-    DiscoverPackageConfigurables(rule.configurables, configs);   
-    PM_LOG_INFO("Discovered package %s, version %s, found %d configurables", 
-                pkgIdentifier.c_str(), pkgInfo.version.c_str(), configs.size());    
-    packagesDiscovered.packages.push_back({rule.product, pkgInfo.version, configs});
+PmPlatformDiscovery::RuleMatch PmPlatformDiscovery::FindInstalledPackage(const PmProductDiscoveryRules& rule) {
+    RuleMatch match;
+    auto lookup = [this, &match](const std::string& pkgIdentifier, PKG_ID_TYPE pkgType) {
+        const auto& pkgInfo = pkgUtilManager_->getPackageInfo(pkgType, pkgIdentifier);
+        if (pkgInfo.version.empty())
+            return false;
+        match.pkgIdentifier = pkgIdentifier;
+        match.version = pkgInfo.version;
+        return true;
+    };
+
+    for (const auto& pkgRule : rule.pkgnvra_discovery) {
+        if (lookup(pkgRule.pkgId, PKG_ID_TYPE::NVRA))
+            return match;
+    }
+    for (const auto& pkgNameRule : rule.pkgname_discovery) {
+        if (lookup(pkgNameRule.name, PKG_ID_TYPE::NAME))
+            return match;
+    }
+    return match;
+}
+
+int32_t PmPlatformDiscovery::FileSearchWithWildCard(const std::filesystem::path& searchPath, std::vector<std::filesystem::path>& results) {
+    assert(fileUtils_);
+    if (directorySnapshot_) {
+        return directorySnapshot_->FileSearchWithWildCard(searchPath, results);
+    }
+    return fileUtils_->FileSearchWithWildCard(searchPath, results);
+}
+
+int32_t PmPlatformDiscovery::FindWildCardMatches(const std::filesystem::path& searchPath, size_t maxResults, std::vector<std::filesystem::path>& results) {
+    assert(fileUtils_);
+    if (directorySnapshot_) {
+        return directorySnapshot_->FindWildCardMatches(searchPath, maxResults, results);
+    }
+    return fileUtils_->FindWildCardMatches(searchPath, maxResults, results);
+}
+
+void PmPlatformDiscovery::MatchInstalledPackages(
+    const std::vector<PmProductDiscoveryRules>& catalogRules,
+    const std::vector<size_t>& ruleIndexes,
+    const std::vector<PackageInfo>& installedPackages,
+    std::vector<RuleMatch>& matches ) {
+
+    // Rank of an identifier within its rule: NVRA identifiers in order, then package names in order.
+    struct IndexedRule {
+        size_t rule;
+        size_t rank;
+    };
+    std::unordered_map<std::string, std::vector<IndexedRule>> nvraIndex;
+    std::unordered_map<std::string, std::vector<IndexedRule>> nameIndex;
+    std::vector<std::pair<const std::string*, IndexedRule>> nvraPatterns;
+
+    for (const size_t i : ruleIndexes) {
+        size_t rank = 0;
+        for (const auto& pkgRule : catalogRules[i].pkgnvra_discovery) {
+            if (pkgRule.pkgId.find_first_of(kWildcardChars) != std::string::npos) {
+                nvraPatterns.push_back({&pkgRule.pkgId, {i, rank++}});
+            } else {
+                nvraIndex[pkgRule.pkgId].push_back({i, rank++});
+            }
+        }
+        for (const auto& pkgNameRule : catalogRules[i].pkgname_discovery) {
+            nameIndex[pkgNameRule.name].push_back({i, rank++});
+        }
+        matches[i] = {};
+    }
+
+    // The best ranked identifier wins; between packages matching the same identifier, the first listed one.
+    std::vector<size_t> bestRank(catalogRules.size(), std::numeric_limits<size_t>::max());
+    auto offer = [&](const IndexedRule& indexed, const std::string& pkgIdentifier, const PackageInfo& package) {
+        if (indexed.rank < bestRank[indexed.rule]) {
+            bestRank[indexed.rule] = indexed.rank;
+            matches[indexed.rule] = {pkgIdentifier, package.version};
+        }
+    };
+
+    for (const auto& package : installedPackages) {
+        if (package.version.empty())
+            continue;
+        if (!package.packageIdentifier.empty()) {
+            const auto nvraRules = nvraIndex.find(package.packageIdentifier);
+            if (nvraRules != nvraIndex.end()) {
+                for (const auto& indexed : nvraRules->second) {
+                    offer(indexed, package.packageIdentifier, package);
+                }
+            }
+            for (const auto& pattern : nvraPatterns) {
+                if (fnmatch(pattern.first->c_str(), package.packageIdentifier.c_str(), 0) == 0) {
+                    offer(pattern.second, package.packageIdentifier, package);
+                }
+            }
+        }
+        const auto nameRules = nameIndex.find(package.packageName);
+        if (nameRules != nameIndex.end()) {
+            for (const auto& indexed : nameRules->second) {
+                offer(indexed, package.packageName, package);
+            }
+        }
+    }
+
+    PM_LOG_DEBUG("Matched %zu rules against %zu installed packages", ruleIndexes.size(), installedPackages.size());
+}
+
+PmPlatformDiscovery::PathStamp PmPlatformDiscovery::StampPath(const std::filesystem::path& path) {
+    PathStamp stamp;
+    stamp.path = path.generic_u8string();
+    struct stat pathStat {};
+    if (stat(stamp.path.c_str(), &pathStat) == 0) {
+        stamp.exists = true;
+        stamp.isDirectory = S_ISDIR(pathStat.st_mode);
+        stamp.device = pathStat.st_dev;
+        stamp.inode = pathStat.st_ino;
+        stamp.mtimeNs = toNanoseconds(pathStat.st_mtim);
+    }
+    return stamp;
 }
 
+bool PmPlatformDiscovery::IsStampCurrent(const PathStamp& stamp) {
+    const PathStamp current = StampPath(stamp.path);
+    return current.exists == stamp.exists &&
+        current.device == stamp.device &&
+        current.inode == stamp.inode &&
+        current.mtimeNs == stamp.mtimeNs;
+}
+
+std::vector<std::string> PmPlatformDiscovery::WatchDirectoriesOf(const std::vector<PathStamp>& stamps) {
+    std::vector<std::string> directories;
+    for (const auto& stamp : stamps) {
+        if (!stamp.exists) {
+            return {};
+        }
+        directories.push_back(stamp.isDirectory ? stamp.path : std::filesystem::u8path(stamp.path).parent_path().generic_u8string());
+    }
+    std::sort(directories.begin(), directories.end());
+    directories.erase(std::unique(directories.begin(), directories.end()), directories.end());
+    return directories;
+}
+
+bool PmPlatformDiscovery::StampConfigurableDependencies(
+    const std::vector<PmProductDiscoveryConfigurable>& configurables,
+    std::vector<PathStamp>& stamps ) {
+
+    bool reusable = true;
+
+    // Measured against the start of the pass: the directory snapshot may have listed a directory
+    // before it was stamped here.
+    auto stampDirectory = [this, &stamps, &reusable](const std::filesystem::path& path) {
+        stamps.push_back(StampPath(path));
+        if (stamps.back().exists && passStartNs_ - stamps.back().mtimeNs < kRacyStampWindowNs) {
+            reusable = false;
+        }
+    };
+
+    for( auto& configurable : configurables ) {
+        std::vector<std::filesystem::path> patterns;
+        if( !configurable.deployPath.empty() ) {
+            patterns = SearchPathsOf( configurable.unresolvedDeployPath, configurable.deployPath );
+        }
+        if( !configurable.cfgPath.empty() ) {
+            const auto cfgPatterns = SearchPathsOf( configurable.unresolvedCfgPath, configurable.cfgPath );
+            patterns.insert( patterns.end(), cfgPatterns.begin(), cfgPatterns.end() );
+        }
+
+        for( const auto& pattern : patterns ) {
+            if( pattern.empty() )
+                continue;
+            if( pattern.generic_u8string().find( kRecursiveWildcard ) != std::string::npos )
+                return false;
+
+            const std::vector<std::filesystem::path> components( pattern.begin(), pattern.end() );
+            size_t firstWildcard = components.size() - 1;
+            for( size_t i = 0; i < components.size(); ++i ) {
+                if( components[i].generic_u8string().find_first_of( kWildcardChars ) != std::string::npos ) {
+                    firstWildcard = i;
+                    break;
+                }
+            }
+
+            // Entries appearing or disappearing in a directory change its mtime, so stamping the literal
+            // parent and every directory matched by a wildcard component covers the whole glob.
+            std::filesystem::path prefix;
+            for( size_t i = 0; i < firstWildcard; ++i ) {
+                prefix /= components[i];
+            }
+            stampDirectory( prefix );
+
+            for( size_t i = firstWildcard; i + 1 < components.size(); ++i ) {
+                prefix /= components[i];
+                std::vector<std::filesystem::path> directories;
+                FileSearchWithWildCard( prefix, directories );
+                for( const auto& directory : directories ) {
+                    stampDirectory( directory );
+                }
+            }
+        }
+    }
+
+    return reusable;
+}
 
 PackageInventory PmPlatformDiscovery::DiscoverInstalledPackages( const std::vector<PmProductDiscoveryRules> &catalogRules ) {
     
@@ -183,26 +478,283 @@ PackageInventory PmPlatformDiscovery::DiscoverInstalledPackages( const std::vect
     if (!pkgUtilManager_) {
         throw std::runtime_error("Invalid pkgUtilManager instance");
     }
+
+    struct timespec passStart {};
+    clock_gettime(CLOCK_REALTIME, &passStart);
+    passStartNs_ = toNanoseconds(passStart);
+
+    // Directory listings are shared by all configurable searches of this pass and dropped at its end.
+    struct SnapshotScope {
+        std::unique_ptr<PackageManager::IDirectorySnapshot>& snapshot;
+        ~SnapshotScope() { snapshot.reset(); }
+    } snapshotScope {directorySnapshot_};
+    directorySnapshot_ = fileUtils_->CreateDirectorySnapshot();
+
+    // Events recorded in the watched configurable directories since the previous discovery.
+    ConfigurableWatcher::Changes watchedChanges;
+    if (watcher_) {
+        watchedChanges = watcher_->TakeChanges();
+    }
+    enum class WatchState { Unknown, Clean, Dirty };
+    auto watchStateOf = [&watchedChanges](const RuleCacheEntry& entry) {
+        if (!watchedChanges.complete || entry.watchDirectories.empty())
+            return WatchState::Unknown;
+        WatchState state = WatchState::Clean;
+        for (const auto& directory : entry.watchDirectories) {
+            if (watchedChanges.watchedDirectories.count(directory) == 0)
+                return WatchState::Unknown;
+            if (watchedChanges.dirtyDirectories.count(directory) != 0)
+                state = WatchState::Dirty;
+        }
+        return state;
+    };
+
+    // Package matches of the previous discovery stay valid for rules none of whose packages changed since.
+    const uint64_t dbGeneration = pkgUtilManager_->getPackageDbGeneration();
+    std::set<std::string> changedPackages;
+    const bool packageChangesKnown = dbGeneration != 0 && ruleCacheDbGeneration_ != 0 &&
+        pkgUtilManager_->getChangedPackagesSince(ruleCacheDbGeneration_, changedPackages);
+
+    std::vector<std::string> ruleKeys(catalogRules.size());
+    std::vector<const RuleCacheEntry*> cachedEntries(catalogRules.size(), nullptr);
+    for (size_t i = 0; i < catalogRules.size(); ++i) {
+        ruleKeys[i] = RuleCacheKey(catalogRules[i]);
+        const auto cached = ruleCache_.find(ruleKeys[i]);
+        if (cached != ruleCache_.end()) {
+            cachedEntries[i] = &cached->second;
+        }
+    }
     
+    // 1. Match every rule against the installed packages. Each worker writes only its rule's slot.
+    std::vector<RuleMatch> matches(catalogRules.size());
+    std::vector<char> matchReused(catalogRules.size(), 0);
+    std::vector<size_t> pendingRules;
+    bool pendingNvraPatterns = false;
+    for (size_t i = 0; i < catalogRules.size(); ++i) {
+        if (packageChangesKnown && cachedEntries[i] && !IsRulePackageChanged(catalogRules[i], changedPackages)) {
+            matches[i] = cachedEntries[i]->match;
+            matchReused[i] = 1;
+        } else {
+            pendingRules.push_back(i);
+            pendingNvraPatterns = pendingNvraPatterns || HasNvraPattern(catalogRules[i]);
+        }
+    }
+
+    // Wildcard NVRA identifiers can only be matched against the listed packages.
+    std::vector<PackageInfo> installedPackages;
+    if ((pendingRules.size() >= kIndexedMatchMinRules || pendingNvraPatterns) &&
+        pkgUtilManager_->listInstalledPackages(installedPackages)) {
+        MatchInstalledPackages(catalogRules, pendingRules, installedPackages, matches);
+    } else {
+        util::ParallelForEach(pendingRules.size(), discoveryWorkers_, [&](size_t i) {
+            matches[pendingRules[i]] = FindInstalledPackage(catalogRules[pendingRules[i]]);
+        });
+    }
+
+    // 2. First match wins per product, in catalog order.
     std::set<std::string> uniquePks;
+    std::vector<size_t> winningRules;
+    for (size_t i = 0; i < catalogRules.size(); ++i) {
+        if (!matches[i].version.empty() && uniquePks.insert(catalogRules[i].product).second) {
+            winningRules.push_back(i);
+        }
+    }
+
+    // 3. Discover configurables of the winning rules only, reusing them while none of their inputs changed.
     PackageInventory packagesDiscovered;
+    packagesDiscovered.packages.resize(winningRules.size());
+    std::vector<RuleCacheEntry> winnerEntries(winningRules.size());
+    std::vector<char> configsReused(winningRules.size(), 0);
+    util::ParallelForEach(winningRules.size(), discoveryWorkers_, [&](size_t i) {
+        const auto& rule = catalogRules[winningRules[i]];
+        const auto& match = matches[winningRules[i]];
+        const RuleCacheEntry* cached = cachedEntries[winningRules[i]];
+        RuleCacheEntry& entry = winnerEntries[i];
 
-    for (const auto& rule : catalogRules) {
-        for (const auto& pkgRule : rule.pkgnvra_discovery) {
-            ProcessPackageDiscovery(rule, pkgRule.pkgId, PKG_ID_TYPE::NVRA, uniquePks, packagesDiscovered);
-        
+        // Watched rules are refreshed only when their directories saw events, others when a stamp changed.
+        // Either way a login or logout that changes the per-user search paths is a change.
+        std::vector<std::string> searchPaths = SearchPathsOf(rule.configurables);
+        if (cached && cached->searchPaths != searchPaths) {
+            cached = nullptr;
         }
-        for (const auto& pkgNameRule : rule.pkgname_discovery) {
-            ProcessPackageDiscovery(rule, pkgNameRule.name, PKG_ID_TYPE::NAME, uniquePks, packagesDiscovered);
+        const WatchState watchState = cached ? watchStateOf(*cached) : WatchState::Unknown;
+        if (cached && cached->configsValid && cached->watchVerified && watchState == WatchState::Clean) {
+            entry = *cached;
+            configsReused[i] = 1;
+        } else if (cached && cached->configsValid && watchState != WatchState::Dirty &&
+            std::all_of(cached->stamps.begin(), cached->stamps.end(), [](const PathStamp& stamp) { return IsStampCurrent(stamp); })) {
+            entry = *cached;
+            // Any change after this check is recorded by the watches that were already in place.
+            entry.watchVerified = watchState == WatchState::Clean;
+            configsReused[i] = 1;
+        } else {
+            // An event may be an in-place write that kept the size and modification time.
+            if (cached && watchState == WatchState::Dirty) {
+                for (const auto& config : cached->configs) {
+                    fingerprints_.Forget(config.isDiscoveredAtDeployPath ? config.deployPath : config.cfgPath);
+                }
+            }
+            entry.searchPaths = std::move(searchPaths);
+            entry.configsValid = StampConfigurableDependencies(rule.configurables, entry.stamps);
+            DiscoverPackageConfigurables(rule.configurables, entry.configs);
+            for (const auto& config : entry.configs) {
+                entry.stamps.push_back(StampPath(config.isDiscoveredAtDeployPath ? config.deployPath : config.cfgPath));
+            }
+            entry.watchDirectories = WatchDirectoriesOf(entry.stamps);
+            PM_LOG_INFO("Discovered package %s, version %s, found %d configurables", 
+                        match.pkgIdentifier.c_str(), match.version.c_str(), entry.configs.size());
         }
-    }
+        // Reused configurables are fingerprinted too, which keeps their digests cached; unchanged files cost a statx().
+        for (auto& config : entry.configs) {
+            config.sha256.clear();
+            (void)fingerprints_.Sha256(config.isDiscoveredAtDeployPath ? config.deployPath : config.cfgPath, config.sha256);
+        }
+        entry.match = match;
+        packagesDiscovered.packages[i] = {rule.product, match.version, entry.configs};
+    });
+    fingerprints_.DropUnused();
+
     packagesDiscovered.architecture = sArchForDiscovery;
     packagesDiscovered.platform = "linux";
 
-    lastDetectedPackages_ = packagesDiscovered;  
+    // Remember this discovery for the next one; rules that are no longer in the catalog are dropped.
+    std::unordered_map<std::string, RuleCacheEntry> ruleCache;
+    size_t reusedRuleResults = 0;
+    size_t winner = 0;
+    for (size_t i = 0; i < catalogRules.size(); ++i) {
+        const bool isWinner = winner < winningRules.size() && winningRules[winner] == i;
+        if (isWinner) {
+            reusedRuleResults += (matchReused[i] && configsReused[winner]) ? 1 : 0;
+            ruleCache[ruleKeys[i]] = std::move(winnerEntries[winner]);
+            ++winner;
+        } else {
+            reusedRuleResults += matchReused[i] ? 1 : 0;
+            RuleCacheEntry entry;
+            entry.match = matches[i];
+            ruleCache.emplace(ruleKeys[i], std::move(entry));
+        }
+    }
+    ruleCache_ = std::move(ruleCache);
+    ruleCacheDbGeneration_ = dbGeneration;
+    installedPackages_.clear();
+    for (const size_t i : winningRules) {
+        installedPackages_[catalogRules[i].product] = matches[i].pkgIdentifier;
+    }
+
+    if (watcher_) {
+        std::set<std::string> watchDirectories;
+        for (const auto& cached : ruleCache_) {
+            watchDirectories.insert(cached.second.watchDirectories.begin(), cached.second.watchDirectories.end());
+        }
+        watcher_->Watch(watchDirectories);
+    }
+
+    UpdateInventoryDelta(*std::atomic_load(&lastDetectedPackages_), packagesDiscovered, reusedRuleResults);
+
+    // Readers holding the previous inventory keep it alive until they release it.
+    std::atomic_store(&lastDetectedPackages_, std::make_shared<const PackageInventory>(packagesDiscovered));
+    discovered_ = true;
     return packagesDiscovered;
 }
 
-PackageInventory PmPlatformDiscovery::CachedInventory() const {
-    return lastDetectedPackages_;
+void PmPlatformDiscovery::UpdateInventoryDelta(const PackageInventory& previous, const PackageInventory& current, size_t reusedRuleResults) {
+    PackageInventoryDelta delta;
+    delta.complete = true;
+    delta.reusedRuleResults = reusedRuleResults;
+
+    std::unordered_map<std::string, const PmInstalledPackage*> previousPackages;
+    for (const auto& package : previous.packages) {
+        previousPackages.emplace(package.product, &package);
+    }
+    for (const auto& package : current.packages) {
+        const auto it = previousPackages.find(package.product);
+        if (it == previousPackages.end()) {
+            delta.addedProducts.push_back(package.product);
+            continue;
+        }
+        if (it->second->version != package.version || !SameConfigs(it->second->configs, package.configs)) {
+            delta.changedProducts.push_back(package.product);
+        }
+        previousPackages.erase(it);
+    }
+    for (const auto& package : previous.packages) {
+        if (previousPackages.count(package.product) != 0) {
+            delta.removedProducts.push_back(package.product);
+        }
+    }
+
+    delta.inventoryGeneration = std::atomic_load(&lastDelta_)->inventoryGeneration + (delta.IsEmpty() ? 0 : 1);
+    PM_LOG_INFO("Inventory generation %llu: %zu added, %zu removed, %zu changed, %zu rules reused",
+        static_cast<unsigned long long>(delta.inventoryGeneration), delta.addedProducts.size(),
+        delta.removedProducts.size(), delta.changedProducts.size(), delta.reusedRuleResults);
+    std::atomic_store(&lastDelta_, std::make_shared<const PackageInventoryDelta>(std::move(delta)));
+}
+
+std::shared_ptr<const PackageInventory> PmPlatformDiscovery::CachedInventory() const {
+    return std::atomic_load(&lastDetectedPackages_);
+}
+
+PackageInventoryDelta PmPlatformDiscovery::LastInventoryDelta() const {
+    return *std::atomic_load(&lastDelta_);
+}
+
+bool PmPlatformDiscovery::RestoreInventory(const PackageInventory& inventory, uint64_t inventoryGeneration) {
+    if (discovered_) {
+        return false;
+    }
+
+    // Products of the restored inventory were not compared against anything yet.
+    PackageInventoryDelta delta;
+    delta.inventoryGeneration = inventoryGeneration;
+    std::atomic_store(&lastDelta_, std::make_shared<const PackageInventoryDelta>(std::move(delta)));
+    std::atomic_store(&lastDetectedPackages_, std::make_shared<const PackageInventory>(inventory));
+    return true;
+}
+
+std::string PmPlatformDiscovery::InstalledPackageOf(const std::string& product) const {
+    const auto installed = installedPackages_.find(product);
+    return installed == installedPackages_.end() ? std::string() : installed->second;
+}
+
+void PmPlatformDiscovery::RemoveProducts(const std::set<std::string>& products) {
+    // Rules that matched a removed package must be matched again by the next discovery.
+    std::set<std::string> removedPackages;
+    for (const auto& product : products) {
+        const auto installed = installedPackages_.find(product);
+        if (installed != installedPackages_.end()) {
+            removedPackages.insert(installed->second);
+            installedPackages_.erase(installed);
+        }
+    }
+    for (auto cached = ruleCache_.begin(); cached != ruleCache_.end();) {
+        cached = removedPackages.count(cached->second.match.pkgIdentifier) != 0 ? ruleCache_.erase(cached) : std::next(cached);
+    }
+
+    const auto previous = std::atomic_load(&lastDetectedPackages_);
+    PackageInventory inventory = *previous;
+    inventory.packages.erase(std::remove_if(inventory.packages.begin(), inventory.packages.end(),
+        [&products](const PmInstalledPackage& package) { return products.count(package.product) != 0; }), inventory.packages.end());
+    UpdateInventoryDelta(*previous, inventory, 0);
+    std::atomic_store(&lastDetectedPackages_, std::make_shared<const PackageInventory>(std::move(inventory)));
+}
+
+bool PmPlatformDiscovery::WatchConfigurables(std::chrono::milliseconds debounce, std::function<void()> onChange) {
+    watcher_ = std::make_unique<ConfigurableWatcher>(debounce, std::move(onChange));
+    if (!watcher_->IsWatching()) {
+        watcher_.reset();
+        return false;
+    }
+    return true;
+}
+
+void PmPlatformDiscovery::MuteConfigurableChanges(const std::string& directory) {
+    if (watcher_) {
+        watcher_->Mute(directory);
+    }
+}
+
+void PmPlatformDiscovery::UnmuteConfigurableChanges(const std::string& directory) {
+    if (watcher_) {
+        watcher_->Unmute(directory);
+    }
 }
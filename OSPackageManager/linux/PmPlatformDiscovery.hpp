@@ -3,7 +3,14 @@
 #include "IPackageUtil.hpp"
 #include "IPmPlatformDiscovery.hpp"
 #include "IFileUtilities.hpp"
+#include "FileFingerprintCache.hpp"
+#include "ConfigurableWatcher.hpp"
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <set>
+#include <unordered_map>
+#include <sys/types.h>
 
 /**
  * @brief A class that performs platform discovery by utilizing the package manager utility.
@@ -11,47 +18,217 @@
  */
 class PmPlatformDiscovery : public IPmPlatformDiscovery {
 public:
-        /**
+    /**
+     * @brief Default number of workers evaluating catalog rules. Rule evaluation waits on package manager
+     *        queries and file system globbing rather than CPU, so this does not scale with the core count.
+     */
+    static constexpr size_t kDefaultDiscoveryWorkers = 8;
+
+    /**
+     * @brief Number of rules to look up from which listing every installed package once and matching the
+     *        rules against an index is cheaper than querying each rule's packages.
+     */
+    static constexpr size_t kIndexedMatchMinRules = 8;
+
+    /**
      * @brief Constructs a PmPlatformDiscovery object with the specified IPmPkgUtil instance.
      * @param pkgUtil The IPmPkgUtil instance to use for package management operations.
      * @param fileUtils The IFileUtilities instance to use for file operations. 
+     * @param discoveryWorkers The number of threads evaluating catalog rules, 1 evaluates them sequentially.
      */
-    PmPlatformDiscovery(std::shared_ptr<IPackageUtil> pkgUtil, std::shared_ptr<PackageManager::IFileUtilities> fileUtils) : pkgUtilManager_(std::move(pkgUtil)), fileUtils_(std::move(fileUtils)) {}
+    PmPlatformDiscovery(
+        std::shared_ptr<IPackageUtil> pkgUtil,
+        std::shared_ptr<PackageManager::IFileUtilities> fileUtils,
+        size_t discoveryWorkers = kDefaultDiscoveryWorkers) :
+        pkgUtilManager_(std::move(pkgUtil)), fileUtils_(std::move(fileUtils)), discoveryWorkers_(discoveryWorkers) {}
     
     /**
      * @brief Discovers the installed packages based on the provided catalog rules.
      * @param catalogRules The catalog rules to use for package discovery.
      * @return The inventory of discovered packages.
+     * @note Rules are evaluated concurrently. The result is the same as evaluating them in catalog order:
+     *       the first matching rule of a product wins and packages are listed in catalog order.
      */
     PackageInventory DiscoverInstalledPackages(const std::vector<PmProductDiscoveryRules>& catalogRules) override;
     
     /**
      * @brief Returns installed packages inventory from a cache
-     * @return The inventory of discovered packages.
+     * @return The inventory of discovered packages, shared without copying.
+     */
+    std::shared_ptr<const PackageInventory> CachedInventory() const override;
+
+    /**
+     * @brief Returns the difference between the last inventory and the one before it.
+     */
+    PackageInventoryDelta LastInventoryDelta() const override;
+
+    /**
+     * @brief Publishes an inventory persisted by a previous run as the cached inventory, until the first discovery
+     *        replaces it. Ignored once a discovery has run.
+     * @param inventoryGeneration The generation the inventory was published at; later generations continue from it.
+     * @return False if a discovery already published an inventory.
      */
-    PackageInventory CachedInventory() const override;
+    bool RestoreInventory(const PackageInventory& inventory, uint64_t inventoryGeneration);
+
+    /**
+     * @brief Watches the directories of the discovered configurables from the next discovery on. Rules whose
+     *        directories saw no change are then reused without re-stamping their inputs.
+     * @param debounce How long the directories have to be quiet before onChange runs.
+     * @param onChange Called on the watcher thread after a burst of configurable changes, may be empty.
+     * @return False if the directories cannot be watched.
+     * @note Call before discovery runs concurrently.
+     */
+    bool WatchConfigurables(std::chrono::milliseconds debounce, std::function<void()> onChange);
+
+    /**
+     * @brief Keeps changes the package manager makes itself in a directory, or anywhere if it is empty, from
+     *        running the change handler; they are still rediscovered. See ConfigurableWatcher::Mute().
+     */
+    void MuteConfigurableChanges(const std::string& directory);
+
+    /**
+     * @brief Ends a MuteConfigurableChanges().
+     */
+    void UnmuteConfigurableChanges(const std::string& directory);
+
+    /**
+     * @brief The package the last discovery found installed for a product, as named by the catalog rule that matched.
+     * @return Empty if the product was not found installed, or if no discovery ran yet.
+     */
+    std::string InstalledPackageOf(const std::string& product) const;
+
+    /**
+     * @brief Publishes the cached inventory without the given products, as a new inventory generation, and forgets
+     *        what the last discovery matched for them. Does not touch the package database.
+     * @note Not safe to call concurrently with a discovery.
+     */
+    void RemoveProducts(const std::set<std::string>& products);
 
 protected:
+    /**
+     * @brief Searches a configurable path at each of its search paths, stopping at maxInstances existing files per search path.
+     * @param out_unresolvedFiles Receives each discovered file with its known folder replaced by the <FOLDERID_xxx> token.
+     */
     void ResolveAndDiscover(
         const std::filesystem::path& unresolvedPath,
         const std::filesystem::path& resolvedPath,
-        std::string& out_knownFolderId,
-        std::string& out_knownFolderIdConversion,
-        std::vector<std::filesystem::path>& out_discoveredFiles );
+        size_t maxInstances,
+        std::vector<std::filesystem::path>& out_discoveredFiles,
+        std::vector<std::string>& out_unresolvedFiles );
 
     void DiscoverPackageConfigurables(
         const std::vector<PmProductDiscoveryConfigurable>& configurables,
         std::vector<PackageConfigInfo>& packageConfigs );
 
 private:
-    void ProcessPackageDiscovery(
-        const PmProductDiscoveryRules& rule,
-        const std::string& pkgIdentifier,
-        PKG_ID_TYPE pkgType,
-        std::set<std::string>& uniquePks,
-        PackageInventory& packagesDiscovered);
+    /**
+     * @brief Result of matching one catalog rule against the installed packages.
+     */
+    struct RuleMatch {
+        std::string pkgIdentifier; /**< The first identifier of the rule that is installed, empty if none is. */
+        std::string version;
+    };
+
+    /**
+     * @brief Identity of a file system entry a discovery result depended on.
+     */
+    struct PathStamp {
+        std::string path;
+        bool exists = false;
+        bool isDirectory = false;
+        dev_t device = 0;
+        ino_t inode = 0;
+        int64_t mtimeNs = 0;
+    };
+
+    /**
+     * @brief What a catalog rule resolved to in the previous discovery, and the inputs that result depended on.
+     *        A rule's package match is reused while none of its packages changed in the package database,
+     *        its configurables while none of the stamped directories and files changed.
+     */
+    struct RuleCacheEntry {
+        RuleMatch match;
+        bool configsValid = false;
+        std::vector<PackageConfigInfo> configs;
+        std::vector<PathStamp> stamps;
+        std::vector<std::string> searchPaths; /**< Per-user paths depend on who is logged in, the result is reused only for the same users. */
+        std::vector<std::string> watchDirectories; /**< Directories whose events cover every stamp, empty if some cannot be watched. */
+        bool watchVerified = false; /**< The stamps were verified while their directories were watched. */
+    };
+
+    /**
+     * @brief Looks up the rule's NVRA identifiers, then its package names, and stops at the first installed one.
+     */
+    RuleMatch FindInstalledPackage(const PmProductDiscoveryRules& rule);
+
+    /**
+     * @brief Same result as FindInstalledPackage() for each of the given rules, in one pass over the installed packages.
+     *        The rules are indexed by exact NVRA and package name; NVRA identifiers containing wildcards are
+     *        matched with fnmatch() against every installed NVRA.
+     * @param matches Receives the result of rule i in matches[i], other slots are not touched.
+     */
+    void MatchInstalledPackages(
+        const std::vector<PmProductDiscoveryRules>& catalogRules,
+        const std::vector<size_t>& ruleIndexes,
+        const std::vector<PackageInfo>& installedPackages,
+        std::vector<RuleMatch>& matches );
+
+    /**
+     * @brief Stamps the directories the configurable globs walk through, so that a later discovery can tell
+     *        whether the glob results may have changed.
+     * @return False if the dependencies cannot be captured (recursive wildcards), the result is then never reused.
+     */
+    bool StampConfigurableDependencies(
+        const std::vector<PmProductDiscoveryConfigurable>& configurables,
+        std::vector<PathStamp>& stamps );
+
+    /**
+     * @brief The paths a configurable path is searched at: one per logged-in user if it lies under a per-user
+     *        known folder, otherwise the resolved path alone.
+     */
+    std::vector<std::filesystem::path> SearchPathsOf(const std::filesystem::path& unresolvedPath, const std::filesystem::path& resolvedPath);
+
+    /**
+     * @brief The search paths of every deploy and config path of the configurables, in order.
+     */
+    std::vector<std::string> SearchPathsOf(const std::vector<PmProductDiscoveryConfigurable>& configurables);
+
+    /**
+     * @brief Searches through the directory snapshot of the current pass, if the file utilities provide one.
+     */
+    int32_t FileSearchWithWildCard(const std::filesystem::path& searchPath, std::vector<std::filesystem::path>& results);
+
+    /**
+     * @brief Same as FileSearchWithWildCard() for FindWildCardMatches().
+     */
+    int32_t FindWildCardMatches(const std::filesystem::path& searchPath, size_t maxResults, std::vector<std::filesystem::path>& results);
+
+    static PathStamp StampPath(const std::filesystem::path& path);
+    static bool IsStampCurrent(const PathStamp& stamp);
+
+    /**
+     * @brief Directories to watch for changes to the stamped paths: stamped directories themselves and the parents
+     *        of stamped files. Empty if a stamped path does not exist, its creation could go unnoticed.
+     */
+    static std::vector<std::string> WatchDirectoriesOf(const std::vector<PathStamp>& stamps);
+
+    /**
+     * @brief Updates the inventory delta from the previous and the new inventory.
+     */
+    void UpdateInventoryDelta(const PackageInventory& previous, const PackageInventory& current, size_t reusedRuleResults);
+
     std::shared_ptr<IPackageUtil> pkgUtilManager_; /**< The IPackageUtil instance for package management operations. */
     std::shared_ptr<PackageManager::IFileUtilities> fileUtils_;
-    PackageInventory lastDetectedPackages_ {};
+    size_t discoveryWorkers_;
+    std::shared_ptr<const PackageInventory> lastDetectedPackages_ = std::make_shared<const PackageInventory>(); /**< Only accessed with std::atomic_load/std::atomic_store. */
+    std::unordered_map<std::string, RuleCacheEntry> ruleCache_; /**< Keyed on the rule contents, see RuleCacheKey(). */
+    std::unordered_map<std::string, std::string> installedPackages_; /**< Product to the identifier its winning rule matched. */
+    uint64_t ruleCacheDbGeneration_ = 0; /**< Package database generation the cached matches were made at. */
+    std::shared_ptr<const PackageInventoryDelta> lastDelta_ = std::make_shared<const PackageInventoryDelta>(); /**< Only accessed with std::atomic_load/std::atomic_store. */
+    std::unique_ptr<PackageManager::IDirectorySnapshot> directorySnapshot_; /**< Only set during a discovery pass. */
+    int64_t passStartNs_ = 0;
+    std::unique_ptr<ConfigurableWatcher> watcher_;
+    FileFingerprintCache fingerprints_; /**< Digests of the discovered configurables, see PackageConfigInfo::sha256. */
+    std::atomic<bool> discovered_{false}; /**< Set by the first discovery, restored inventories are ignored from then on. */
 };
 
@@ -82,7 +82,7 @@ int32_t PmPlatformComponentManager::GetInstalledPackages(const std::vector<PmPro
 
 int32_t PmPlatformComponentManager::GetCachedInventory(PackageInventory &cachedInventory)
 {
-    cachedInventory = discovery_.CachedInventory();
+    cachedInventory = *discovery_.CachedInventory();
     return 0;
 }
 
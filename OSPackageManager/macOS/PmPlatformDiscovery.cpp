@@ -195,11 +195,12 @@ PackageInventory PmPlatformDiscovery::DiscoverInstalledPackages( const std::vect
     packagesDiscovered.architecture = sArchForDiscovery;
     packagesDiscovered.platform = "darwin";
 
-    lastDetectedPackages_ = packagesDiscovered;
+    // Readers holding the previous inventory keep it alive until they release it.
+    std::atomic_store(&lastDetectedPackages_, std::make_shared<const PackageInventory>(packagesDiscovered));
     
     return packagesDiscovered;
 }
 
-PackageInventory PmPlatformDiscovery::CachedInventory() const {
-    return lastDetectedPackages_;
+std::shared_ptr<const PackageInventory> PmPlatformDiscovery::CachedInventory() const {
+    return std::atomic_load(&lastDetectedPackages_);
 }
@@ -26,9 +26,9 @@ public:
     
     /**
      * @brief Returns installed packages inventory from a cache
-     * @return The inventory of discovered packages.
+     * @return The inventory of discovered packages, shared without copying.
      */
-    PackageInventory CachedInventory() const override;
+    std::shared_ptr<const PackageInventory> CachedInventory() const override;
     
 protected:
     void ResolveAndDiscover(
@@ -45,6 +45,6 @@ protected:
 private:
     std::shared_ptr<IPmPkgUtil> pkgUtilManager_; /**< The IPmPkgUtil instance for package management operations. */
     std::shared_ptr<PackageManager::IFileUtilities> fileUtils_;
-    PackageInventory lastDetectedPackages_;
+    std::shared_ptr<const PackageInventory> lastDetectedPackages_ = std::make_shared<const PackageInventory>(); /**< Only accessed with std::atomic_load/std::atomic_store. */
 };
 
@@ -0,0 +1,48 @@
+/**
+* @file
+*
+* @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+*/
+
+#include "gtest/gtest.h"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "OSPackageManager/linux/AtomicFileWriter.hpp"
+#include "OSPackageManager/common/PmLogger.hpp"
+
+TEST(AtomicFileWriterTest, replacesFilesWholeAndLeavesNoTemporaryFiles)
+{
+   const auto root = std::filesystem::temp_directory_path() / ("pm-atomic-" + std::to_string(getpid()));
+   std::filesystem::remove_all(root);
+   std::filesystem::create_directories(root);
+   using PackageManager::AtomicFileWriter;
+
+   ASSERT_TRUE(AtomicFileWriter::Write(root / "state.json", "first", {}));
+   ASSERT_TRUE(AtomicFileWriter::Write(root / "state.json", "second", {}));
+   std::string contents;
+   std::getline(std::ifstream(root / "state.json"), contents);
+   EXPECT_EQ(contents, "second");
+   struct stat written {};
+   ASSERT_EQ(stat((root / "state.json").c_str(), &written), 0);
+   EXPECT_EQ(written.st_mode & 07777, 0600u);
+
+   // A file that must not be replaced keeps its contents.
+   AtomicFileWriter::Options noReplace;
+   noReplace.replace = false;
+   EXPECT_FALSE(AtomicFileWriter::Write(root / "state.json", "third", noReplace));
+   std::getline(std::ifstream(root / "state.json"), contents);
+   EXPECT_EQ(contents, "second");
+   EXPECT_FALSE(AtomicFileWriter::Write(root / "missing" / "state.json", "third", {}));
+   EXPECT_EQ(std::distance(std::filesystem::directory_iterator(root), std::filesystem::directory_iterator()), 1);
+   std::filesystem::remove_all(root);
+}
+
+int main(int argc, char **argv) {
+   PmLogger::initLogger();
+   testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
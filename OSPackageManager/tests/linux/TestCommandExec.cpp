@@ -0,0 +1,51 @@
+/**
+* @file
+*
+* @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+*/
+
+#include "gtest/gtest.h"
+#include <chrono>
+#include <string>
+#include "OSPackageManager/common/CommandExec.hpp"
+#include "OSPackageManager/common/PmLogger.hpp"
+
+TEST(CommandExecTest, capturesStdoutAloneOrWithStderr)
+{
+   CommandExec commandExec;
+   int exitCode = -1;
+   std::string output;
+   ASSERT_EQ(commandExec.ExecuteCommandCaptureOutput("/bin/sh", { "sh", "-c", "echo out; echo err 1>&2; exit 3" }, exitCode, output), 0);
+   EXPECT_EQ(exitCode, 3);
+   EXPECT_EQ(output, "out\n");
+
+   ASSERT_EQ(commandExec.ExecuteCommandCaptureCombinedOutput("/bin/sh", { "sh", "-c", "echo out; echo err 1>&2; exit 4" }, exitCode, output), 0);
+   EXPECT_EQ(exitCode, 4);
+   EXPECT_EQ(output, "out\nerr\n");
+
+   // More than a pipe holds does not stall the child.
+   ASSERT_EQ(commandExec.ExecuteCommandCaptureOutput("/bin/sh", { "sh", "-c", "head -c 200000 /dev/zero" }, exitCode, output), 0);
+   EXPECT_EQ(exitCode, 0);
+   EXPECT_EQ(output.size(), 200000u);
+
+   EXPECT_EQ(commandExec.ExecuteCommandCaptureOutput("sh", { "sh" }, exitCode, output), -1);
+}
+
+TEST(CommandExecTest, returnsOnceTheChildExitsWhileItsDaemonHoldsStdout)
+{
+   // Like a maintainer script starting a service that inherits its stdout.
+   CommandExec commandExec;
+   int exitCode = -1;
+   std::string output;
+   const auto start = std::chrono::steady_clock::now();
+   ASSERT_EQ(commandExec.ExecuteCommandCaptureCombinedOutput("/bin/sh", { "sh", "-c", "echo started; sleep 5 & exit 0" }, exitCode, output), 0);
+   EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(3));
+   EXPECT_EQ(exitCode, 0);
+   EXPECT_EQ(output, "started\n");
+}
+
+int main(int argc, char **argv) {
+   PmLogger::initLogger();
+   testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
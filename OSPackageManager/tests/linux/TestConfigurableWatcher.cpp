@@ -0,0 +1,96 @@
+/**
+* @file
+*
+* @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+*/
+
+#include "gtest/gtest.h"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <unistd.h>
+#include <unordered_set>
+#include "OSPackageManager/linux/ConfigurableWatcher.hpp"
+#include "OSPackageManager/common/PmLogger.hpp"
+
+TEST(ConfigurableWatcherTest, coalescesChangesInWatchedDirectories)
+{
+   const auto root = std::filesystem::temp_directory_path() / ("pm-watch-" + std::to_string(getpid()));
+   std::filesystem::remove_all(root);
+   std::filesystem::create_directories(root / "watched");
+   std::filesystem::create_directories(root / "other");
+
+   std::atomic<int> notifications{ 0 };
+   ConfigurableWatcher watcher(std::chrono::milliseconds(100), [&notifications]() { ++notifications; });
+   ASSERT_TRUE(watcher.IsWatching());
+   watcher.Watch({ (root / "watched").string(), (root / "missing").string() });
+
+   auto changes = watcher.TakeChanges();
+   EXPECT_TRUE(changes.complete);
+   EXPECT_TRUE(changes.dirtyDirectories.empty());
+   EXPECT_EQ(changes.watchedDirectories, (std::unordered_set<std::string>{ (root / "watched").string() }));
+
+   // A burst of writes notifies once, after the directory has been quiet for the debounce window.
+   for (int i = 0; i < 5; ++i) {
+      std::ofstream(root / "watched" / ("profile" + std::to_string(i) + ".xml")) << "<p/>";
+      std::ofstream(root / "other" / "ignored.xml") << "<p/>";
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+   }
+   EXPECT_EQ(notifications, 0);
+   std::this_thread::sleep_for(std::chrono::milliseconds(500));
+   EXPECT_EQ(notifications, 1);
+
+   changes = watcher.TakeChanges();
+   EXPECT_EQ(changes.dirtyDirectories, (std::unordered_set<std::string>{ (root / "watched").string() }));
+   EXPECT_TRUE(watcher.TakeChanges().dirtyDirectories.empty());
+
+   // Unwatched directories are not reported, removed ones drop out of the watched set.
+   watcher.Watch({});
+   std::ofstream(root / "watched" / "late.xml") << "<p/>";
+   changes = watcher.TakeChanges();
+   EXPECT_TRUE(changes.dirtyDirectories.empty());
+   EXPECT_TRUE(changes.watchedDirectories.empty());
+
+   std::filesystem::remove_all(root);
+}
+
+TEST(ConfigurableWatcherTest, mutedChangesAreRecordedWithoutNotifying)
+{
+   const auto root = std::filesystem::temp_directory_path() / ("pm-watch-muted-" + std::to_string(getpid()));
+   std::filesystem::remove_all(root);
+   std::filesystem::create_directories(root / "deployed");
+   std::filesystem::create_directories(root / "other");
+
+   std::atomic<int> notifications{ 0 };
+   ConfigurableWatcher watcher(std::chrono::milliseconds(50), [&notifications]() { ++notifications; });
+   ASSERT_TRUE(watcher.IsWatching());
+   watcher.Watch({ (root / "deployed").string(), (root / "other").string() });
+
+   watcher.Mute((root / "deployed").string());
+   std::ofstream(root / "deployed" / "profile.xml") << "<p/>";
+   watcher.Unmute((root / "deployed").string());
+   watcher.Mute({});
+   std::ofstream(root / "other" / "profile.xml") << "<p/>";
+   watcher.Unmute({});
+   std::this_thread::sleep_for(std::chrono::milliseconds(300));
+   EXPECT_EQ(notifications, 0);
+   EXPECT_EQ(watcher.TakeChanges().dirtyDirectories,
+      (std::unordered_set<std::string>{ (root / "deployed").string(), (root / "other").string() }));
+
+   // Only the muted directory is muted.
+   watcher.Mute((root / "deployed").string());
+   std::ofstream(root / "other" / "profile.xml") << "<q/>";
+   std::this_thread::sleep_for(std::chrono::milliseconds(300));
+   watcher.Unmute((root / "deployed").string());
+   EXPECT_EQ(notifications, 1);
+
+   std::filesystem::remove_all(root);
+}
+
+int main(int argc, char **argv) {
+   PmLogger::initLogger();
+   testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,102 @@
+/**
+* @file
+*
+* @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+*/
+
+#include "gtest/gtest.h"
+#include <filesystem>
+#include <fstream>
+#include <glob.h>
+#include <unistd.h>
+#include <vector>
+#include "OSPackageManager/linux/DirectorySnapshot.hpp"
+#include "OSPackageManager/common/PmLogger.hpp"
+
+TEST(DirectorySnapshotTest, matchesGlobAndListsEachDirectoryOnce)
+{
+   const auto root = std::filesystem::temp_directory_path() / ("pm-snapshot-" + std::to_string(getpid()));
+   std::filesystem::remove_all(root);
+   for (const std::string product : { "vpn", "umbrella", "nvm", ".hidden" }) {
+      std::filesystem::create_directories(root / product / "profiles");
+      std::ofstream(root / product / "profiles" / "a.xml") << "<a/>";
+      std::ofstream(root / product / "profiles" / "b.json") << "{}";
+      std::ofstream(root / product / "profiles" / ".c.xml") << "<c/>";
+      std::ofstream(root / product / "settings.json") << "{}";
+   }
+   std::filesystem::create_directory_symlink(root / "vpn", root / "vpn-link");
+   std::filesystem::create_symlink(root / "missing", root / "umbrella" / "profiles" / "dangling.xml");
+
+   const std::vector<std::string> patterns{
+      "*/profiles/*.xml", "*/profiles/*", "*/settings.json", "v*/profiles/[ab].*", "nvm/profiles/a.xml",
+      ".*/profiles/*.xml", "*/profiles/.c*", "*/missing/*", "umbrella/profiles/dangling.xml", "*", "*/*"
+   };
+
+   PackageManager::DirectorySnapshot snapshot;
+   for (const auto& pattern : patterns) {
+      const std::string fullPattern = (root / pattern).generic_u8string();
+      std::vector<std::filesystem::path> expected;
+      glob_t matches = {};
+      const int expectedRet = glob(fullPattern.c_str(), 0, nullptr, &matches);
+      if (expectedRet == 0) {
+         expected.assign(matches.gl_pathv, matches.gl_pathv + matches.gl_pathc);
+      }
+      globfree(&matches);
+
+      std::vector<std::filesystem::path> results;
+      EXPECT_EQ(snapshot.FileSearchWithWildCard(fullPattern, results), expectedRet) << pattern;
+      EXPECT_EQ(results, expected) << pattern;
+   }
+
+   // The root, its five product directories and their profiles directories; each listed once across all patterns.
+   EXPECT_EQ(snapshot.DirectoriesRead(), 10u);
+   std::filesystem::remove_all(root);
+}
+
+TEST(DirectorySnapshotTest, streamsExistingMatchesUpToTheLimit)
+{
+   const auto root = std::filesystem::temp_directory_path() / ("pm-stream-" + std::to_string(getpid()));
+   std::filesystem::remove_all(root);
+   for (const std::string product : { "amp", "nvm", "vpn", ".hidden" }) {
+      std::filesystem::create_directories(root / product / "profiles" / "user");
+      std::ofstream(root / product / "profiles" / "a.json") << "{}";
+      std::ofstream(root / product / "profiles" / "user" / "b.json") << "{}";
+   }
+   std::filesystem::create_symlink(root / "missing", root / "amp" / "profiles" / "0-dangling.json");
+   std::filesystem::create_directory_symlink(root, root / "vpn" / "loop");
+   auto find = [&root](PackageManager::DirectorySnapshot& snapshot, const std::string& pattern, size_t maxResults) {
+      std::vector<std::filesystem::path> results;
+      (void)snapshot.FindWildCardMatches(root / pattern, maxResults, results);
+      std::vector<std::string> relative;
+      for (const auto& result : results) {
+         relative.push_back(result.lexically_relative(root).generic_u8string());
+      }
+      return relative;
+   };
+
+   // Dangling links are left out, and walking stops at the limit: only the root and amp/profiles are listed.
+   PackageManager::DirectorySnapshot limited;
+   EXPECT_EQ(find(limited, "*/profiles/*.json", 1), (std::vector<std::string>{ "amp/profiles/a.json" }));
+   EXPECT_EQ(limited.DirectoriesRead(), 2u);
+
+   PackageManager::DirectorySnapshot snapshot;
+   EXPECT_EQ(find(snapshot, "*/profiles/*.json", 0),
+      (std::vector<std::string>{ "amp/profiles/a.json", "nvm/profiles/a.json", "vpn/profiles/a.json" }));
+   EXPECT_EQ(find(snapshot, "**/b.json", 0),
+      (std::vector<std::string>{ "amp/profiles/user/b.json", "nvm/profiles/user/b.json", "vpn/profiles/user/b.json" }));
+   EXPECT_EQ(find(snapshot, "nvm/**/**/*.json", 0),
+      (std::vector<std::string>{ "nvm/profiles/a.json", "nvm/profiles/user/b.json" }));
+   EXPECT_EQ(find(snapshot, "amp/**", 0),
+      (std::vector<std::string>{ "amp/profiles", "amp/profiles/a.json", "amp/profiles/user", "amp/profiles/user/b.json" }));
+   EXPECT_EQ(find(snapshot, "**/user/b.json", 2),
+      (std::vector<std::string>{ "amp/profiles/user/b.json", "nvm/profiles/user/b.json" }));
+   EXPECT_TRUE(find(snapshot, "*/missing/**", 0).empty());
+
+   std::filesystem::remove_all(root);
+}
+
+int main(int argc, char **argv) {
+   PmLogger::initLogger();
+   testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,64 @@
+/**
+* @file
+*
+* @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+*/
+
+#include "gtest/gtest.h"
+#include <filesystem>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "OSPackageManager/linux/FileFingerprintCache.hpp"
+#include "OSPackageManager/common/PmLogger.hpp"
+
+namespace
+{
+// Backdates a path so that the cache does not consider its mtime too recent to trust.
+void backdate(const std::filesystem::path& path, time_t seconds)
+{
+   struct timespec times[2] = {};
+   times[0].tv_sec = times[1].tv_sec = time(nullptr) - seconds;
+   ASSERT_EQ(utimensat(AT_FDCWD, path.c_str(), times, 0), 0);
+}
+}
+
+TEST(FileFingerprintCacheTest, hashesOnlyChangedFiles)
+{
+   const auto file = std::filesystem::temp_directory_path() / ("pm-fingerprint-" + std::to_string(getpid()));
+   std::ofstream(file) << "{}";
+   backdate(file, 60);
+
+   FileFingerprintCache cache;
+   std::string first;
+   std::string second;
+   ASSERT_TRUE(cache.Sha256(file, first));
+   ASSERT_TRUE(cache.Sha256(file, second));
+   EXPECT_EQ(first, second);
+   EXPECT_EQ(cache.DigestsComputed(), 1u);
+
+   // Same size, different contents and modification time.
+   std::ofstream(file) << "[]";
+   backdate(file, 30);
+   ASSERT_TRUE(cache.Sha256(file, second));
+   EXPECT_NE(first, second);
+   EXPECT_EQ(cache.DigestsComputed(), 2u);
+
+   // Files written within the racy window are hashed on every lookup.
+   std::ofstream(file) << "{}";
+   ASSERT_TRUE(cache.Sha256(file, second));
+   ASSERT_TRUE(cache.Sha256(file, second));
+   EXPECT_EQ(second, first);
+   EXPECT_EQ(cache.DigestsComputed(), 4u);
+
+   std::filesystem::remove(file);
+   EXPECT_FALSE(cache.Sha256(file, second));
+   EXPECT_FALSE(cache.Sha256(std::filesystem::temp_directory_path(), second));
+}
+
+int main(int argc, char **argv) {
+   PmLogger::initLogger();
+   testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,59 @@
+/**
+* @file
+*
+* @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+*/
+
+#include "gtest/gtest.h"
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include "OSPackageManager/linux/InstallJournal.hpp"
+#include "OSPackageManager/common/PmLogger.hpp"
+
+TEST(InstallJournalTest, recoversTheLastRecordOfEachComponent)
+{
+   const auto file = std::filesystem::temp_directory_path() / ("pm-install-journal-" + std::to_string(getpid()));
+   std::filesystem::remove(file);
+   {
+      InstallJournal journal(file);
+      EXPECT_EQ(journal.RecoveredEntries(), 0u);
+      ASSERT_TRUE(journal.Record("amp/1.0", "ABCDEF", InstallJournal::Phase::Started));
+      ASSERT_TRUE(journal.Record("amp/1.0", "ABCDEF", InstallJournal::Phase::Verified));
+      ASSERT_TRUE(journal.Record("amp/1.0", "ABCDEF", InstallJournal::Phase::Finished, 0));
+      ASSERT_TRUE(journal.Record("uc/2.0", "", InstallJournal::Phase::Verified));
+   }
+   // A record with a damaged checksum, and one torn by a crash.
+   std::ofstream(file, std::ios::app) << "0000000000000000\tfinished\t0\t\tuc/2.0\n" << "0123";
+
+   InstallJournal journal(file);
+   EXPECT_EQ(journal.RecoveredEntries(), 2u);
+   InstallJournal::Entry entry;
+   ASSERT_TRUE(journal.Recovered("amp/1.0", entry));
+   EXPECT_EQ(entry.phase, InstallJournal::Phase::Finished);
+   EXPECT_EQ(entry.result, 0);
+   EXPECT_EQ(entry.digest, "abcdef");
+   ASSERT_TRUE(journal.Recovered("uc/2.0", entry));
+   EXPECT_EQ(entry.phase, InstallJournal::Phase::Verified);
+   EXPECT_TRUE(entry.digest.empty());
+   EXPECT_FALSE(journal.Recovered("orbital/1.0", entry));
+
+   journal.Forget("amp");
+   EXPECT_FALSE(journal.Recovered("amp/1.0", entry));
+   // Compacting keeps only what was recovered and not forgotten; records still append afterwards.
+   ASSERT_TRUE(journal.Record("orbital/1.0", "", InstallJournal::Phase::Finished, 0));
+   ASSERT_TRUE(journal.Compact());
+   ASSERT_TRUE(journal.Record("cloud/3.0", "", InstallJournal::Phase::Started));
+   InstallJournal compacted(file);
+   EXPECT_EQ(compacted.RecoveredEntries(), 2u);
+   EXPECT_TRUE(compacted.Recovered("uc/2.0", entry));
+   EXPECT_TRUE(compacted.Recovered("cloud/3.0", entry));
+   std::filesystem::remove(file);
+}
+
+int main(int argc, char **argv) {
+   PmLogger::initLogger();
+   testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
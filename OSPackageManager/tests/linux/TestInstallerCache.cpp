@@ -0,0 +1,98 @@
+/**
+* @file
+*
+* @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+*/
+
+#include "gtest/gtest.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "OSPackageManager/linux/InstallerCache.hpp"
+#include "OSPackageManager/common/PmLogger.hpp"
+
+class InstallerCacheTest : public ::testing::Test
+{
+protected:
+   void SetUp() override
+   {
+      directory_ = std::filesystem::temp_directory_path() / ("pm-installer-cache-" + std::to_string(getpid()));
+      installerA_ = std::filesystem::temp_directory_path() / ("pm-installer-a-" + std::to_string(getpid()));
+      installerB_ = std::filesystem::temp_directory_path() / ("pm-installer-b-" + std::to_string(getpid()));
+      std::filesystem::remove_all(directory_);
+      std::ofstream(installerA_) << "installer-a";
+      std::ofstream(installerB_) << "installer-b";
+   }
+   void TearDown() override
+   {
+      std::filesystem::remove_all(directory_);
+      std::filesystem::remove(installerA_);
+      std::filesystem::remove(installerB_);
+   }
+
+   std::filesystem::path directory_;
+   std::filesystem::path installerA_;
+   std::filesystem::path installerB_;
+   const std::string digestA_{ "02a196424f0e31244c5381a9d8cd77f3c9207cf3d9ec09a2ab032de4bf2051a8" };
+   const std::string digestB_{ "c09a3a745f8026dc1c7b36926c156f2578e60e32569c3cd7077f72c00c02890b" };
+};
+
+TEST_F(InstallerCacheTest, linksInstallersInUnderTheirDigest)
+{
+   InstallerCache cache(directory_, std::chrono::hours(1), 0);
+   EXPECT_FALSE(cache.Add(installerA_, digestB_));
+   EXPECT_FALSE(cache.Add(installerA_, "not-a-digest"));
+   ASSERT_TRUE(cache.Add(installerA_, "02A196424F0E31244C5381A9D8CD77F3C9207CF3D9EC09A2AB032DE4BF2051A8"));
+   ASSERT_TRUE(cache.Add(installerA_, digestA_));
+   EXPECT_EQ(cache.Entries(), 1u);
+   EXPECT_EQ(cache.Bytes(), 11u);
+   EXPECT_TRUE(cache.Lookup(digestB_).empty());
+
+   // Linked, not copied.
+   struct stat installerStat {};
+   ASSERT_EQ(stat(installerA_.c_str(), &installerStat), 0);
+   EXPECT_EQ(installerStat.st_nlink, 2u);
+
+   std::filesystem::remove(installerA_);
+   const auto cached = InstallerCache(directory_, std::chrono::hours(1), 0).Lookup(digestA_);
+   ASSERT_EQ(cached, directory_ / digestA_);
+   std::string contents;
+   std::getline(std::ifstream(cached), contents);
+   EXPECT_EQ(contents, "installer-a");
+
+   // A cached installer that changed is dropped rather than served.
+   std::ofstream(cached, std::ios::app) << "tampered";
+   InstallerCache restarted(directory_, std::chrono::hours(1), 0);
+   EXPECT_TRUE(restarted.Lookup(digestA_).empty());
+   EXPECT_EQ(restarted.Entries(), 0u);
+   EXPECT_FALSE(std::filesystem::exists(cached));
+}
+
+TEST_F(InstallerCacheTest, evictsExpiredThenLeastRecentlyUsedInstallers)
+{
+   {
+      InstallerCache cache(directory_, std::chrono::seconds(0), 0);
+      ASSERT_TRUE(cache.Add(installerA_, digestA_));
+      EXPECT_EQ(cache.Evict(), 1u);
+      EXPECT_EQ(cache.Entries(), 0u);
+   }
+
+   // A digest the caller verified is taken as is.
+   InstallerCache cache(directory_, std::chrono::hours(1), 11);
+   ASSERT_TRUE(cache.Add(installerA_, digestA_, true));
+   ASSERT_TRUE(cache.Add(installerB_, digestB_, true));
+   EXPECT_FALSE(cache.Lookup(digestA_).empty());
+   EXPECT_EQ(cache.Evict(), 1u);
+   EXPECT_TRUE(cache.Lookup(digestB_).empty());
+   EXPECT_FALSE(cache.Lookup(digestA_).empty());
+   EXPECT_EQ(cache.Bytes(), 11u);
+}
+
+int main(int argc, char **argv) {
+   PmLogger::initLogger();
+   testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,56 @@
+/**
+* @file
+*
+* @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+*/
+
+#include "gtest/gtest.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+#include "OSPackageManager/linux/KnownFolderCache.hpp"
+#include "OSPackageManager/common/PmLogger.hpp"
+
+TEST(KnownFolderCacheTest, resolvesAgainOnlyAfterUtmpChanges)
+{
+   const auto root = std::filesystem::temp_directory_path() / ("pm-utmp-" + std::to_string(getpid()));
+   std::filesystem::remove_all(root);
+   std::filesystem::create_directories(root);
+   std::ofstream(root / "utmp") << "alice";
+
+   int resolverCalls = 0;
+   auto resolver = [&resolverCalls](std::string& folder) {
+      ++resolverCalls;
+      folder = "/home/user" + std::to_string(resolverCalls);
+   };
+
+   PackageManager::KnownFolderCache cache((root / "utmp").string());
+   EXPECT_EQ(cache.Resolve("UserHome", resolver), "/home/user1");
+   EXPECT_EQ(cache.Resolve("UserHome", resolver), "/home/user1");
+   EXPECT_EQ(resolverCalls, 1);
+
+   // Unrelated files next to utmp do not invalidate.
+   std::ofstream(root / "utmpx.lock") << "";
+   EXPECT_EQ(cache.Resolve("UserHome", resolver), "/home/user1");
+
+   // A login or logout rewrites utmp.
+   std::ofstream(root / "utmp", std::ios::app) << "bob";
+   EXPECT_EQ(cache.Resolve("UserHome", resolver), "/home/user2");
+   EXPECT_EQ(cache.Resolve("UserHome", resolver), "/home/user2");
+   EXPECT_EQ(cache.Resolutions(), 2u);
+
+   // Entries expire even without utmp changes.
+   PackageManager::KnownFolderCache expiring((root / "utmp").string(), std::chrono::seconds(0));
+   (void)expiring.Resolve("UserHome", resolver);
+   (void)expiring.Resolve("UserHome", resolver);
+   EXPECT_EQ(expiring.Resolutions(), 2u);
+
+   std::filesystem::remove_all(root);
+}
+
+int main(int argc, char **argv) {
+   PmLogger::initLogger();
+   testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
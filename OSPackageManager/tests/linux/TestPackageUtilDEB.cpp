@@ -0,0 +1,463 @@
+/**
+* @file
+*
+* @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+*/
+
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include "OSPackageManager/Mocks/MockCommandExec/MockCommandExec.hpp"
+#include "OSPackageManager/Mocks/MockPmPlatformComponentManager/MockPmPlatformConfiguration.hpp"
+#include "OSPackageManager/common/CommandExec.hpp"
+#include "OSPackageManager/linux/PackageUtilDEB.hpp"
+#include "OSPackageManager/linux/DebControlReader.hpp"
+#include "OSPackageManager/linux/DpkgChangeTracker.hpp"
+#include "OSPackageManager/common/PmLogger.hpp"
+
+using testing::NiceMock;
+using testing::Return;
+using testing::_;
+
+class PackageUtilDEBTest : public ::testing::Test
+{
+protected:
+   void SetUp() override
+   {
+      commandExecutorPtr_ = std::make_unique<NiceMock<MockCommandExec>>();
+      platformConfigPtr_ = std::make_unique<MockPmPlatformConfiguration>();
+      packageUtil_ = std::make_unique<PackageUtilDEB>(*commandExecutorPtr_, *platformConfigPtr_);
+
+      ON_CALL(*commandExecutorPtr_, ParseOutput(_, _))
+         .WillByDefault(::testing::Invoke([](const std::string &output, std::vector<std::string> &outputLines) {
+            CommandExec().ParseOutput(output, outputLines);
+         }));
+   }
+   void TearDown() override
+   {
+   }
+   std::unique_ptr<NiceMock<MockCommandExec>> commandExecutorPtr_;
+   std::unique_ptr<MockPmPlatformConfiguration> platformConfigPtr_;
+   std::unique_ptr<PackageUtilDEB> packageUtil_;
+};
+
+namespace
+{
+const int success{ 0 };
+const int dpkg_failure{ 1 };
+const int argv_index{ 1 };
+const int error_code_index{ 2 };
+const int output_index{ 3 };
+
+const std::string dpkgBin{ "/bin/dpkg" };
+const std::string ucPackage{ "/tmp/downloads/it's uc_1.0.0.150_amd64.deb" };
+const std::string ampPackage{ "/tmp/downloads/amp_1.20.0_amd64.deb" };
+
+const std::string lockedOutput{ "dpkg: error: dpkg frontend lock was locked by another process with pid 4242\n" };
+
+const std::string batchSuccessOutput{
+   "(Reading database ... 1234 files and directories currently installed.)\n"
+   "Preparing to unpack .../it's uc_1.0.0.150_amd64.deb ...\n"
+   "Unpacking cisco-secure-client-uc (1.0.0.150) over (1.0.0.140) ...\n"
+   "Preparing to unpack .../amp_1.20.0_amd64.deb ...\n"
+   "Unpacking cisco-secure-client-amp (1.20.0) over (1.19.0) ...\n"
+   "Setting up cisco-secure-client-uc (1.0.0.150) ...\n"
+   "Setting up cisco-secure-client-amp:amd64 (1.20.0) ...\n"
+   "Processing triggers for libc-bin (2.36-9) ...\n" };
+
+const std::string batchPartialFailureOutput{
+   "(Reading database ... 1234 files and directories currently installed.)\n"
+   "Preparing to unpack .../it's uc_1.0.0.150_amd64.deb ...\n"
+   "Unpacking cisco-secure-client-uc (1.0.0.150) over (1.0.0.140) ...\n"
+   "dpkg: error processing archive /tmp/downloads/amp_1.20.0_amd64.deb (--install):\n"
+   " cannot access archive: No such file or directory\n"
+   "Setting up cisco-secure-client-uc (1.0.0.150) ...\n"
+   "Errors were encountered while processing:\n"
+   " /tmp/downloads/amp_1.20.0_amd64.deb\n" };
+
+// Builds a minimal archive with dpkg-deb using the given compression ("gzip", "xz", "zstd" or "none").
+std::string buildTestPackage(const std::string& architecture, const std::string& compression)
+{
+   const auto root = std::filesystem::temp_directory_path() / "pm-deb-control-test";
+   const auto packageDir = root / ("pkg-" + architecture);
+   std::filesystem::create_directories(packageDir / "DEBIAN");
+   std::filesystem::create_directories(packageDir / "usr/share/cm-test");
+   std::ofstream(packageDir / "DEBIAN/control")
+      << "Package: cm-test\nVersion: 1.2-3\nArchitecture: " << architecture
+      << "\nMaintainer: Test <test@example.com>\nDescription: test package\n multi-line description\n";
+   std::ofstream(packageDir / "usr/share/cm-test/data") << "payload";
+
+   const std::string debPath = (root / ("cm-test_" + architecture + "_" + compression + ".deb")).string();
+   const std::string cmd = "dpkg-deb --root-owner-group -Z" + compression + " --build " + packageDir.string() + " " + debPath + " > /dev/null";
+   return std::system(cmd.c_str()) == 0 ? debPath : std::string{};
+}
+
+// A scratch dpkg database directory and log for DpkgChangeTracker.
+struct FakeDpkgAdminDir
+{
+   std::filesystem::path root{ std::filesystem::temp_directory_path() / "pm-dpkg-tracker-test" };
+   std::filesystem::path adminDir{ root / "dpkg" };
+   std::filesystem::path logPath{ root / "dpkg.log" };
+
+   FakeDpkgAdminDir()
+   {
+      std::filesystem::remove_all(root);
+      std::filesystem::create_directories(adminDir / "updates");
+      std::ofstream(adminDir / "status") << "Package: base-files\n";
+      appendLog("2025-01-01 09:00:00 status installed base-files:amd64 12.4");
+   }
+   ~FakeDpkgAdminDir()
+   {
+      std::filesystem::remove_all(root);
+   }
+   void appendLog(const std::string& line)
+   {
+      std::ofstream(logPath, std::ios::app) << line << "\n";
+   }
+   void rewriteStatus()
+   {
+      // dpkg replaces the status file by renaming 'status-new' over it.
+      std::ofstream(adminDir / "status-new") << "Package: base-files\n";
+      std::filesystem::rename(adminDir / "status-new", adminDir / "status");
+   }
+};
+}
+
+TEST_F(PackageUtilDEBTest, installSpawnsDpkgDirectly)
+{
+   auto &commandExecutor{ *commandExecutorPtr_ };
+   std::vector<std::string> capturedArgv;
+
+   EXPECT_CALL(commandExecutor, ExecuteCommandCaptureOutput(_,_,_,_)).Times(0);
+   EXPECT_CALL(commandExecutor, ExecuteCommandCaptureCombinedOutput(dpkgBin,_,_,_))
+      .WillOnce(::testing::DoAll(::testing::SaveArg<argv_index>(&capturedArgv),
+                                 ::testing::SetArgReferee<error_code_index>(success),
+                                 ::testing::SetArgReferee<output_index>("Setting up cisco-secure-client-uc (1.0.0.150) ...\n"),
+                                 Return(success)));
+
+   ASSERT_THAT(packageUtil_->installPackageWithContext(ucPackage, "uc/1.0.0.150"), ::testing::IsTrue());
+
+   // The path is passed as its own argument, untouched by any shell quoting.
+   ASSERT_FALSE(capturedArgv.empty());
+   EXPECT_EQ(capturedArgv.front(), dpkgBin);
+   EXPECT_EQ(capturedArgv.back(), ucPackage);
+}
+
+TEST_F(PackageUtilDEBTest, installFailsOnDpkgError)
+{
+   auto &commandExecutor{ *commandExecutorPtr_ };
+
+   EXPECT_CALL(commandExecutor, ExecuteCommandCaptureCombinedOutput(dpkgBin,_,_,_))
+      .WillOnce(::testing::DoAll(::testing::SetArgReferee<error_code_index>(dpkg_failure),
+                                 ::testing::SetArgReferee<output_index>("dpkg: error: cannot access archive '/tmp/downloads/it\'s uc_1.0.0.150_amd64.deb': No such file or directory\n"),
+                                 Return(success)));
+   ASSERT_THAT(packageUtil_->installPackageWithContext(ucPackage, "uc/1.0.0.150"), ::testing::IsFalse());
+
+   EXPECT_CALL(commandExecutor, ExecuteCommandCaptureCombinedOutput(dpkgBin,_,_,_)).WillOnce(Return(-1));
+   ASSERT_THAT(packageUtil_->installPackageWithContext(ucPackage, "uc/1.0.0.150"), ::testing::IsFalse());
+}
+
+TEST_F(PackageUtilDEBTest, batchInstallUsesSingleDpkgInvocation)
+{
+   auto &commandExecutor{ *commandExecutorPtr_ };
+   std::vector<std::string> capturedArgv;
+
+   EXPECT_CALL(commandExecutor, ExecuteCommandCaptureCombinedOutput(dpkgBin,_,_,_))
+      .WillOnce(::testing::DoAll(::testing::SaveArg<argv_index>(&capturedArgv),
+                                 ::testing::SetArgReferee<error_code_index>(success),
+                                 ::testing::SetArgReferee<output_index>(batchSuccessOutput),
+                                 Return(success)));
+
+   const auto results = packageUtil_->installPackagesWithContext({ { ucPackage, "uc/1.0.0.150" }, { ampPackage, "amp/1.20.0" } });
+
+   ASSERT_EQ(results.size(), 2u);
+   EXPECT_TRUE(results[0]);
+   EXPECT_TRUE(results[1]);
+   EXPECT_EQ(std::count(capturedArgv.begin(), capturedArgv.end(), ucPackage), 1);
+   EXPECT_EQ(std::count(capturedArgv.begin(), capturedArgv.end(), ampPackage), 1);
+}
+
+TEST_F(PackageUtilDEBTest, batchInstallSplitsPerPackageResults)
+{
+   auto &commandExecutor{ *commandExecutorPtr_ };
+
+   EXPECT_CALL(commandExecutor, ExecuteCommandCaptureCombinedOutput(dpkgBin,_,_,_))
+      .WillOnce(::testing::DoAll(::testing::SetArgReferee<error_code_index>(dpkg_failure),
+                                 ::testing::SetArgReferee<output_index>(batchPartialFailureOutput),
+                                 Return(success)));
+
+   const auto results = packageUtil_->installPackagesWithContext({ { ucPackage, "uc/1.0.0.150" }, { ampPackage, "amp/1.20.0" } });
+
+   ASSERT_EQ(results.size(), 2u);
+   EXPECT_TRUE(results[0]);
+   EXPECT_FALSE(results[1]);
+}
+
+TEST_F(PackageUtilDEBTest, batchInstallUnattributedFailureFailsAll)
+{
+   auto &commandExecutor{ *commandExecutorPtr_ };
+
+   EXPECT_CALL(commandExecutor, ExecuteCommandCaptureCombinedOutput(dpkgBin,_,_,_))
+      .WillOnce(::testing::DoAll(::testing::SetArgReferee<error_code_index>(2),
+                                 ::testing::SetArgReferee<output_index>("dpkg: error: requested operation requires superuser privilege\n"),
+                                 Return(success)));
+
+   const auto results = packageUtil_->installPackagesWithContext({ { ucPackage, "uc/1.0.0.150" }, { ampPackage, "amp/1.20.0" } });
+
+   ASSERT_EQ(results.size(), 2u);
+   EXPECT_FALSE(results[0]);
+   EXPECT_FALSE(results[1]);
+}
+
+TEST_F(PackageUtilDEBTest, deferredTriggersRunOnceForBatch)
+{
+   auto &commandExecutor{ *commandExecutorPtr_ };
+   std::vector<std::string> installArgv;
+   std::vector<std::string> triggersArgv;
+   const std::map<std::string, int> deferTriggers{ { kInstallOptionDeferTriggers, 1 } };
+
+   EXPECT_CALL(commandExecutor, ExecuteCommandCaptureCombinedOutput(dpkgBin,_,_,_))
+      .WillOnce(::testing::DoAll(::testing::SaveArg<argv_index>(&installArgv),
+                                 ::testing::SetArgReferee<error_code_index>(success),
+                                 Return(success)))
+      .WillOnce(::testing::DoAll(::testing::SetArgReferee<error_code_index>(success),
+                                 Return(success)))
+      .WillOnce(::testing::DoAll(::testing::SaveArg<argv_index>(&triggersArgv),
+                                 ::testing::SetArgReferee<error_code_index>(success),
+                                 Return(success)));
+
+   ASSERT_THAT(packageUtil_->installPackageWithContext(ucPackage, "uc/1.0.0.150", deferTriggers), ::testing::IsTrue());
+   ASSERT_THAT(packageUtil_->installPackageWithContext(ampPackage, "amp/1.20.0", deferTriggers), ::testing::IsTrue());
+   ASSERT_THAT(packageUtil_->processPendingTriggers(), ::testing::IsTrue());
+   // Nothing left pending, so no further dpkg invocation.
+   ASSERT_THAT(packageUtil_->processPendingTriggers(), ::testing::IsTrue());
+
+   EXPECT_THAT(installArgv, ::testing::Contains("--no-triggers"));
+   EXPECT_THAT(triggersArgv, ::testing::ElementsAre(dpkgBin, "--triggers-only", "--pending"));
+
+   const auto metrics = packageUtil_->getInstallMetrics();
+   EXPECT_EQ(metrics.packagesInstalled, 2u);
+   EXPECT_EQ(metrics.packagesWithDeferredTriggers, 2u);
+   EXPECT_EQ(metrics.deferredTriggerRuns, 1u);
+}
+
+TEST_F(PackageUtilDEBTest, triggersNotDeferredByDefault)
+{
+   auto &commandExecutor{ *commandExecutorPtr_ };
+   std::vector<std::string> installArgv;
+
+   EXPECT_CALL(commandExecutor, ExecuteCommandCaptureCombinedOutput(dpkgBin,_,_,_))
+      .WillOnce(::testing::DoAll(::testing::SaveArg<argv_index>(&installArgv),
+                                 ::testing::SetArgReferee<error_code_index>(success),
+                                 Return(success)));
+
+   ASSERT_THAT(packageUtil_->installPackageWithContext(ucPackage, "uc/1.0.0.150"), ::testing::IsTrue());
+   ASSERT_THAT(packageUtil_->processPendingTriggers(), ::testing::IsTrue());
+
+   EXPECT_THAT(installArgv, ::testing::Not(::testing::Contains("--no-triggers")));
+   EXPECT_EQ(packageUtil_->getInstallMetrics().deferredTriggerRuns, 0u);
+}
+
+TEST_F(PackageUtilDEBTest, installRetriesWhenLockIsLost)
+{
+   auto &commandExecutor{ *commandExecutorPtr_ };
+   const std::map<std::string, int> lockWait{ { kInstallOptionLockWaitTimeoutSec, 5 } };
+
+   EXPECT_CALL(commandExecutor, ExecuteCommandCaptureCombinedOutput(dpkgBin,_,_,_))
+      .WillOnce(::testing::DoAll(::testing::SetArgReferee<error_code_index>(2),
+                                 ::testing::SetArgReferee<output_index>(lockedOutput),
+                                 Return(success)))
+      .WillOnce(::testing::DoAll(::testing::SetArgReferee<error_code_index>(success),
+                                 ::testing::SetArgReferee<output_index>(""),
+                                 Return(success)));
+
+   ASSERT_THAT(packageUtil_->installPackageWithContext(ucPackage, "uc/1.0.0.150", lockWait), ::testing::IsTrue());
+
+   const auto metrics = packageUtil_->getInstallMetrics();
+   EXPECT_GT(metrics.lockWaitTime.count(), 0);
+   EXPECT_EQ(metrics.lockWaitTimeouts, 0u);
+}
+
+TEST_F(PackageUtilDEBTest, installGivesUpOnLockAfterDeadline)
+{
+   auto &commandExecutor{ *commandExecutorPtr_ };
+   const std::map<std::string, int> noLockWait{ { kInstallOptionLockWaitTimeoutSec, 0 } };
+
+   EXPECT_CALL(commandExecutor, ExecuteCommandCaptureCombinedOutput(dpkgBin,_,_,_))
+      .WillOnce(::testing::DoAll(::testing::SetArgReferee<error_code_index>(2),
+                                 ::testing::SetArgReferee<output_index>(lockedOutput),
+                                 Return(success)));
+
+   ASSERT_THAT(packageUtil_->installPackageWithContext(ucPackage, "uc/1.0.0.150", noLockWait), ::testing::IsFalse());
+   EXPECT_EQ(packageUtil_->getInstallMetrics().lockWaitTimeouts, 1u);
+}
+
+TEST_F(PackageUtilDEBTest, controlReaderReadsEveryCompression)
+{
+   DebControlReader reader;
+   for (const std::string compression : { "gzip", "xz", "zstd", "none" }) {
+      const std::string debPath = buildTestPackage("amd64", compression);
+      ASSERT_FALSE(debPath.empty()) << compression;
+
+      PackageInfo info;
+      ASSERT_TRUE(reader.readPackageInfo(debPath, info)) << compression;
+      EXPECT_EQ(info.packageName, "cm-test");
+      EXPECT_EQ(info.version, "1.2-3");
+      EXPECT_EQ(info.architecture, "amd64");
+      EXPECT_EQ(info.packageIdentifier, "cm-test-1.2-3.amd64");
+   }
+
+   PackageInfo info;
+   EXPECT_FALSE(reader.readPackageInfo(ucPackage, info));
+}
+
+TEST_F(PackageUtilDEBTest, installRejectsForeignArchitecture)
+{
+   auto &commandExecutor{ *commandExecutorPtr_ };
+   const std::string debPath = buildTestPackage("s390x", "xz");
+   ASSERT_FALSE(debPath.empty());
+
+   EXPECT_CALL(commandExecutor, ExecuteCommandCaptureOutput(dpkgBin, ::testing::Contains(std::string("--print-architecture")), _, _))
+      .WillOnce(::testing::DoAll(::testing::SetArgReferee<error_code_index>(success),
+                                 ::testing::SetArgReferee<output_index>("amd64\n"),
+                                 Return(success)));
+   EXPECT_CALL(commandExecutor, ExecuteCommandCaptureOutput(dpkgBin, ::testing::Contains(std::string("--print-foreign-architectures")), _, _))
+      .WillOnce(::testing::DoAll(::testing::SetArgReferee<error_code_index>(success),
+                                 ::testing::SetArgReferee<output_index>("i386\n"),
+                                 Return(success)));
+   EXPECT_CALL(commandExecutor, ExecuteCommandCaptureCombinedOutput(_,_,_,_)).Times(0);
+
+   ASSERT_THAT(packageUtil_->installPackageWithContext(debPath, "test/1.2"), ::testing::IsFalse());
+   EXPECT_EQ(packageUtil_->getInstallMetrics().packagesRejectedArchitecture, 1u);
+}
+
+TEST_F(PackageUtilDEBTest, installSkipsInstalledVersionWhenRequested)
+{
+   auto &commandExecutor{ *commandExecutorPtr_ };
+   const std::string debPath = buildTestPackage("all", "gzip");
+   ASSERT_FALSE(debPath.empty());
+   const std::map<std::string, int> skipInstalled{ { kInstallOptionSkipInstalledVersion, 1 } };
+
+   EXPECT_CALL(commandExecutor, ExecuteCommandCaptureOutput(dpkgBin, ::testing::Contains(std::string("cm-test")), _, _))
+      .WillOnce(::testing::DoAll(::testing::SetArgReferee<error_code_index>(success),
+                                 ::testing::SetArgReferee<output_index>("Package: cm-test\nStatus: install ok installed\nVersion: 1.2-3\n"),
+                                 Return(success)))
+      .WillOnce(::testing::DoAll(::testing::SetArgReferee<error_code_index>(success),
+                                 ::testing::SetArgReferee<output_index>("Package: cm-test\nStatus: deinstall ok config-files\nVersion: 1.2-3\n"),
+                                 Return(success)));
+
+   // 1. The same version is installed: dpkg is not run
+   EXPECT_CALL(commandExecutor, ExecuteCommandCaptureCombinedOutput(_,_,_,_)).Times(0);
+   ASSERT_THAT(packageUtil_->installPackageWithContext(debPath, "test/1.2", skipInstalled), ::testing::IsTrue());
+   EXPECT_EQ(packageUtil_->getInstallMetrics().packagesSkippedAlreadyInstalled, 1u);
+   EXPECT_EQ(packageUtil_->getInstallMetrics().packagesInstalled, 0u);
+
+   // 2. Only configuration files are left behind: the package is installed
+   EXPECT_CALL(commandExecutor, ExecuteCommandCaptureCombinedOutput(dpkgBin,_,_,_))
+      .WillOnce(::testing::DoAll(::testing::SetArgReferee<error_code_index>(success), Return(success)));
+   ASSERT_THAT(packageUtil_->installPackageWithContext(debPath, "test/1.2", skipInstalled), ::testing::IsTrue());
+   EXPECT_EQ(packageUtil_->getInstallMetrics().packagesInstalled, 1u);
+}
+
+TEST_F(PackageUtilDEBTest, listInstalledPackagesQueriesDpkgOnce)
+{
+   auto &commandExecutor{ *commandExecutorPtr_ };
+   EXPECT_CALL(commandExecutor, ExecuteCommandCaptureOutput("/bin/dpkg-query", ::testing::Contains(std::string("-W")), _, _))
+      .WillOnce(::testing::DoAll(::testing::SetArgReferee<error_code_index>(success),
+                                 ::testing::SetArgReferee<output_index>(
+                                    "cisco-secure-client-uc\t1.0.0.150\tamd64\n"
+                                    "libc6\t2.36-9\tamd64\n"
+                                    "libc6\t2.36-9\ti386\n"
+                                    "purged-package\t\t\n"),
+                                 Return(success)));
+
+   std::vector<PackageInfo> packages;
+   ASSERT_TRUE(packageUtil_->listInstalledPackages(packages));
+   ASSERT_EQ(packages.size(), 3u);
+   EXPECT_EQ(packages[0].packageName, "cisco-secure-client-uc");
+   EXPECT_EQ(packages[0].version, "1.0.0.150");
+   EXPECT_EQ(packages[0].architecture, "amd64");
+   EXPECT_TRUE(packages[0].packageIdentifier.empty());
+   EXPECT_EQ(packages[2].architecture, "i386");
+
+   // Listed packages are served from the cache while dpkg reports no change.
+   EXPECT_CALL(commandExecutor, ExecuteCommandCaptureOutput(dpkgBin, _, _, _)).Times(0);
+   if (packageUtil_->getPackageDbGeneration() != 0) {
+      const auto info = packageUtil_->getPackageInfo(PKG_ID_TYPE::NAME, "cisco-secure-client-uc");
+      EXPECT_EQ(info.version, "1.0.0.150");
+      EXPECT_EQ(info.packageIdentifier, "cisco-secure-client-uc-1.0.0.150.amd64");
+   }
+}
+
+TEST_F(PackageUtilDEBTest, changeTrackerReportsPackagesFromDpkgLog)
+{
+   FakeDpkgAdminDir dpkg;
+   DpkgChangeTracker tracker(dpkg.adminDir.string(), dpkg.logPath.string());
+   ASSERT_TRUE(tracker.isWatching());
+
+   const uint64_t initial = tracker.refresh();
+   std::set<std::string> changed;
+   ASSERT_TRUE(tracker.getChangedPackagesSince(initial, changed));
+   EXPECT_TRUE(changed.empty());
+
+   dpkg.appendLog("2025-01-02 10:00:00 upgrade cisco-secure-client-uc:amd64 1.0.0.140 1.0.0.150");
+   dpkg.appendLog("2025-01-02 10:00:01 status installed cisco-secure-client-uc:amd64 1.0.0.150");
+   dpkg.appendLog("2025-01-02 10:00:02 remove cisco-secure-client-amp:amd64 1.19.0 <none>");
+   dpkg.appendLog("2025-01-02 10:00:03 startup packages configure");
+   dpkg.rewriteStatus();
+
+   const uint64_t next = tracker.refresh();
+   EXPECT_GT(next, initial);
+   EXPECT_FALSE(tracker.isUnchangedSince("cisco-secure-client-uc", initial));
+   EXPECT_FALSE(tracker.isUnchangedSince("cisco-secure-client-amp", initial));
+   EXPECT_TRUE(tracker.isUnchangedSince("base-files", initial));
+   EXPECT_TRUE(tracker.isUnchangedSince("cisco-secure-client-uc", next));
+
+   changed.clear();
+   ASSERT_TRUE(tracker.getChangedPackagesSince(initial, changed));
+   EXPECT_EQ(changed, (std::set<std::string>{ "cisco-secure-client-amp", "cisco-secure-client-uc" }));
+
+   // Nothing happened since: the generation stays put.
+   EXPECT_EQ(tracker.refresh(), next);
+}
+
+TEST_F(PackageUtilDEBTest, changeTrackerInvalidatesUnattributedChanges)
+{
+   FakeDpkgAdminDir dpkg;
+   DpkgChangeTracker tracker(dpkg.adminDir.string(), dpkg.logPath.string());
+   const uint64_t initial = tracker.refresh();
+
+   // A journal entry without any dpkg.log line could be any package.
+   std::ofstream(dpkg.adminDir / "updates" / "0000") << "Package: unknown\n";
+   const uint64_t next = tracker.refresh();
+
+   std::set<std::string> changed;
+   EXPECT_FALSE(tracker.getChangedPackagesSince(initial, changed));
+   EXPECT_FALSE(tracker.isUnchangedSince("base-files", initial));
+   EXPECT_TRUE(tracker.getChangedPackagesSince(next, changed));
+   EXPECT_TRUE(tracker.isUnchangedSince("base-files", next));
+}
+
+TEST_F(PackageUtilDEBTest, changeTrackerFollowsLogRotation)
+{
+   FakeDpkgAdminDir dpkg;
+   DpkgChangeTracker tracker(dpkg.adminDir.string(), dpkg.logPath.string());
+   const uint64_t initial = tracker.refresh();
+
+   dpkg.appendLog("2025-01-03 08:00:00 status installed cisco-secure-client-uc:amd64 1.0.0.160");
+   std::filesystem::rename(dpkg.logPath, dpkg.root / "dpkg.log.1");
+   dpkg.appendLog("2025-01-03 08:05:00 status installed cisco-secure-client-amp:amd64 1.20.1");
+   dpkg.rewriteStatus();
+
+   std::set<std::string> changed;
+   ASSERT_TRUE(tracker.getChangedPackagesSince(initial, changed));
+   EXPECT_EQ(changed, (std::set<std::string>{ "cisco-secure-client-amp", "cisco-secure-client-uc" }));
+}
+
+int main(int argc, char **argv) {
+   PmLogger::initLogger();
+   testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
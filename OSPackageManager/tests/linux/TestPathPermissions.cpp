@@ -0,0 +1,77 @@
+/**
+* @file
+*
+* @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+*/
+
+#include "gtest/gtest.h"
+#include <filesystem>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include "OSPackageManager/linux/PathPermissions.hpp"
+#include "OSPackageManager/common/PmLogger.hpp"
+
+TEST(PathPermissionsTest, restrictsTreesWithoutFollowingLinks)
+{
+   const auto root = std::filesystem::temp_directory_path() / ("pm-permissions-" + std::to_string(getpid()));
+   std::filesystem::remove_all(root);
+   std::filesystem::create_directories(root / "product" / "policies");
+   std::ofstream(root / "product" / "config.json") << "{}";
+   std::ofstream(root / "product" / "policies" / "policy.json") << "{}";
+   std::ofstream(root / "product" / "tool") << "#!/bin/sh";
+   std::ofstream(root / "outside.json") << "{}";
+   std::filesystem::create_symlink(root / "outside.json", root / "product" / "link.json");
+   for (const auto& [path, mode] : std::vector<std::pair<std::filesystem::path, mode_t>>{
+           { root / "product", 0777 }, { root / "product" / "config.json", 0666 },
+           { root / "product" / "policies", 0700 }, { root / "product" / "policies" / "policy.json", 0400 },
+           { root / "product" / "tool", 0775 },
+           { root / "outside.json", 0666 } }) {
+      ASSERT_EQ(chmod(path.c_str(), mode), 0);
+   }
+   auto modeOf = [](const std::filesystem::path& path) {
+      struct stat pathStat {};
+      EXPECT_EQ(lstat(path.c_str(), &pathStat), 0);
+      return pathStat.st_mode & 07777;
+   };
+
+   using PackageManager::PathPermissions;
+   using PackageManager::PathRestriction;
+   EXPECT_EQ(PathPermissions::RestrictedMode(0644, PathRestriction::Admins), 0644u);
+   EXPECT_EQ(PathPermissions::RestrictedMode(0604, PathRestriction::Users), 0604u);
+   EXPECT_EQ(PathPermissions::RestrictedTreeMode(S_IFDIR | 0777, PathRestriction::Admins), 0755u);
+   EXPECT_EQ(PathPermissions::RestrictedTreeMode(S_IFDIR | 0700, PathRestriction::Users), 0705u);
+   EXPECT_EQ(PathPermissions::RestrictedTreeMode(S_IFREG | 0777, PathRestriction::Admins), 0755u);
+   EXPECT_EQ(PathPermissions::RestrictedTreeMode(S_IFREG | 0666, PathRestriction::Admins), 0644u);
+
+   ASSERT_TRUE(PathPermissions::Apply(root / "product" / "config.json", PathRestriction::Admins, false));
+   EXPECT_EQ(modeOf(root / "product" / "config.json"), 0644u);
+   EXPECT_EQ(modeOf(root / "product"), 0777u);
+
+   ASSERT_TRUE(PathPermissions::Apply(root / "product", PathRestriction::Admins, true));
+   EXPECT_EQ(modeOf(root / "product"), 0755u);
+   EXPECT_EQ(modeOf(root / "product" / "policies"), 0700u);
+   EXPECT_EQ(modeOf(root / "product" / "policies" / "policy.json"), 0600u);
+   EXPECT_EQ(modeOf(root / "product" / "tool"), 0755u);
+   EXPECT_EQ(modeOf(root / "outside.json"), 0666u);
+
+   ASSERT_TRUE(PathPermissions::Apply(root / "product", PathRestriction::Users, true));
+   EXPECT_EQ(modeOf(root / "product" / "policies"), 0705u);
+   EXPECT_EQ(modeOf(root / "product" / "policies" / "policy.json"), 0604u);
+   EXPECT_EQ(modeOf(root / "product" / "tool"), 0755u);
+
+   EXPECT_FALSE(PathPermissions::Apply(root / "product" / "link.json", PathRestriction::Admins, false));
+   EXPECT_FALSE(PathPermissions::Apply(root / "missing.json", PathRestriction::Admins, false));
+   EXPECT_FALSE(PathPermissions::Apply({}, PathRestriction::Admins, false));
+   EXPECT_EQ(modeOf(root / "outside.json"), 0666u);
+
+   std::filesystem::remove_all(root);
+}
+
+int main(int argc, char **argv) {
+   PmLogger::initLogger();
+   testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,42 @@
+/**
+* @file
+*
+* @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+*/
+
+#include "gtest/gtest.h"
+#include <string>
+#include <vector>
+#include "OSPackageManager/linux/PathTemplate.hpp"
+#include "OSPackageManager/common/PmLogger.hpp"
+
+TEST(PathTemplateTest, expandsEveryFolderIdInOnePass)
+{
+   const PackageManager::PathTemplate pathTemplate("<FOLDERID_UserHome>/data/<FOLDERID_ProgramData>/<FOLDERID_>/x<FOLDERID_Open");
+   EXPECT_TRUE(pathTemplate.HasFolderIds());
+   EXPECT_EQ(pathTemplate.FolderIds(), (std::vector<std::string>{ "UserHome", "ProgramData" }));
+
+   int resolutions = 0;
+   std::string path;
+   ASSERT_TRUE(pathTemplate.Expand([&resolutions](const std::string& knownFolderId) {
+      ++resolutions;
+      return knownFolderId == "UserHome" ? std::string("/home/alice") : std::string("/opt");
+   }, path));
+   EXPECT_EQ(path, "/home/alice/data//opt/<FOLDERID_>/x<FOLDERID_Open");
+   EXPECT_EQ(resolutions, 2);
+
+   path = "unchanged";
+   EXPECT_FALSE(pathTemplate.Expand([](const std::string&) { return std::string(); }, path));
+   EXPECT_EQ(path, "unchanged");
+
+   const PackageManager::PathTemplate literal("/etc/amp/*.json");
+   EXPECT_FALSE(literal.HasFolderIds());
+   ASSERT_TRUE(literal.Expand([](const std::string&) { return std::string(); }, path));
+   EXPECT_EQ(path, "/etc/amp/*.json");
+}
+
+int main(int argc, char **argv) {
+   PmLogger::initLogger();
+   testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,719 @@
+/**
+* @file
+*
+* @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+*/
+
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include "OSPackageManager/Mocks/MockFileUtilities/MockFileUtilities.hpp"
+#include "OSPackageManager/Mocks/MockPackageUtil/MockPackageUtil.hpp"
+#include "OSPackageManager/linux/DiscoveryRulesStore.hpp"
+#include "OSPackageManager/linux/InstallerCache.hpp"
+#include "OSPackageManager/linux/InstallJournal.hpp"
+#include "OSPackageManager/linux/InventorySnapshotStore.hpp"
+#include "OSPackageManager/linux/PmPlatformComponentManager.hpp"
+#include "OSPackageManager/common/PmLogger.hpp"
+
+using testing::NiceMock;
+using testing::Return;
+using testing::_;
+
+namespace
+{
+PmProductDiscoveryRules makeRule(const std::string& product, const std::string& packageName)
+{
+   PmProductDiscoveryRules rule;
+   rule.product = product;
+   rule.pkgnvra_discovery.emplace_back();
+   rule.pkgnvra_discovery.back().pkgId = packageName + "-1.0-1.x86_64";
+   rule.pkgname_discovery.emplace_back();
+   rule.pkgname_discovery.back().name = packageName;
+   rule.configurables.emplace_back();
+   rule.configurables.back().cfgPath = "/opt/cisco/" + product + "/*.json";
+   rule.configurables.back().unresolvedCfgPath = "<FOLDERID_ProgramData>/" + product + "/*.json";
+   rule.configurables.back().max_instances = 3;
+   return rule;
+}
+}
+
+class PmPlatformComponentManagerTest : public ::testing::Test
+{
+protected:
+   void SetUp() override
+   {
+      packageUtilPtr_ = std::make_shared<NiceMock<MockPackageUtil>>();
+      fileUtilsPtr_ = std::make_shared<NiceMock<MockFileUtilities>>();
+      rulesFile_ = std::filesystem::temp_directory_path() / ("pm-rules-" + std::to_string(getpid()) + ".json");
+      snapshotFile_ = std::filesystem::temp_directory_path() / ("pm-inventory-" + std::to_string(getpid()) + ".bin");
+      std::filesystem::remove(rulesFile_);
+      std::filesystem::remove(snapshotFile_);
+
+      ON_CALL(*packageUtilPtr_, getPackageInfo(_, _))
+         .WillByDefault(::testing::Invoke([this](const PKG_ID_TYPE& type, const std::string& identifier) {
+            std::this_thread::sleep_for(lookupLatency_);
+            ++lookups_;
+            PackageInfo info;
+            if (type == PKG_ID_TYPE::NAME) {
+               info.packageName = identifier;
+               info.version = "1.0";
+            }
+            return info;
+         }));
+      ON_CALL(*packageUtilPtr_, getPackageDbGeneration()).WillByDefault(Return(3));
+      ON_CALL(*packageUtilPtr_, getChangedPackagesSince(_, _)).WillByDefault(Return(true));
+      ON_CALL(*packageUtilPtr_, processPendingTriggers()).WillByDefault(Return(true));
+   }
+   void TearDown() override
+   {
+      std::filesystem::remove(rulesFile_);
+      std::filesystem::remove(snapshotFile_);
+   }
+
+   std::shared_ptr<NiceMock<MockPackageUtil>> packageUtilPtr_;
+   std::shared_ptr<NiceMock<MockFileUtilities>> fileUtilsPtr_;
+   std::filesystem::path rulesFile_;
+   std::filesystem::path snapshotFile_;
+   std::atomic<int> lookups_{ 0 };
+   std::chrono::milliseconds lookupLatency_{ 0 };
+   const std::vector<PmProductDiscoveryRules> catalog_{ makeRule("amp", "cisco-amp"), makeRule("uc", "cisco-uc") };
+};
+
+TEST_F(PmPlatformComponentManagerTest, discoveryRulesRoundTrip)
+{
+   DiscoveryRulesStore store(rulesFile_);
+   ASSERT_TRUE(store.Save(catalog_));
+   const auto written = std::filesystem::last_write_time(rulesFile_);
+
+   std::vector<PmProductDiscoveryRules> loaded;
+   ASSERT_TRUE(DiscoveryRulesStore(rulesFile_).Load(loaded));
+   ASSERT_EQ(loaded.size(), catalog_.size());
+   for (size_t i = 0; i < loaded.size(); ++i) {
+      EXPECT_EQ(loaded[i].product, catalog_[i].product);
+      ASSERT_EQ(loaded[i].pkgnvra_discovery.size(), 1u);
+      EXPECT_EQ(loaded[i].pkgnvra_discovery[0].pkgId, catalog_[i].pkgnvra_discovery[0].pkgId);
+      ASSERT_EQ(loaded[i].pkgname_discovery.size(), 1u);
+      EXPECT_EQ(loaded[i].pkgname_discovery[0].name, catalog_[i].pkgname_discovery[0].name);
+      ASSERT_EQ(loaded[i].configurables.size(), 1u);
+      EXPECT_EQ(loaded[i].configurables[0].cfgPath, catalog_[i].configurables[0].cfgPath);
+      EXPECT_EQ(loaded[i].configurables[0].unresolvedCfgPath, catalog_[i].configurables[0].unresolvedCfgPath);
+      EXPECT_EQ(loaded[i].configurables[0].max_instances, catalog_[i].configurables[0].max_instances);
+   }
+
+   // Identical rules are not rewritten.
+   std::this_thread::sleep_for(std::chrono::milliseconds(20));
+   ASSERT_TRUE(store.Save(catalog_));
+   EXPECT_EQ(std::filesystem::last_write_time(rulesFile_), written);
+
+   std::ofstream(rulesFile_) << "{ \"version\": 99 }";
+   EXPECT_FALSE(DiscoveryRulesStore(rulesFile_).Load(loaded));
+}
+
+TEST_F(PmPlatformComponentManagerTest, firstDiscoveryReusesPrewarmedInventory)
+{
+   {
+      // A previous run stores the catalog of its last check-in.
+      PmPlatformComponentManager previousRun(packageUtilPtr_, fileUtilsPtr_);
+      previousRun.StartInventoryPrewarm(rulesFile_);
+      PackageInventory inventory;
+      ASSERT_EQ(previousRun.GetInstalledPackages(catalog_, inventory), 0);
+   }
+   ASSERT_TRUE(std::filesystem::exists(rulesFile_));
+
+   lookups_ = 0;
+   lookupLatency_ = std::chrono::milliseconds(20);
+   PmPlatformComponentManager manager(packageUtilPtr_, fileUtilsPtr_);
+   manager.StartInventoryPrewarm(rulesFile_);
+
+   // The first check-in joins the pre-warm and does not query the package database again.
+   PackageInventory inventory;
+   ASSERT_EQ(manager.GetInstalledPackages(catalog_, inventory), 0);
+   EXPECT_EQ(lookups_, 4); // NVRA and name lookup per product, all made by the pre-warm
+   ASSERT_EQ(inventory.packages.size(), 2u);
+   EXPECT_EQ(inventory.packages[0].product, "amp");
+   EXPECT_EQ(inventory.packages[1].version, "1.0");
+
+   PackageInventory cached;
+   ASSERT_EQ(manager.GetCachedInventory(cached), 0);
+   EXPECT_EQ(cached.packages.size(), 2u);
+}
+
+TEST_F(PmPlatformComponentManagerTest, noPrewarmWithoutStoredRules)
+{
+   PmPlatformComponentManager manager(packageUtilPtr_, fileUtilsPtr_);
+   manager.StartInventoryPrewarm(rulesFile_);
+   std::this_thread::sleep_for(std::chrono::milliseconds(20));
+   EXPECT_EQ(lookups_, 0);
+
+   PackageInventory inventory;
+   ASSERT_EQ(manager.GetInstalledPackages(catalog_, inventory), 0);
+   EXPECT_EQ(inventory.packages.size(), 2u);
+   EXPECT_TRUE(std::filesystem::exists(rulesFile_));
+}
+
+TEST_F(PmPlatformComponentManagerTest, inventorySnapshotRoundTrip)
+{
+   PackageInventory inventory;
+   inventory.architecture = "x86_64";
+   inventory.platform = "linux";
+   inventory.packages.push_back({ "amp", "1.0", {} });
+   PackageConfigInfo config = {};
+   config.cfgPath = "/opt/cisco/amp/policy.json";
+   config.unresolvedCfgPath = "<FOLDERID_ProgramData>/amp/policy.json";
+   config.sha256 = "ab12";
+   inventory.packages.push_back({ "uc", "2.0", { config } });
+
+   InventorySnapshotStore store(snapshotFile_);
+   ASSERT_TRUE(store.Save(inventory, 7));
+   const auto written = std::filesystem::last_write_time(snapshotFile_);
+
+   PackageInventory loaded;
+   uint64_t generation = 0;
+   ASSERT_TRUE(InventorySnapshotStore(snapshotFile_).Load(loaded, generation));
+   EXPECT_EQ(generation, 7u);
+   EXPECT_EQ(loaded.architecture, "x86_64");
+   EXPECT_EQ(loaded.platform, "linux");
+   ASSERT_EQ(loaded.packages.size(), 2u);
+   EXPECT_EQ(loaded.packages[0].product, "amp");
+   EXPECT_TRUE(loaded.packages[0].configs.empty());
+   EXPECT_EQ(loaded.packages[1].version, "2.0");
+   ASSERT_EQ(loaded.packages[1].configs.size(), 1u);
+   EXPECT_EQ(loaded.packages[1].configs[0].cfgPath, config.cfgPath);
+   EXPECT_EQ(loaded.packages[1].configs[0].unresolvedCfgPath, config.unresolvedCfgPath);
+   EXPECT_EQ(loaded.packages[1].configs[0].sha256, "ab12");
+   EXPECT_FALSE(loaded.packages[1].configs[0].isDiscoveredAtDeployPath);
+
+   // Identical inventories are not rewritten.
+   std::this_thread::sleep_for(std::chrono::milliseconds(20));
+   ASSERT_TRUE(store.Save(inventory, 7));
+   EXPECT_EQ(std::filesystem::last_write_time(snapshotFile_), written);
+
+   // A flipped byte or a truncated file rejects the whole snapshot.
+   const auto size = std::filesystem::file_size(snapshotFile_);
+   {
+      std::fstream file(snapshotFile_, std::ios::in | std::ios::out | std::ios::binary);
+      file.seekp(static_cast<std::streamoff>(size - 3));
+      file.put('#');
+   }
+   EXPECT_FALSE(InventorySnapshotStore(snapshotFile_).Load(loaded, generation));
+   ASSERT_TRUE(store.Save(inventory, 8));
+   std::filesystem::resize_file(snapshotFile_, size - 1);
+   EXPECT_FALSE(InventorySnapshotStore(snapshotFile_).Load(loaded, generation));
+   EXPECT_EQ(generation, 7u);
+}
+
+TEST_F(PmPlatformComponentManagerTest, restartServesPersistedInventory)
+{
+   {
+      PmPlatformComponentManager previousRun(packageUtilPtr_, fileUtilsPtr_);
+      EXPECT_FALSE(previousRun.RestoreInventorySnapshot(snapshotFile_));
+      PackageInventory inventory;
+      ASSERT_EQ(previousRun.GetInstalledPackages(catalog_, inventory), 0);
+   }
+   ASSERT_TRUE(std::filesystem::exists(snapshotFile_));
+
+   lookups_ = 0;
+   PmPlatformComponentManager manager(packageUtilPtr_, fileUtilsPtr_);
+   ASSERT_TRUE(manager.RestoreInventorySnapshot(snapshotFile_));
+
+   // Available before any discovery of this run.
+   PackageInventory cached;
+   ASSERT_EQ(manager.GetCachedInventory(cached), 0);
+   ASSERT_EQ(cached.packages.size(), 2u);
+   EXPECT_EQ(cached.packages[1].product, "uc");
+   EXPECT_EQ(lookups_, 0);
+
+   // The first discovery compares against the restored inventory.
+   PackageInventory inventory;
+   ASSERT_EQ(manager.GetInstalledPackages(catalog_, inventory), 0);
+   EXPECT_EQ(inventory.packages.size(), 2u);
+}
+
+TEST_F(PmPlatformComponentManagerTest, repeatedInstallIsServedFromTheInstallerCache)
+{
+   const auto cacheDirectory = std::filesystem::temp_directory_path() / ("pm-installer-cache-" + std::to_string(getpid()));
+   const auto download = std::filesystem::temp_directory_path() / ("pm-download-" + std::to_string(getpid()) + ".rpm");
+   std::filesystem::remove_all(cacheDirectory);
+   std::ofstream(download) << "installer-a";
+
+   std::vector<std::string> installed;
+   ON_CALL(*fileUtilsPtr_, PathIsValid(_))
+      .WillByDefault(::testing::Invoke([](const std::filesystem::path& path) { return std::filesystem::exists(path); }));
+   ON_CALL(*packageUtilPtr_, isValidInstallerType(_)).WillByDefault(Return(true));
+   ON_CALL(*packageUtilPtr_, verifyPackage(_, _)).WillByDefault(Return(true));
+   ON_CALL(*packageUtilPtr_, installPackageWithContext(_, _, _))
+      .WillByDefault(::testing::Invoke([&installed](const std::string& path, const std::string&, const std::map<std::string, int>&) {
+         installed.push_back(path);
+         return true;
+      }));
+
+   PmPlatformComponentManager manager(packageUtilPtr_, fileUtilsPtr_);
+   ASSERT_TRUE(manager.EnableInstallerCache(cacheDirectory, std::chrono::hours(1), 0));
+
+   PmComponent package;
+   package.productAndVersion = "amp/1.0";
+   package.installerType = "rpm";
+   package.installerHash = "02a196424f0e31244c5381a9d8cd77f3c9207cf3d9ec09a2ab032de4bf2051a8";
+   package.downloadedInstallerPath = download;
+   ASSERT_EQ(manager.InstallComponent(package), 0);
+
+   // The download is cleaned up after installing, the installer is not.
+   std::filesystem::remove(download);
+   ASSERT_EQ(manager.InstallComponent(package), 0);
+   ASSERT_EQ(installed.size(), 2u);
+   EXPECT_EQ(installed[0], download.string());
+   EXPECT_EQ(installed[1], (cacheDirectory / package.installerHash).string());
+
+   package.installerHash = "c09a3a745f8026dc1c7b36926c156f2578e60e32569c3cd7077f72c00c02890b";
+   EXPECT_EQ(manager.InstallComponent(package), -1);
+   std::filesystem::remove_all(cacheDirectory);
+}
+
+TEST_F(PmPlatformComponentManagerTest, batchDoesNotEvictCachedInstallersBeforeInstallingThem)
+{
+   const auto cacheDirectory = std::filesystem::temp_directory_path() / ("pm-installer-cache-batch-" + std::to_string(getpid()));
+   const auto downloadA = std::filesystem::temp_directory_path() / ("pm-download-a-" + std::to_string(getpid()) + ".rpm");
+   const auto downloadB = std::filesystem::temp_directory_path() / ("pm-download-b-" + std::to_string(getpid()) + ".rpm");
+   std::filesystem::remove_all(cacheDirectory);
+   std::ofstream(downloadA) << "installer-a";
+   std::ofstream(downloadB) << "installer-b";
+   std::vector<PmComponent> packages(2);
+   packages[0].productAndVersion = "amp/1.0";
+   packages[0].installerHash = "02a196424f0e31244c5381a9d8cd77f3c9207cf3d9ec09a2ab032de4bf2051a8";
+   packages[0].downloadedInstallerPath = downloadA;
+   packages[1].productAndVersion = "uc/1.0";
+   packages[1].installerHash = "c09a3a745f8026dc1c7b36926c156f2578e60e32569c3cd7077f72c00c02890b";
+   packages[1].downloadedInstallerPath = downloadB;
+   for (auto& package : packages) {
+      package.installerType = "rpm";
+   }
+   // The cache holds one installer: uc's, whose download is gone.
+   ASSERT_TRUE(InstallerCache(cacheDirectory, std::chrono::hours(1), 0).Add(downloadB, packages[1].installerHash));
+   std::filesystem::remove(downloadB);
+
+   std::vector<bool> installerExisted;
+   ON_CALL(*fileUtilsPtr_, PathIsValid(_))
+      .WillByDefault(::testing::Invoke([](const std::filesystem::path& path) { return std::filesystem::exists(path); }));
+   ON_CALL(*packageUtilPtr_, isValidInstallerType(_)).WillByDefault(Return(true));
+   ON_CALL(*packageUtilPtr_, verifyPackage(_, _)).WillByDefault(Return(true));
+   ON_CALL(*packageUtilPtr_, installPackageWithContext(_, _, _))
+      .WillByDefault(::testing::Invoke([&installerExisted](const std::string& path, const std::string&, const std::map<std::string, int>&) {
+         // Long enough for uc's installer to be looked up in the cache while amp installs.
+         std::this_thread::sleep_for(std::chrono::milliseconds(200));
+         installerExisted.push_back(std::filesystem::exists(path));
+         return true;
+      }));
+
+   // Caching amp's installer puts the cache over its cap, and uc's is then the least recently used.
+   PmPlatformComponentManager manager(packageUtilPtr_, fileUtilsPtr_);
+   ASSERT_TRUE(manager.EnableInstallerCache(cacheDirectory, std::chrono::hours(1), 11));
+   size_t installedCount = 0;
+   EXPECT_EQ(manager.InstallComponents(packages, installedCount), 0);
+   EXPECT_EQ(installedCount, 2u);
+   EXPECT_EQ(installerExisted, (std::vector<bool>{ true, true }));
+   EXPECT_EQ(InstallerCache(cacheDirectory, std::chrono::hours(1), 0).Entries(), 1u);
+   std::filesystem::remove(downloadA);
+   std::filesystem::remove_all(cacheDirectory);
+}
+
+TEST_F(PmPlatformComponentManagerTest, corruptInstallerIsRejectedBeforeItsSignatureIsChecked)
+{
+   const auto download = std::filesystem::temp_directory_path() / ("pm-download-" + std::to_string(getpid()) + ".rpm");
+   std::ofstream(download) << "installer-b";
+   ON_CALL(*fileUtilsPtr_, PathIsValid(_)).WillByDefault(Return(true));
+   ON_CALL(*packageUtilPtr_, isValidInstallerType(_)).WillByDefault(Return(true));
+   ON_CALL(*packageUtilPtr_, verifyPackage(_, _)).WillByDefault(Return(true));
+   ON_CALL(*packageUtilPtr_, installPackageWithContext(_, _, _)).WillByDefault(Return(true));
+
+   PmPlatformComponentManager manager(packageUtilPtr_, fileUtilsPtr_);
+   PmComponent package;
+   package.productAndVersion = "amp/1.0";
+   package.installerType = "rpm";
+   package.installerHash = "02a196424f0e31244c5381a9d8cd77f3c9207cf3d9ec09a2ab032de4bf2051a8";
+   package.downloadedInstallerPath = download;
+   {
+      EXPECT_CALL(*packageUtilPtr_, verifyPackage(_, _)).Times(0);
+      EXPECT_CALL(*packageUtilPtr_, installPackageWithContext(_, _, _)).Times(0);
+      EXPECT_EQ(manager.InstallComponent(package), -1);
+   }
+   ::testing::Mock::VerifyAndClearExpectations(packageUtilPtr_.get());
+
+   // Digests compare regardless of case.
+   package.installerHash = "C09A3A745F8026DC1C7B36926C156F2578E60E32569C3CD7077F72C00C02890B";
+   EXPECT_EQ(manager.InstallComponent(package), 0);
+
+   // Packages without a digest are still installed.
+   package.installerHash.clear();
+   EXPECT_EQ(manager.InstallComponent(package), 0);
+   std::filesystem::remove(download);
+}
+
+// A benchmark, run with --gtest_also_run_disabled_tests.
+TEST_F(PmPlatformComponentManagerTest, DISABLED_installerDigestThroughput)
+{
+   // Sparse, so the benchmark measures hashing rather than the disk.
+   const uint64_t installerSize = 500ull * 1024 * 1024;
+   const auto download = std::filesystem::temp_directory_path() / ("pm-download-" + std::to_string(getpid()) + ".rpm");
+   std::ofstream(download).close();
+   std::filesystem::resize_file(download, installerSize);
+   ON_CALL(*fileUtilsPtr_, PathIsValid(_)).WillByDefault(Return(true));
+   ON_CALL(*packageUtilPtr_, isValidInstallerType(_)).WillByDefault(Return(true));
+   ON_CALL(*packageUtilPtr_, verifyPackage(_, _)).WillByDefault(Return(true));
+   ON_CALL(*packageUtilPtr_, installPackageWithContext(_, _, _)).WillByDefault(Return(true));
+
+   PmPlatformComponentManager manager(packageUtilPtr_, fileUtilsPtr_);
+   PmComponent package;
+   package.productAndVersion = "amp/1.0";
+   package.installerType = "rpm";
+   package.installerHash = "a08a92258f621b55d08ad1e84c90c2ea6286fc6b6c9a4dfa7156afb16c190170";
+   package.downloadedInstallerPath = download;
+   const auto start = std::chrono::steady_clock::now();
+   const int32_t result = manager.InstallComponent(package);
+   const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+   std::filesystem::remove(download);
+   ASSERT_EQ(result, 0);
+
+   const auto throughput = installerSize / (1024 * 1024) * 1000 / std::max<int64_t>(elapsed.count(), 1);
+   std::cout << "[ BENCHMARK] " << installerSize / (1024 * 1024) << " MB installer verified in " << elapsed.count()
+             << " ms, " << throughput << " MB/s" << std::endl;
+   RecordProperty("digest_ms", static_cast<int>(elapsed.count()));
+   RecordProperty("digest_MBps", static_cast<int>(throughput));
+}
+
+TEST_F(PmPlatformComponentManagerTest, batchVerifiesTheNextPackageWhileInstallingInOrder)
+{
+   std::vector<PmComponent> packages(3);
+   for (size_t i = 0; i < packages.size(); ++i) {
+      packages[i].productAndVersion = "product-" + std::to_string(i) + "/1.0";
+      packages[i].installerType = "rpm";
+      packages[i].downloadedInstallerPath = "/tmp/product-" + std::to_string(i) + ".rpm";
+   }
+
+   std::mutex eventsMutex;
+   std::vector<std::string> verified;
+   std::vector<std::string> installed;
+   std::atomic<bool> overlapped{ false };
+   ON_CALL(*fileUtilsPtr_, PathIsValid(_))
+      .WillByDefault(::testing::Invoke([&](const std::filesystem::path& path) {
+         std::lock_guard<std::mutex> lock(eventsMutex);
+         verified.push_back(path.string());
+         return path.string() != "/tmp/unverifiable.rpm";
+      }));
+   ON_CALL(*packageUtilPtr_, isValidInstallerType(_)).WillByDefault(Return(true));
+   ON_CALL(*packageUtilPtr_, verifyPackage(_, _)).WillByDefault(Return(true));
+   std::atomic<bool> triggersDeferred{ true };
+   ON_CALL(*packageUtilPtr_, installPackageWithContext(_, _, _))
+      .WillByDefault(::testing::Invoke([&](const std::string& path, const std::string&, const std::map<std::string, int>& options) {
+         const auto defer = options.find(kInstallOptionDeferTriggers);
+         triggersDeferred = triggersDeferred && defer != options.end() && defer->second != 0;
+         // The next package is verified before this install finishes.
+         const std::string next = path == packages[0].downloadedInstallerPath.string() ? packages[1].downloadedInstallerPath.string() : "";
+         for (int wait = 0; !next.empty() && wait < 200; ++wait) {
+            {
+               std::lock_guard<std::mutex> lock(eventsMutex);
+               if (std::find(verified.begin(), verified.end(), next) != verified.end()) {
+                  overlapped = true;
+                  break;
+               }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+         }
+         std::lock_guard<std::mutex> lock(eventsMutex);
+         installed.push_back(path);
+         return path != "/tmp/failing.rpm";
+      }));
+
+   // Every batch that installed something processes its deferred triggers once and logs the install metrics,
+   // failed ones included.
+   EXPECT_CALL(*packageUtilPtr_, processPendingTriggers()).Times(3);
+   EXPECT_CALL(*packageUtilPtr_, getInstallMetrics()).Times(3);
+
+   PmPlatformComponentManager manager(packageUtilPtr_, fileUtilsPtr_);
+   size_t installedCount = 0;
+   ASSERT_EQ(manager.InstallComponents(packages, installedCount), 0);
+   EXPECT_EQ(installedCount, 3u);
+   EXPECT_TRUE(overlapped);
+   EXPECT_TRUE(triggersDeferred);
+   ASSERT_EQ(installed.size(), 3u);
+   for (size_t i = 0; i < packages.size(); ++i) {
+      EXPECT_EQ(installed[i], packages[i].downloadedInstallerPath.string());
+   }
+
+   // Stops at the first package that fails to verify.
+   installed.clear();
+   packages[1].downloadedInstallerPath = "/tmp/unverifiable.rpm";
+   EXPECT_EQ(manager.InstallComponents(packages, installedCount), -1);
+   EXPECT_EQ(installedCount, 1u);
+   EXPECT_EQ(installed, std::vector<std::string>{ packages[0].downloadedInstallerPath.string() });
+
+   // Stops at the first package that fails to install.
+   installed.clear();
+   packages[1].downloadedInstallerPath = "/tmp/failing.rpm";
+   EXPECT_EQ(manager.InstallComponents(packages, installedCount), -1);
+   EXPECT_EQ(installedCount, 1u);
+   EXPECT_EQ(installed.size(), 2u);
+
+   std::vector<PmComponent> noPackages;
+   EXPECT_EQ(manager.InstallComponents(noPackages, installedCount), 0);
+   EXPECT_EQ(installedCount, 0u);
+}
+
+TEST_F(PmPlatformComponentManagerTest, uninstallsInOneTransactionAndUpdatesTheCachedInventory)
+{
+   PmPlatformComponentManager manager(packageUtilPtr_, fileUtilsPtr_);
+   std::vector<PmComponent> packages(2);
+   packages[0].productAndVersion = "amp/1.0";
+   packages[1].productAndVersion = "uc/1.0";
+
+   // Nothing discovered, nothing installed.
+   size_t uninstalledCount = 0;
+   EXPECT_CALL(*packageUtilPtr_, uninstallPackages(_)).Times(0);
+   EXPECT_EQ(manager.UninstallComponents(packages, uninstalledCount), 0);
+   EXPECT_EQ(uninstalledCount, 2u);
+   ::testing::Mock::VerifyAndClearExpectations(packageUtilPtr_.get());
+
+   PackageInventory inventory;
+   ASSERT_EQ(manager.GetInstalledPackages(catalog_, inventory), 0);
+   ASSERT_EQ(inventory.packages.size(), 2u);
+   lookups_ = 0;
+
+   EXPECT_CALL(*packageUtilPtr_, uninstallPackages(std::vector<std::string>{ "cisco-amp", "cisco-uc" })).WillOnce(Return(true));
+   EXPECT_CALL(*packageUtilPtr_, uninstallPackage(_)).Times(0);
+   EXPECT_EQ(manager.UninstallComponents(packages, uninstalledCount), 0);
+   EXPECT_EQ(uninstalledCount, 2u);
+   ::testing::Mock::VerifyAndClearExpectations(packageUtilPtr_.get());
+
+   // The inventory is updated without asking the package database again.
+   PackageInventory cached;
+   ASSERT_EQ(manager.GetCachedInventory(cached), 0);
+   EXPECT_TRUE(cached.packages.empty());
+   EXPECT_EQ(lookups_, 0);
+
+   // A failed transaction falls back to removing the packages one at a time.
+   ASSERT_EQ(manager.GetInstalledPackages(catalog_, inventory), 0);
+   EXPECT_CALL(*packageUtilPtr_, uninstallPackages(_)).WillOnce(Return(false));
+   EXPECT_CALL(*packageUtilPtr_, uninstallPackage("cisco-amp")).WillOnce(Return(true));
+   EXPECT_CALL(*packageUtilPtr_, uninstallPackage("cisco-uc")).WillOnce(Return(false));
+   EXPECT_EQ(manager.UninstallComponents(packages, uninstalledCount), -1);
+   EXPECT_EQ(uninstalledCount, 1u);
+   ::testing::Mock::VerifyAndClearExpectations(packageUtilPtr_.get());
+   ASSERT_EQ(manager.GetCachedInventory(cached), 0);
+   ASSERT_EQ(cached.packages.size(), 1u);
+   EXPECT_EQ(cached.packages[0].product, "uc");
+
+   EXPECT_CALL(*packageUtilPtr_, uninstallPackage("cisco-uc")).WillOnce(Return(true));
+   EXPECT_EQ(manager.UninstallComponent(packages[1]), 0);
+   ASSERT_EQ(manager.GetCachedInventory(cached), 0);
+   EXPECT_TRUE(cached.packages.empty());
+}
+
+TEST_F(PmPlatformComponentManagerTest, configurationIsReplacedAtomicallyOnlyWhenItChanges)
+{
+   const auto root = std::filesystem::temp_directory_path() / ("pm-config-" + std::to_string(getpid()));
+   std::filesystem::remove_all(root);
+   PmPlatformComponentManager manager(packageUtilPtr_, fileUtilsPtr_);
+
+   PackageConfigInfo config;
+   config.forProductAndVersion = "amp/1.0";
+   config.deployPath = root / "amp" / "amp.json";
+   config.contents = "{ \"level\": 1 }";
+   ASSERT_EQ(manager.DeployConfiguration(config), 0);
+   std::string contents;
+   std::getline(std::ifstream(config.deployPath), contents);
+   EXPECT_EQ(contents, config.contents);
+   struct stat deployed {};
+   ASSERT_EQ(stat(config.deployPath.c_str(), &deployed), 0);
+   EXPECT_EQ(deployed.st_mode & 07777, 0644u);
+
+   // Identical contents leave the file alone.
+   ASSERT_EQ(chmod(config.deployPath.c_str(), 0640), 0);
+   std::this_thread::sleep_for(std::chrono::milliseconds(20));
+   ASSERT_EQ(manager.DeployConfiguration(config), 0);
+   struct stat unchanged {};
+   ASSERT_EQ(stat(config.deployPath.c_str(), &unchanged), 0);
+   EXPECT_EQ(unchanged.st_ino, deployed.st_ino);
+   EXPECT_EQ(unchanged.st_mtim.tv_nsec, deployed.st_mtim.tv_nsec);
+
+   // Changed contents replace the file, which keeps its permissions; no temporary file is left behind.
+   config.contents = "{ \"level\": 2 }";
+   config.sha256 = "not the digest of the contents";
+   EXPECT_EQ(manager.DeployConfiguration(config), -1);
+   config.sha256.clear();
+   ASSERT_EQ(manager.DeployConfiguration(config), 0);
+   std::getline(std::ifstream(config.deployPath), contents);
+   EXPECT_EQ(contents, config.contents);
+   struct stat replaced {};
+   ASSERT_EQ(stat(config.deployPath.c_str(), &replaced), 0);
+   EXPECT_NE(replaced.st_ino, deployed.st_ino);
+   EXPECT_EQ(replaced.st_mode & 07777, 0640u);
+   EXPECT_EQ(std::distance(std::filesystem::directory_iterator(root / "amp"), std::filesystem::directory_iterator()), 1);
+
+   // Links are not followed.
+   std::filesystem::create_symlink(config.deployPath, root / "amp" / "link.json");
+   config.deployPath = root / "amp" / "link.json";
+   config.contents = "{}";
+   EXPECT_EQ(manager.DeployConfiguration(config), -1);
+   EXPECT_TRUE(std::filesystem::is_symlink(config.deployPath));
+
+   config.deployPath.clear();
+   config.cfgPath = root / "amp" / "*.json";
+   EXPECT_EQ(manager.DeployConfiguration(config), -1);
+   std::filesystem::remove_all(root);
+}
+
+TEST_F(PmPlatformComponentManagerTest, checkinOperationsKeepTheManagerBusy)
+{
+   const auto root = std::filesystem::temp_directory_path() / ("pm-busy-" + std::to_string(getpid()));
+   std::filesystem::remove_all(root);
+   PmPlatformComponentManager manager(packageUtilPtr_, fileUtilsPtr_);
+   std::this_thread::sleep_for(std::chrono::milliseconds(30));
+   EXPECT_TRUE(manager.IsIdleFor(std::chrono::milliseconds(20)));
+
+   PackageConfigInfo config;
+   config.forProductAndVersion = "amp/1.0";
+   config.deployPath = root / "amp.json";
+   config.contents = "{}";
+   ASSERT_EQ(manager.DeployConfiguration(config), 0);
+   EXPECT_FALSE(manager.IsIdleFor(std::chrono::milliseconds(20)));
+   std::this_thread::sleep_for(std::chrono::milliseconds(30));
+   EXPECT_TRUE(manager.IsIdleFor(std::chrono::milliseconds(20)));
+
+   std::ofstream(root / "installer") << "installer";
+   PmComponent package;
+   package.productAndVersion = "amp/1.0";
+   package.installerType = "rpm";
+   package.downloadedInstallerPath = root / "installer";
+   bool idleWhileInstalling = true;
+   ON_CALL(*fileUtilsPtr_, PathIsValid(_)).WillByDefault(Return(true));
+   ON_CALL(*packageUtilPtr_, isValidInstallerType(_)).WillByDefault(Return(true));
+   ON_CALL(*packageUtilPtr_, verifyPackage(_, _)).WillByDefault(Return(true));
+   ON_CALL(*packageUtilPtr_, installPackageWithContext(_, _, _))
+      .WillByDefault(::testing::Invoke([&](const std::string&, const std::string&, const std::map<std::string, int>&) {
+         idleWhileInstalling = manager.IsIdleFor(std::chrono::milliseconds(0));
+         return true;
+      }));
+   ASSERT_EQ(manager.InstallComponent(package), 0);
+   EXPECT_FALSE(idleWhileInstalling);
+   EXPECT_TRUE(manager.IsIdleFor(std::chrono::milliseconds(0)));
+   std::filesystem::remove_all(root);
+}
+
+TEST_F(PmPlatformComponentManagerTest, restartedBatchResumesAfterTheInstalledPackages)
+{
+   const auto root = std::filesystem::temp_directory_path() / ("pm-journal-" + std::to_string(getpid()));
+   std::filesystem::remove_all(root);
+   std::filesystem::create_directories(root);
+   const std::vector<std::pair<std::string, std::string>> installers{
+      { "installer-a", "02a196424f0e31244c5381a9d8cd77f3c9207cf3d9ec09a2ab032de4bf2051a8" },
+      { "installer-b", "c09a3a745f8026dc1c7b36926c156f2578e60e32569c3cd7077f72c00c02890b" },
+      { "installer-c", "0c6d06dd8fe0fe5a7b5700ea105cc63f268f9b87b86336f70c351ff8a99fa39b" } };
+   const std::vector<std::string> products{ "amp", "uc", "orbital" };
+   std::vector<PmComponent> packages(installers.size());
+   for (size_t i = 0; i < installers.size(); ++i) {
+      std::ofstream(root / installers[i].first) << installers[i].first;
+      packages[i].productAndVersion = products[i] + "/1.0";
+      packages[i].installerType = "rpm";
+      packages[i].installerHash = installers[i].second;
+      packages[i].downloadedInstallerPath = root / installers[i].first;
+   }
+
+   std::vector<std::string> installed;
+   std::vector<std::string> verified;
+   bool failLastInstall = true;
+   ON_CALL(*fileUtilsPtr_, PathIsValid(_)).WillByDefault(Return(true));
+   ON_CALL(*packageUtilPtr_, isValidInstallerType(_)).WillByDefault(Return(true));
+   ON_CALL(*packageUtilPtr_, verifyPackage(_, _))
+      .WillByDefault(::testing::Invoke([&](const std::string& path, const std::string&) {
+         verified.push_back(std::filesystem::path(path).filename().string());
+         return true;
+      }));
+   ON_CALL(*packageUtilPtr_, installPackageWithContext(_, _, _))
+      .WillByDefault(::testing::Invoke([&](const std::string& path, const std::string&, const std::map<std::string, int>&) {
+         installed.push_back(std::filesystem::path(path).filename().string());
+         return !(failLastInstall && installed.back() == "installer-c");
+      }));
+
+   size_t installedCount = 0;
+   {
+      PmPlatformComponentManager previousRun(packageUtilPtr_, fileUtilsPtr_);
+      ASSERT_TRUE(previousRun.EnableInstallJournal(root / "journal.log"));
+      EXPECT_EQ(previousRun.InstallComponents(packages, installedCount), -1);
+      EXPECT_EQ(installedCount, 2u);
+   }
+
+   // The discovery that starts the resumed check-in keeps the installs of the previous run that it finds.
+   installed.clear();
+   verified.clear();
+   failLastInstall = false;
+   PmPlatformComponentManager manager(packageUtilPtr_, fileUtilsPtr_);
+   ASSERT_TRUE(manager.EnableInstallJournal(root / "journal.log"));
+   PackageInventory inventory;
+   ASSERT_EQ(manager.GetInstalledPackages(catalog_, inventory), 0);
+   EXPECT_EQ(InstallJournal(root / "journal.log").RecoveredEntries(), 2u);
+   EXPECT_EQ(manager.InstallComponents(packages, installedCount), 0);
+   EXPECT_EQ(installedCount, 3u);
+   EXPECT_EQ(installed, std::vector<std::string>{ "installer-c" });
+   // The previous run verified installer-c too, but signatures are checked again after a restart.
+   EXPECT_EQ(verified, std::vector<std::string>{ "installer-c" });
+
+   // What the previous run installed is skipped once; once it is all acted on, a discovery empties the journal.
+   EXPECT_EQ(manager.InstallComponent(packages[0]), 0);
+   EXPECT_EQ(installed.size(), 2u);
+   ASSERT_EQ(manager.GetInstalledPackages(catalog_, inventory), 0);
+   EXPECT_EQ(std::filesystem::file_size(root / "journal.log"), 0u);
+   std::filesystem::remove_all(root);
+}
+
+TEST_F(PmPlatformComponentManagerTest, journaledInstallIsRepeatedIfDiscoveryDoesNotFindIt)
+{
+   const auto root = std::filesystem::temp_directory_path() / ("pm-journal-removed-" + std::to_string(getpid()));
+   std::filesystem::remove_all(root);
+   std::filesystem::create_directories(root);
+   std::ofstream(root / "installer-a") << "installer-a";
+   PmComponent package;
+   package.productAndVersion = "amp/1.0";
+   package.installerType = "rpm";
+   package.installerHash = "02a196424f0e31244c5381a9d8cd77f3c9207cf3d9ec09a2ab032de4bf2051a8";
+   package.downloadedInstallerPath = root / "installer-a";
+
+   int installs = 0;
+   ON_CALL(*fileUtilsPtr_, PathIsValid(_)).WillByDefault(Return(true));
+   ON_CALL(*packageUtilPtr_, isValidInstallerType(_)).WillByDefault(Return(true));
+   ON_CALL(*packageUtilPtr_, verifyPackage(_, _)).WillByDefault(Return(true));
+   ON_CALL(*packageUtilPtr_, installPackageWithContext(_, _, _))
+      .WillByDefault(::testing::Invoke([&installs](const std::string&, const std::string&, const std::map<std::string, int>&) {
+         ++installs;
+         return true;
+      }));
+   {
+      PmPlatformComponentManager previousRun(packageUtilPtr_, fileUtilsPtr_);
+      ASSERT_TRUE(previousRun.EnableInstallJournal(root / "journal.log"));
+      ASSERT_EQ(previousRun.InstallComponent(package), 0);
+   }
+
+   // The package was removed after the restart, so its journaled install is stale.
+   ON_CALL(*packageUtilPtr_, getPackageInfo(_, _)).WillByDefault(Return(PackageInfo()));
+   PmPlatformComponentManager manager(packageUtilPtr_, fileUtilsPtr_);
+   ASSERT_TRUE(manager.EnableInstallJournal(root / "journal.log"));
+   PackageInventory inventory;
+   ASSERT_EQ(manager.GetInstalledPackages(catalog_, inventory), 0);
+   EXPECT_TRUE(inventory.packages.empty());
+   EXPECT_EQ(InstallJournal(root / "journal.log").RecoveredEntries(), 0u);
+   EXPECT_EQ(manager.InstallComponent(package), 0);
+   EXPECT_EQ(installs, 2);
+   std::filesystem::remove_all(root);
+}
+
+int main(int argc, char **argv) {
+   PmLogger::initLogger();
+   testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,619 @@
+/**
+* @file
+*
+* @copyright (c) 2025 Cisco Systems, Inc. All rights reserved
+*/
+
+#include "gtest/gtest.h"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <fcntl.h>
+#include <glob.h>
+#include <sys/stat.h>
+#include "OSPackageManager/Mocks/MockFileUtilities/MockFileUtilities.hpp"
+#include "OSPackageManager/Mocks/MockPackageUtil/MockPackageUtil.hpp"
+#include "OSPackageManager/linux/PmPlatformDiscovery.hpp"
+#include "OSPackageManager/common/PmLogger.hpp"
+
+using testing::NiceMock;
+using testing::Return;
+using testing::_;
+
+namespace
+{
+// Simulated cost of one package manager query ('dpkg -s' spawn or rpmdb scan) and of one glob.
+const std::chrono::microseconds lookupLatency{ 2000 };
+const std::chrono::microseconds globLatency{ 500 };
+
+PmProductDiscoveryRules makeRule(const std::string& product, const std::vector<std::string>& nvras, const std::vector<std::string>& names, size_t configurableCount = 0)
+{
+   PmProductDiscoveryRules rule;
+   rule.product = product;
+   for (const auto& nvra : nvras) {
+      rule.pkgnvra_discovery.emplace_back();
+      rule.pkgnvra_discovery.back().pkgId = nvra;
+   }
+   for (const auto& name : names) {
+      rule.pkgname_discovery.emplace_back();
+      rule.pkgname_discovery.back().name = name;
+   }
+   for (size_t i = 0; i < configurableCount; ++i) {
+      PmProductDiscoveryConfigurable configurable;
+      configurable.cfgPath = "/opt/cisco/" + product + "/config" + std::to_string(i) + ".json";
+      configurable.unresolvedCfgPath = configurable.cfgPath;
+      configurable.max_instances = 1;
+      rule.configurables.push_back(configurable);
+   }
+   return rule;
+}
+
+PackageInfo installedPackage(const std::string& name, const std::string& version)
+{
+   PackageInfo info;
+   info.packageIdentifier = name + "-" + version;
+   info.packageName = name;
+   info.version = version;
+   return info;
+}
+
+// Backdates a path so that discovery does not consider its mtime too recent to trust.
+void backdate(const std::filesystem::path& path, time_t seconds)
+{
+   struct timespec times[2] = {};
+   times[0].tv_sec = times[1].tv_sec = time(nullptr) - seconds;
+   ASSERT_EQ(utimensat(AT_FDCWD, path.c_str(), times, 0), 0);
+}
+
+bool contains(const std::vector<std::string>& values, const std::string& value)
+{
+   return std::find(values.begin(), values.end(), value) != values.end();
+}
+}
+
+class PmPlatformDiscoveryTest : public ::testing::Test
+{
+protected:
+   void SetUp() override
+   {
+      packageUtilPtr_ = std::make_shared<NiceMock<MockPackageUtil>>();
+      fileUtilsPtr_ = std::make_shared<NiceMock<MockFileUtilities>>();
+
+      ON_CALL(*fileUtilsPtr_, PathIsValid(_)).WillByDefault(Return(true));
+      ON_CALL(*fileUtilsPtr_, FileSearchWithWildCard(_, _))
+         .WillByDefault(::testing::Invoke([](const std::filesystem::path& searchPath, std::vector<std::filesystem::path>& results) {
+            std::this_thread::sleep_for(globLatency);
+            results.push_back(searchPath);
+            return 0;
+         }));
+   }
+   void TearDown() override
+   {
+   }
+   std::shared_ptr<NiceMock<MockPackageUtil>> packageUtilPtr_;
+   std::shared_ptr<NiceMock<MockFileUtilities>> fileUtilsPtr_;
+};
+
+TEST_F(PmPlatformDiscoveryTest, firstMatchPerProductWinsInCatalogOrder)
+{
+   auto &packageUtil{ *packageUtilPtr_ };
+   ON_CALL(packageUtil, getPackageInfo(_, _)).WillByDefault(Return(PackageInfo{}));
+   ON_CALL(packageUtil, getPackageInfo(PKG_ID_TYPE::NAME, "uc-new")).WillByDefault(Return(installedPackage("uc-new", "2.0")));
+   ON_CALL(packageUtil, getPackageInfo(PKG_ID_TYPE::NAME, "uc-old")).WillByDefault(Return(installedPackage("uc-old", "1.0")));
+   ON_CALL(packageUtil, getPackageInfo(PKG_ID_TYPE::NVRA, "amp-1.20.0-1.x86_64")).WillByDefault(Return(installedPackage("amp", "1.20.0")));
+   ON_CALL(packageUtil, getPackageInfo(PKG_ID_TYPE::NAME, "amp")).WillByDefault(Return(installedPackage("amp", "1.19.0")));
+
+   const std::vector<PmProductDiscoveryRules> catalog{
+      makeRule("uc", {}, { "uc-missing" }),
+      makeRule("amp", { "amp-1.20.0-1.x86_64" }, { "amp" }, 1),
+      makeRule("uc", {}, { "uc-new" }, 2),
+      makeRule("uc", {}, { "uc-old" }),
+      makeRule("umbrella", {}, { "umbrella" }),
+   };
+
+   PmPlatformDiscovery discovery(packageUtilPtr_, fileUtilsPtr_, 4);
+   const auto inventory = discovery.DiscoverInstalledPackages(catalog);
+
+   ASSERT_EQ(inventory.packages.size(), 2u);
+   EXPECT_EQ(inventory.packages[0].product, "amp");
+   EXPECT_EQ(inventory.packages[0].version, "1.20.0"); // NVRA rules are tried before name rules
+   EXPECT_EQ(inventory.packages[0].configs.size(), 1u);
+   EXPECT_EQ(inventory.packages[1].product, "uc");
+   EXPECT_EQ(inventory.packages[1].version, "2.0");
+   EXPECT_EQ(inventory.packages[1].configs.size(), 2u);
+   EXPECT_EQ(inventory.platform, "linux");
+   EXPECT_EQ(discovery.CachedInventory()->packages.size(), 2u);
+}
+
+TEST_F(PmPlatformDiscoveryTest, indexedMatchingAgreesWithPerRuleLookups)
+{
+   std::vector<PackageInfo> installed{
+      installedPackage("uc-old", "1.0"), installedPackage("amp", "1.19.0"), installedPackage("uc-new", "2.0"),
+      installedPackage("orbital", "3.1"), installedPackage("nvm", "5.0") };
+   installed[1].packageIdentifier = "amp-1.19.0-1.x86_64";
+   installed[3].packageIdentifier = "orbital-3.1-7.x86_64";
+   installed[4].packageIdentifier = "nvm-5.0-2.aarch64";
+   auto &packageUtil{ *packageUtilPtr_ };
+   ON_CALL(packageUtil, getPackageInfo(_, _))
+      .WillByDefault(::testing::Invoke([&installed](const PKG_ID_TYPE& type, const std::string& identifier) {
+         for (const auto& package : installed) {
+            if ((type == PKG_ID_TYPE::NAME && package.packageName == identifier) ||
+                (type == PKG_ID_TYPE::NVRA && package.packageIdentifier == identifier)) {
+               return package;
+            }
+         }
+         return PackageInfo{};
+      }));
+
+   std::vector<PmProductDiscoveryRules> catalog{
+      makeRule("uc", {}, { "uc-missing" }),
+      makeRule("amp", { "amp-1.20.0-1.x86_64", "amp-1.19.0-1.x86_64" }, { "amp" }),
+      makeRule("uc", {}, { "uc-new", "uc-old" }),
+      makeRule("uc", {}, { "uc-old" }),
+      makeRule("umbrella", {}, { "umbrella" }),
+      makeRule("orbital", { "orbital-4*" }, { "orbital" }),
+   };
+   for (int i = 0; i < 8; ++i) {
+      catalog.push_back(makeRule("missing" + std::to_string(i), { "missing-1.0-1.x86_64" }, { "missing" }));
+   }
+
+   PmPlatformDiscovery lookupDiscovery(packageUtilPtr_, fileUtilsPtr_);
+   const auto expected = lookupDiscovery.DiscoverInstalledPackages(catalog);
+
+   EXPECT_CALL(packageUtil, listInstalledPackages(_)).WillOnce(::testing::DoAll(::testing::SetArgReferee<0>(installed), Return(true)));
+   EXPECT_CALL(packageUtil, getPackageInfo(_, _)).Times(0);
+   PmPlatformDiscovery indexedDiscovery(packageUtilPtr_, fileUtilsPtr_);
+   const auto indexed = indexedDiscovery.DiscoverInstalledPackages(catalog);
+
+   ASSERT_EQ(indexed.packages.size(), expected.packages.size());
+   for (size_t i = 0; i < expected.packages.size(); ++i) {
+      EXPECT_EQ(indexed.packages[i].product, expected.packages[i].product);
+      EXPECT_EQ(indexed.packages[i].version, expected.packages[i].version);
+   }
+   ASSERT_EQ(indexed.packages.size(), 3u);
+   EXPECT_EQ(indexed.packages[0].version, "1.19.0");
+   EXPECT_EQ(indexed.packages[1].version, "2.0");
+   EXPECT_EQ(indexed.packages[2].version, "3.1");
+
+   // Wildcard NVRA identifiers are matched against the listed packages.
+   catalog.resize(1);
+   catalog.push_back(makeRule("nvm", { "nvm-5.*.aarch64" }, {}));
+   EXPECT_CALL(packageUtil, listInstalledPackages(_)).WillOnce(::testing::DoAll(::testing::SetArgReferee<0>(installed), Return(true)));
+   const auto wildcard = indexedDiscovery.DiscoverInstalledPackages(catalog);
+   ASSERT_EQ(wildcard.packages.size(), 1u);
+   EXPECT_EQ(wildcard.packages[0].product, "nvm");
+   EXPECT_EQ(wildcard.packages[0].version, "5.0");
+}
+
+TEST_F(PmPlatformDiscoveryTest, lookupErrorsArePropagated)
+{
+   ON_CALL(*packageUtilPtr_, getPackageInfo(_, _)).WillByDefault(::testing::Throw(PkgUtilException("rpmdb unavailable")));
+
+   std::vector<PmProductDiscoveryRules> catalog;
+   for (int i = 0; i < 16; ++i) {
+      catalog.push_back(makeRule("product" + std::to_string(i), {}, { "package" + std::to_string(i) }));
+   }
+
+   PmPlatformDiscovery discovery(packageUtilPtr_, fileUtilsPtr_);
+   EXPECT_THROW(discovery.DiscoverInstalledPackages(catalog), PkgUtilException);
+}
+
+// A benchmark, run with --gtest_also_run_disabled_tests.
+TEST_F(PmPlatformDiscoveryTest, DISABLED_benchmarkSyntheticCatalogOf200Products)
+{
+   const size_t productCount = 200;
+
+   ON_CALL(*packageUtilPtr_, getPackageInfo(_, _))
+      .WillByDefault(::testing::Invoke([](const PKG_ID_TYPE& type, const std::string& identifier) {
+         std::this_thread::sleep_for(lookupLatency);
+         // Every product has an NVRA and a name rule; two in three are installed and found by name.
+         const size_t index = std::stoul(identifier.substr(identifier.find('-') + 1));
+         if (type == PKG_ID_TYPE::NAME && index % 3 != 0) {
+            return installedPackage(identifier, "1." + std::to_string(index));
+         }
+         return PackageInfo{};
+      }));
+
+   std::vector<PmProductDiscoveryRules> catalog;
+   for (size_t i = 0; i < productCount; ++i) {
+      const std::string product = "product-" + std::to_string(i);
+      catalog.push_back(makeRule(product, { product + "-1.0-1.x86_64" }, { product }, 3));
+   }
+
+   auto timeDiscovery = [this, &catalog](size_t workers, PackageInventory& inventory) {
+      PmPlatformDiscovery discovery(packageUtilPtr_, fileUtilsPtr_, workers);
+      const auto start = std::chrono::steady_clock::now();
+      inventory = discovery.DiscoverInstalledPackages(catalog);
+      return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+   };
+
+   PackageInventory sequential;
+   PackageInventory parallel;
+   PackageInventory indexed;
+   const auto sequentialTime = timeDiscovery(1, sequential);
+   const auto parallelTime = timeDiscovery(PmPlatformDiscovery::kDefaultDiscoveryWorkers, parallel);
+
+   // Listing the whole package database costs about as much as a few single queries.
+   ON_CALL(*packageUtilPtr_, listInstalledPackages(_))
+      .WillByDefault(::testing::Invoke([productCount](std::vector<PackageInfo>& packages) {
+         std::this_thread::sleep_for(10 * lookupLatency);
+         for (size_t i = 0; i < productCount; ++i) {
+            if (i % 3 != 0) {
+               packages.push_back(installedPackage("product-" + std::to_string(i), "1." + std::to_string(i)));
+            }
+         }
+         return true;
+      }));
+   const auto indexedTime = timeDiscovery(PmPlatformDiscovery::kDefaultDiscoveryWorkers, indexed);
+
+   std::cout << "[ BENCHMARK] " << productCount << " products: sequential " << sequentialTime.count()
+             << " ms, " << PmPlatformDiscovery::kDefaultDiscoveryWorkers << " workers " << parallelTime.count()
+             << " ms, indexed " << indexedTime.count() << " ms" << std::endl;
+   RecordProperty("sequential_ms", static_cast<int>(sequentialTime.count()));
+   RecordProperty("parallel_ms", static_cast<int>(parallelTime.count()));
+   RecordProperty("indexed_ms", static_cast<int>(indexedTime.count()));
+   ASSERT_EQ(indexed.packages.size(), sequential.packages.size());
+
+   ASSERT_EQ(parallel.packages.size(), sequential.packages.size());
+   EXPECT_EQ(parallel.packages.size(), productCount - (productCount + 2) / 3);
+   for (size_t i = 0; i < sequential.packages.size(); ++i) {
+      EXPECT_EQ(parallel.packages[i].product, sequential.packages[i].product);
+      EXPECT_EQ(parallel.packages[i].version, sequential.packages[i].version);
+      ASSERT_EQ(parallel.packages[i].configs.size(), sequential.packages[i].configs.size());
+      for (size_t c = 0; c < sequential.packages[i].configs.size(); ++c) {
+         EXPECT_EQ(parallel.packages[i].configs[c].cfgPath, sequential.packages[i].configs[c].cfgPath);
+      }
+   }
+}
+
+TEST_F(PmPlatformDiscoveryTest, cachedInventoryIsPublishedAtomically)
+{
+   ON_CALL(*fileUtilsPtr_, FileSearchWithWildCard(_, _)).WillByDefault(Return(0));
+   ON_CALL(*packageUtilPtr_, getPackageInfo(_, _))
+      .WillByDefault(::testing::Invoke([](const PKG_ID_TYPE&, const std::string& identifier) { return installedPackage(identifier, "1.0"); }));
+
+   std::vector<PmProductDiscoveryRules> catalog;
+   for (int i = 0; i < 50; ++i) {
+      catalog.push_back(makeRule("product" + std::to_string(i), {}, { "package" + std::to_string(i) }));
+   }
+
+   PmPlatformDiscovery discovery(packageUtilPtr_, fileUtilsPtr_);
+   const auto initial = discovery.CachedInventory();
+   ASSERT_NE(initial, nullptr);
+   EXPECT_TRUE(initial->packages.empty());
+
+   std::atomic<bool> done{ false };
+   std::atomic<int> torn{ 0 };
+   std::thread reader([&]() {
+      while (!done) {
+         const auto inventory = discovery.CachedInventory();
+         if (!inventory->packages.empty() && inventory->packages.size() != catalog.size()) {
+            ++torn;
+         }
+      }
+   });
+   for (int i = 0; i < 20; ++i) {
+      (void)discovery.DiscoverInstalledPackages(catalog);
+   }
+   done = true;
+   reader.join();
+
+   EXPECT_EQ(torn, 0);
+   EXPECT_TRUE(initial->packages.empty()); // Snapshots held by readers are never modified.
+   EXPECT_EQ(discovery.CachedInventory()->packages.size(), catalog.size());
+}
+
+TEST_F(PmPlatformDiscoveryTest, duplicateConfigurablesAreRejectedAtScale)
+{
+   const size_t fileCount = 10000;
+   ON_CALL(*fileUtilsPtr_, FileSearchWithWildCard(_, _))
+      .WillByDefault(::testing::Invoke([](const std::filesystem::path& searchPath, std::vector<std::filesystem::path>& results) {
+         // Both patterns match the same files, spelled differently.
+         const std::string directory = searchPath.parent_path().generic_u8string();
+         for (size_t i = 0; i < fileCount; ++i) {
+            results.push_back(directory + "/policy" + std::to_string(i) + ".json");
+         }
+         return 0;
+      }));
+   ON_CALL(*packageUtilPtr_, getPackageInfo(_, _)).WillByDefault(Return(installedPackage("amp", "1.0")));
+
+   auto rule = makeRule("amp", {}, { "amp" });
+   for (const std::string pattern : { "/opt/amp/policies/*.json", "/opt/amp/./policies/*.json" }) {
+      rule.configurables.emplace_back();
+      rule.configurables.back().cfgPath = pattern;
+      rule.configurables.back().unresolvedCfgPath = pattern;
+      rule.configurables.back().max_instances = fileCount;
+   }
+   // A deploy path that resolves to files already collected as config paths is a bad configuration.
+   rule.configurables.emplace_back();
+   rule.configurables.back().cfgPath = "/opt/amp/other/*.json";
+   rule.configurables.back().unresolvedCfgPath = "/opt/amp/other/*.json";
+   rule.configurables.back().deployPath = "/opt/amp//policies/*.json";
+   rule.configurables.back().unresolvedDeployPath = "/opt/amp//policies/*.json";
+   rule.configurables.back().max_instances = fileCount;
+
+   PmPlatformDiscovery discovery(packageUtilPtr_, fileUtilsPtr_);
+   const auto inventory = discovery.DiscoverInstalledPackages({ rule });
+
+   ASSERT_EQ(inventory.packages.size(), 1u);
+   const auto& configs = inventory.packages[0].configs;
+   ASSERT_EQ(configs.size(), fileCount);
+   EXPECT_EQ(configs.front().cfgPath, "/opt/amp/policies/policy0.json");
+   EXPECT_EQ(configs.back().cfgPath, "/opt/amp/policies/policy9999.json");
+   EXPECT_TRUE(std::none_of(configs.begin(), configs.end(), [](const PackageConfigInfo& config) { return config.isDiscoveredAtDeployPath; }));
+}
+
+class PmPlatformDiscoveryIncrementalTest : public PmPlatformDiscoveryTest
+{
+protected:
+   void SetUp() override
+   {
+      PmPlatformDiscoveryTest::SetUp();
+      configDir_ = std::filesystem::temp_directory_path() / ("pm-discovery-" + std::to_string(getpid()));
+      std::filesystem::remove_all(configDir_);
+      std::filesystem::create_directories(configDir_);
+      std::ofstream(configDir_ / "app.json") << "{}";
+      backdate(configDir_ / "app.json", 60);
+      backdate(configDir_, 60);
+
+      ON_CALL(*fileUtilsPtr_, FileSearchWithWildCard(_, _))
+         .WillByDefault(::testing::Invoke([this](const std::filesystem::path& searchPath, std::vector<std::filesystem::path>& results) {
+            ++globs_;
+            glob_t matches = {};
+            if (glob(searchPath.c_str(), 0, nullptr, &matches) == 0) {
+               results.insert(results.end(), matches.gl_pathv, matches.gl_pathv + matches.gl_pathc);
+            }
+            globfree(&matches);
+            return 0;
+         }));
+      ON_CALL(*packageUtilPtr_, getPackageInfo(_, _))
+         .WillByDefault(::testing::Invoke([this](const PKG_ID_TYPE&, const std::string& identifier) {
+            ++lookups_;
+            const auto it = installed_.find(identifier);
+            return it == installed_.end() ? PackageInfo{} : installedPackage(identifier, it->second);
+         }));
+      ON_CALL(*packageUtilPtr_, getPackageDbGeneration()).WillByDefault(::testing::ReturnPointee(&dbGeneration_));
+      ON_CALL(*packageUtilPtr_, getChangedPackagesSince(_, _))
+         .WillByDefault(::testing::Invoke([this](uint64_t, std::set<std::string>& packageNames) {
+            packageNames = changedPackages_;
+            return changesKnown_;
+         }));
+   }
+   void TearDown() override
+   {
+      std::filesystem::remove_all(configDir_);
+   }
+
+   PmProductDiscoveryRules makeConfiguredRule(const std::string& product)
+   {
+      auto rule = makeRule(product, {}, { product });
+      rule.configurables.emplace_back();
+      rule.configurables.back().cfgPath = configDir_ / "*.json";
+      rule.configurables.back().unresolvedCfgPath = rule.configurables.back().cfgPath;
+      rule.configurables.back().max_instances = 10;
+      return rule;
+   }
+
+   std::filesystem::path configDir_;
+   std::atomic<int> globs_{ 0 };
+   std::atomic<int> lookups_{ 0 };
+   std::map<std::string, std::string> installed_{ { "amp", "1.0" }, { "uc", "2.0" } };
+   uint64_t dbGeneration_ = 5;
+   std::set<std::string> changedPackages_;
+   bool changesKnown_ = true;
+};
+
+TEST_F(PmPlatformDiscoveryIncrementalTest, unchangedInputsReusePreviousResults)
+{
+   const std::vector<PmProductDiscoveryRules> catalog{ makeConfiguredRule("amp"), makeConfiguredRule("uc"), makeRule("missing", {}, { "missing" }) };
+   PmPlatformDiscovery discovery(packageUtilPtr_, fileUtilsPtr_);
+
+   const auto first = discovery.DiscoverInstalledPackages(catalog);
+   ASSERT_EQ(first.packages.size(), 2u);
+   EXPECT_EQ(first.packages[0].configs.size(), 1u);
+   EXPECT_EQ(discovery.LastInventoryDelta().addedProducts.size(), 2u);
+
+   lookups_ = 0;
+   globs_ = 0;
+   const auto second = discovery.DiscoverInstalledPackages(catalog);
+   EXPECT_EQ(lookups_, 0);
+   EXPECT_EQ(globs_, 0);
+   ASSERT_EQ(second.packages.size(), 2u);
+   EXPECT_EQ(second.packages[0].configs.size(), 1u);
+   EXPECT_EQ(second.packages[1].version, "2.0");
+
+   const auto delta = discovery.LastInventoryDelta();
+   EXPECT_TRUE(delta.complete);
+   EXPECT_TRUE(delta.IsEmpty());
+   EXPECT_EQ(delta.reusedRuleResults, catalog.size());
+   EXPECT_EQ(delta.inventoryGeneration, 1u);
+
+   // A new file in a globbed directory reruns the configurable discovery, but not the package lookups.
+   std::ofstream(configDir_ / "extra.json") << "{}";
+   backdate(configDir_ / "extra.json", 30);
+   backdate(configDir_, 30);
+   const auto third = discovery.DiscoverInstalledPackages(catalog);
+   EXPECT_EQ(lookups_, 0);
+   EXPECT_GT(globs_, 0);
+   ASSERT_EQ(third.packages.size(), 2u);
+   EXPECT_EQ(third.packages[0].configs.size(), 2u);
+   EXPECT_EQ(discovery.LastInventoryDelta().changedProducts, (std::vector<std::string>{ "amp", "uc" }));
+   EXPECT_EQ(discovery.LastInventoryDelta().inventoryGeneration, 2u);
+}
+
+TEST_F(PmPlatformDiscoveryIncrementalTest, changedPackagesAreLookedUpAgain)
+{
+   const std::vector<PmProductDiscoveryRules> catalog{ makeConfiguredRule("amp"), makeConfiguredRule("uc"), makeRule("orbital", { "orbital-1.0-1.x86_64" }, {}) };
+   PmPlatformDiscovery discovery(packageUtilPtr_, fileUtilsPtr_);
+   (void)discovery.DiscoverInstalledPackages(catalog);
+
+   installed_.erase("uc");
+   installed_["amp"] = "1.1";
+   installed_["orbital-1.0-1.x86_64"] = "1.0";
+   dbGeneration_ = 9;
+   changedPackages_ = { "uc", "amp", "orbital" };
+   lookups_ = 0;
+
+   const auto inventory = discovery.DiscoverInstalledPackages(catalog);
+   EXPECT_EQ(lookups_, 3);
+   ASSERT_EQ(inventory.packages.size(), 2u);
+   EXPECT_EQ(inventory.packages[0].version, "1.1");
+
+   const auto delta = discovery.LastInventoryDelta();
+   EXPECT_TRUE(contains(delta.addedProducts, "orbital"));
+   EXPECT_TRUE(contains(delta.removedProducts, "uc"));
+   EXPECT_TRUE(contains(delta.changedProducts, "amp"));
+   EXPECT_EQ(delta.reusedRuleResults, 0u);
+
+   // Unknown changes (e.g. after an inotify overflow) invalidate every cached match.
+   changesKnown_ = false;
+   lookups_ = 0;
+   (void)discovery.DiscoverInstalledPackages(catalog);
+   EXPECT_EQ(lookups_, 3);
+   EXPECT_TRUE(discovery.LastInventoryDelta().IsEmpty());
+}
+
+TEST_F(PmPlatformDiscoveryIncrementalTest, configurableContentsAreFingerprinted)
+{
+   const std::vector<PmProductDiscoveryRules> catalog{ makeConfiguredRule("amp") };
+   PmPlatformDiscovery discovery(packageUtilPtr_, fileUtilsPtr_);
+
+   const auto first = discovery.DiscoverInstalledPackages(catalog);
+   ASSERT_EQ(first.packages.size(), 1u);
+   ASSERT_EQ(first.packages[0].configs.size(), 1u);
+   // sha256("{}")
+   EXPECT_EQ(first.packages[0].configs[0].sha256, "44136fa355b3678a1146ad16f7e8649e94fb4fc21fe77e8310c060f61caaff8a");
+
+   // An in-place edit of the same size.
+   std::ofstream(configDir_ / "app.json") << "[]";
+   backdate(configDir_ / "app.json", 30);
+   const auto second = discovery.DiscoverInstalledPackages(catalog);
+   ASSERT_EQ(second.packages[0].configs.size(), 1u);
+   // sha256("[]")
+   EXPECT_EQ(second.packages[0].configs[0].sha256, "4f53cda18c2baa0c0354bb5f9a3ecbe5ed12ab4d8e11ba873c2f11161202b945");
+   EXPECT_EQ(discovery.LastInventoryDelta().changedProducts, (std::vector<std::string>{ "amp" }));
+
+   (void)discovery.DiscoverInstalledPackages(catalog);
+   EXPECT_TRUE(discovery.LastInventoryDelta().IsEmpty());
+}
+
+TEST_F(PmPlatformDiscoveryIncrementalTest, watchedChangesAreRediscovered)
+{
+   const std::vector<PmProductDiscoveryRules> catalog{ makeConfiguredRule("amp") };
+   PmPlatformDiscovery discovery(packageUtilPtr_, fileUtilsPtr_);
+   ASSERT_TRUE(discovery.WatchConfigurables(std::chrono::milliseconds(1), {}));
+
+   (void)discovery.DiscoverInstalledPackages(catalog);
+   (void)discovery.DiscoverInstalledPackages(catalog); // verifies the stamps under the new watches
+   globs_ = 0;
+   (void)discovery.DiscoverInstalledPackages(catalog);
+   EXPECT_EQ(globs_, 0);
+   EXPECT_TRUE(discovery.LastInventoryDelta().IsEmpty());
+
+   // An in-place edit that keeps size and modification time is invisible to stamps, but not to the watch.
+   struct stat before {};
+   ASSERT_EQ(stat((configDir_ / "app.json").c_str(), &before), 0);
+   std::ofstream(configDir_ / "app.json") << "[]";
+   const struct timespec times[2] = { before.st_atim, before.st_mtim };
+   ASSERT_EQ(utimensat(AT_FDCWD, (configDir_ / "app.json").c_str(), times, 0), 0);
+
+   const auto inventory = discovery.DiscoverInstalledPackages(catalog);
+   EXPECT_GT(globs_, 0);
+   ASSERT_EQ(inventory.packages[0].configs.size(), 1u);
+   // sha256("[]")
+   EXPECT_EQ(inventory.packages[0].configs[0].sha256, "4f53cda18c2baa0c0354bb5f9a3ecbe5ed12ab4d8e11ba873c2f11161202b945");
+   EXPECT_EQ(discovery.LastInventoryDelta().changedProducts, (std::vector<std::string>{ "amp" }));
+}
+
+TEST_F(PmPlatformDiscoveryIncrementalTest, perUserConfigurablesAreDiscoveredForEveryLoggedInUser)
+{
+   const std::string unresolvedPattern = "<FOLDERID_UserHome>/.config/amp/*.json";
+   std::vector<std::string> users{ "alice", "bob" };
+   auto addUser = [this](const std::string& user) {
+      const auto directory = configDir_ / user / ".config" / "amp";
+      std::filesystem::create_directories(directory);
+      std::ofstream(directory / "policy.json") << "{}";
+      backdate(directory / "policy.json", 60);
+      backdate(directory, 60);
+   };
+   for (const auto& user : users) {
+      addUser(user);
+   }
+   ON_CALL(*fileUtilsPtr_, ResolvePathForAllUsers(unresolvedPattern))
+      .WillByDefault(::testing::Invoke([this, &users](const std::string&) {
+         std::vector<std::string> paths;
+         for (const auto& user : users) {
+            paths.push_back((configDir_ / user / ".config/amp/*.json").string());
+         }
+         return paths;
+      }));
+
+   auto rule = makeRule("amp", {}, { "amp" });
+   rule.configurables.emplace_back();
+   rule.configurables.back().cfgPath = configDir_ / "alice/.config/amp/*.json";
+   rule.configurables.back().unresolvedCfgPath = unresolvedPattern;
+   rule.configurables.back().max_instances = 1;
+   const std::vector<PmProductDiscoveryRules> catalog{ rule };
+   PmPlatformDiscovery discovery(packageUtilPtr_, fileUtilsPtr_);
+
+   const auto first = discovery.DiscoverInstalledPackages(catalog);
+   ASSERT_EQ(first.packages.size(), 1u);
+   ASSERT_EQ(first.packages[0].configs.size(), 2u); // max_instances applies per user
+   EXPECT_EQ(first.packages[0].configs[0].cfgPath, configDir_ / "alice/.config/amp/policy.json");
+   EXPECT_EQ(first.packages[0].configs[1].cfgPath, configDir_ / "bob/.config/amp/policy.json");
+   for (const auto& config : first.packages[0].configs) {
+      EXPECT_EQ(config.unresolvedCfgPath, "<FOLDERID_UserHome>/.config/amp/policy.json");
+   }
+
+   globs_ = 0;
+   (void)discovery.DiscoverInstalledPackages(catalog);
+   EXPECT_EQ(globs_, 0);
+
+   // A login changes the search paths even though no stamped directory changed.
+   users.push_back("carol");
+   addUser("carol");
+   const auto third = discovery.DiscoverInstalledPackages(catalog);
+   EXPECT_GT(globs_, 0);
+   ASSERT_EQ(third.packages[0].configs.size(), 3u);
+   EXPECT_EQ(third.packages[0].configs[2].cfgPath, configDir_ / "carol/.config/amp/policy.json");
+   EXPECT_EQ(discovery.LastInventoryDelta().changedProducts, (std::vector<std::string>{ "amp" }));
+}
+
+TEST_F(PmPlatformDiscoveryIncrementalTest, removedProductsArePublishedWithoutRediscovery)
+{
+   const std::vector<PmProductDiscoveryRules> catalog{ makeConfiguredRule("amp"), makeConfiguredRule("uc") };
+   PmPlatformDiscovery discovery(packageUtilPtr_, fileUtilsPtr_);
+   EXPECT_TRUE(discovery.InstalledPackageOf("uc").empty());
+   (void)discovery.DiscoverInstalledPackages(catalog);
+   EXPECT_EQ(discovery.InstalledPackageOf("uc"), "uc");
+   EXPECT_TRUE(discovery.InstalledPackageOf("missing").empty());
+
+   lookups_ = 0;
+   globs_ = 0;
+   discovery.RemoveProducts({ "uc" });
+   EXPECT_EQ(lookups_, 0);
+   EXPECT_EQ(globs_, 0);
+   ASSERT_EQ(discovery.CachedInventory()->packages.size(), 1u);
+   EXPECT_EQ(discovery.CachedInventory()->packages[0].product, "amp");
+   EXPECT_TRUE(discovery.InstalledPackageOf("uc").empty());
+   auto delta = discovery.LastInventoryDelta();
+   EXPECT_EQ(delta.removedProducts, (std::vector<std::string>{ "uc" }));
+   EXPECT_EQ(delta.inventoryGeneration, 2u);
+
+   // The removed product's rule is matched again even if the package database reports no change.
+   installed_.erase("uc");
+   const auto inventory = discovery.DiscoverInstalledPackages(catalog);
+   EXPECT_EQ(lookups_, 1);
+   EXPECT_EQ(inventory.packages.size(), 1u);
+   delta = discovery.LastInventoryDelta();
+   EXPECT_TRUE(delta.IsEmpty());
+   EXPECT_EQ(delta.inventoryGeneration, 2u);
+}
+
+int main(int argc, char **argv) {
+   PmLogger::initLogger();
+   testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -0,0 +1,76 @@
+/**************************************************************************
+ *       Copyright (c) 2025, Cisco Systems, All Rights Reserved
+ ***************************************************************************
+ *
+ *  @file:    ParallelForEach.hpp
+ *
+ ***************************************************************************
+ * @desc Runs indexed work items on a short-lived pool of std::threads.
+ ***************************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace util
+{
+
+/**
+ * @brief Calls func(i) for every i in [0, count) on up to workerCount threads, including the calling thread.
+ *
+ * Items are handed out in index order from a shared counter, so slow items do not hold up a whole batch.
+ * Callers keep results deterministic by writing to slot i of a pre-sized container.
+ * Returns once every item has been processed. The first exception thrown by func is rethrown
+ * after all workers have stopped; the remaining items are skipped.
+ */
+template<typename TFunc>
+void ParallelForEach(size_t count, size_t workerCount, TFunc func)
+{
+    const size_t threadCount = std::min(std::max<size_t>(workerCount, 1), count);
+    if (threadCount <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            func(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr firstError;
+    std::mutex errorMutex;
+
+    auto worker = [&]() {
+        size_t i = 0;
+        while (!failed && (i = next++) < count) {
+            try {
+                func(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!firstError) {
+                    firstError = std::current_exception();
+                }
+                failed = true;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount - 1);
+    for (size_t t = 1; t < threadCount; ++t) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+}
+
+}